@@ -0,0 +1,52 @@
+/**
+  ******************************************************************************
+  * @file           : fmt.h
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Integer text formatter header
+  ******************************************************************************
+  * @attention
+  *
+  * Small integer to text formatter for the text stream, a replacement for
+  * snprintf on the hot paths. Each function writes at pOut, no terminating
+  * null, and returns the end of the text written, so calls chain:
+  *
+  *   p = Fmt_Str(msg, "GYRO READ:");
+  *   p = Fmt_Fields(p, pValues, 3, true);
+  *   p = Fmt_Str(p, "\n\r");
+  *
+  * No allocation and no locale, the caller sizes the output buffer.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FMT_H
+#define __FMT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define FMT_UINT32_MAX_LEN  10U     /*!< "4294967295"               */
+#define FMT_INT32_MAX_LEN   11U     /*!< "-2147483648"              */
+#define FMT_FIELD_MAX_LEN   7U      /*!< "\t-32768" or "\t65535"    */
+#define FMT_FIELD32_MAX_LEN 12U     /*!< "\t-2147483648"            */
+
+/* Exported functions --------------------------------------------------------*/
+char* Fmt_Str(char* pOut, const char* pStr);
+char* Fmt_Uint32(char* pOut, uint32_t value);
+char* Fmt_Int32(char* pOut, int32_t value);
+char* Fmt_Hex(char* pOut, uint32_t value, uint8_t digits);
+char* Fmt_Fields(char* pOut, const int16_t* pValues, uint8_t count, bool asUnsigned);
+char* Fmt_Fields32(char* pOut, const int32_t* pValues, uint8_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FMT_H */
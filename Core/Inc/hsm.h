@@ -0,0 +1,98 @@
+/**
+  ******************************************************************************
+  * @file           : hsm.h
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Table driven hierarchical state machine header
+  ******************************************************************************
+  * @attention
+  *
+  * Generic hierarchical state machine engine. States and their transition
+  * tables are const data, placed in flash. Each state has optional entry,
+  * exit and do actions and a parent state. An event is handled by the first
+  * state, from the current one up to the top, with a transition for it.
+  *
+  * Transition and do actions may return a follow-up event, i.e. completion
+  * or error, dispatched right away (run to completion).
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HSM_H
+#define __HSM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define HSM_EVENT_NONE      UINT32_MAX  /*!< No event, nothing to dispatch  */
+#define HSM_MAX_DEPTH       4U          /*!< Max state nesting levels       */
+
+/**
+ * @brief Number of entries of a transition table
+*/
+#define HSM_TABLE(table)    (table), (uint8_t)(sizeof(table) / sizeof((table)[0]))
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct Hsm_State Hsm_StateTypeDef;
+
+/**
+ * @brief Entry and exit actions
+*/
+typedef void (*Hsm_ActionTypeDef)(void);
+
+/**
+ * @brief Transition and do actions
+ * @param event: event handled, HSM_EVENT_NONE for do actions
+ * @retval Follow-up event, HSM_EVENT_NONE if none
+*/
+typedef uint32_t (*Hsm_HandlerTypeDef)(uint32_t event);
+
+/**
+ * @brief Transition table entry
+*/
+typedef struct
+{
+    uint32_t event;                     /*!< Triggering event                               */
+    const Hsm_StateTypeDef* pTarget;    /*!< Next state, NULL for an internal transition    */
+    Hsm_HandlerTypeDef action;          /*!< Transition action, or NULL                     */
+
+} Hsm_TransitionTypeDef;
+
+/**
+ * @brief State, to be declared const
+*/
+struct Hsm_State
+{
+    const Hsm_StateTypeDef* pParent;            /*!< Parent state, NULL at the top          */
+    Hsm_ActionTypeDef entry;                    /*!< Entry action, or NULL                  */
+    Hsm_ActionTypeDef exit;                     /*!< Exit action, or NULL                   */
+    Hsm_HandlerTypeDef run;                     /*!< Do action, or NULL to use the parent's */
+    const Hsm_TransitionTypeDef* pTransitions;  /*!< Transition table                       */
+    uint8_t transitionsLen;                     /*!< Transition table entries               */
+};
+
+/**
+ * @brief State machine handle
+*/
+typedef struct
+{
+    const Hsm_StateTypeDef* pState;     /*!< Current state, always a leaf   */
+
+} Hsm_TypeDef;
+
+/* Exported functions --------------------------------------------------------*/
+void Hsm_Init(Hsm_TypeDef* pHsm, const Hsm_StateTypeDef* pInitial);
+void Hsm_Dispatch(Hsm_TypeDef* pHsm, uint32_t event);
+void Hsm_Run(Hsm_TypeDef* pHsm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HSM_H */
@@ -18,7 +18,35 @@
 extern "C" {
 #endif
 
-#define IMU_BRIDGE_REALTIME_PERIOD  100
+#include <stdbool.h>
+#include <stdint.h>
+
+#define IMU_BRIDGE_REALTIME_PERIOD  100     /*!< Default delay paced sampling period, ms */
+#define IMU_BRIDGE_REALTIME_PERIOD_MAX 10000 /*!< Max delay paced sampling period, ms */
+#define IMU_BRIDGE_TX_LINE_SIZE     112     /*!< Reserve size for a formatted line */
+#define IMU_BRIDGE_CMD_CODE_LEN     3       /*!< Command code length               */
+#define IMU_BRIDGE_CMD_MAX_LEN      15      /*!< Max command length, with arguments */
+#define IMU_BRIDGE_RX_RING_SIZE     128     /*!< Must be a power of two            */
+#define IMU_BRIDGE_RX_IDLE_MARK     '\0'    /*!< RX line idle marker in the RX ring */
+#define IMU_BRIDGE_CMD_QUEUE_SIZE   256     /*!< Command FIFO bytes (10 commands), power of two */
+#define IMU_BRIDGE_RX_STAMP_QUEUE_SIZE 256  /*!< RX timestamps bytes (21 fragments), power of two */
+#define IMU_BRIDGE_TIMER_PERIOD_MIN 1000    /*!< Timer paced sampling period range, us (1 kHz) */
+#define IMU_BRIDGE_TIMER_PERIOD_MAX 1000000 /*!< (1 Hz)                             */
+#define IMU_BRIDGE_TIMER_PERIOD_DEF 10000   /*!< Default timer period, us (100 Hz)  */
+#define IMU_BRIDGE_RATE_ACCEL_DEF   200     /*!< Default multi-rate stream rates, Hz */
+#define IMU_BRIDGE_RATE_TEMP_DEF    1
+#define IMU_BRIDGE_RATE_GYRO_DEF    500
+
+/* Events posted by the interrupt handlers to the main loop */
+#define IMU_BRIDGE_EVENT_RX         0x01U   /*!< Bytes or line idle received       */
+#define IMU_BRIDGE_EVENT_BUS        0x02U   /*!< Sensor bus job complete           */
+#define IMU_BRIDGE_EVENT_TICK       0x04U   /*!< Sys tick, only while enabled      */
+#define IMU_BRIDGE_EVENT_FSM        0x08U   /*!< FSM work left, run again          */
+
+/**
+ * @brief Pack a 3 character command code into a 24-bit integer
+*/
+#define IMU_BRIDGE_CMD_CODE(a, b, c)    (((uint32_t)(uint8_t)(a) << 16) | ((uint32_t)(uint8_t)(b) << 8) | (uint32_t)(uint8_t)(c))
 
 /**
  * @brief IMU Bridge status
@@ -46,15 +74,36 @@ typedef enum
     IMU_BRIDGE_CMD_CFG_ACCEL_FS4,
     IMU_BRIDGE_CMD_CFG_ACCEL_FS8,
     IMU_BRIDGE_CMD_CFG_ACCEL_FS16,
+    IMU_BRIDGE_CMD_CFG_RATE_DIV,
+    IMU_BRIDGE_CMD_CFG_GYRO_DLPF,
+    IMU_BRIDGE_CMD_CFG_ACCEL_DLPF,
+    IMU_BRIDGE_CMD_CFG_RATE_QUERY,
     IMU_BRIDGE_CMD_READ_MODE,
     IMU_BRIDGE_CMD_READ_ACCEL_ALL,
     IMU_BRIDGE_CMD_READ_GYRO_ALL,
     IMU_BRIDGE_CMD_READ_TEMP,
+    IMU_BRIDGE_CMD_READ_MAG_ALL,
+    IMU_BRIDGE_CMD_READ_NINE_AXIS,
     IMU_BRIDGE_CMD_REALTIME,
     IMU_BRIDGE_CMD_REALTIME_GYRO,
     IMU_BRIDGE_CMD_REALTIME_ACCEL,
     IMU_BRIDGE_CMD_REALTIME_TEMP,
+    IMU_BRIDGE_CMD_REALTIME_ALL,
+    IMU_BRIDGE_CMD_REALTIME_NINE_AXIS,
+    IMU_BRIDGE_CMD_REALTIME_FIFO,
+    IMU_BRIDGE_CMD_REALTIME_DRDY,
+    IMU_BRIDGE_CMD_REALTIME_TIMER,
+    IMU_BRIDGE_CMD_REALTIME_QUERY,
+    IMU_BRIDGE_CMD_REALTIME_POLL,
+    IMU_BRIDGE_CMD_REALTIME_BINARY,
+    IMU_BRIDGE_CMD_REALTIME_TEXT,
+    IMU_BRIDGE_CMD_REALTIME_UNITS,
+    IMU_BRIDGE_CMD_REALTIME_ENCODER,
+    IMU_BRIDGE_CMD_REALTIME_RATE_ACCEL,
+    IMU_BRIDGE_CMD_REALTIME_RATE_TEMP,
+    IMU_BRIDGE_CMD_REALTIME_RATE_GYRO,
     IMU_BRIDGE_CMD_EXIT,
+    IMU_BRIDGE_CMD_STATS,
     IMU_BRIDGE_CMD_INVALID
 
 } IMU_Bridge_CmdTypeDef;
@@ -65,16 +114,33 @@ typedef enum
 typedef enum{
 	IMU_BRIDGE_REALTIME_GYRO,
 	IMU_BRIDGE_REALTIME_ACCEL,
-	IMU_BRIDGE_REALTIME_TEMP
+	IMU_BRIDGE_REALTIME_TEMP,
+	IMU_BRIDGE_REALTIME_ALL,
+	IMU_BRIDGE_REALTIME_NINE_AXIS
 
 } IMU_Bridge_RealTime_SelTypeDef;
 
 IMU_Bridge_StatusTypeDef IMU_Bridge_Init(void);
 IMU_Bridge_StatusTypeDef IMU_Bridge_SendString(char *pMsg);
+char* IMU_Bridge_TxReserve(uint16_t len);
+IMU_Bridge_StatusTypeDef IMU_Bridge_TxCommit(int n);
+IMU_Bridge_StatusTypeDef IMU_Bridge_TxCommitData(uint16_t size);
 IMU_Bridge_CmdTypeDef IMU_Bridge_GetCmd(void);
+IMU_Bridge_CmdTypeDef IMU_Bridge_DecodeCmd(const char* pCmd);
+IMU_Bridge_StatusTypeDef IMU_Bridge_GetCmdArg(uint32_t* pValue);
+
 
+void IMU_Bridge_RxCallback(const uint8_t* pData, uint16_t size);
+void IMU_Bridge_RxIdleCallback(void);
+void IMU_Bridge_ProcessRx(void);
 
-void IMU_Bridge_RxCallback(void);
+void IMU_Bridge_EventPost(uint32_t events);
+uint32_t IMU_Bridge_EventTake(void);
+bool IMU_Bridge_EventPending(void);
+void IMU_Bridge_EventTickEnable(bool enable);
+void IMU_Bridge_TickCallback(void);
+bool IMU_Bridge_CmdPending(void);
+void IMU_Bridge_Sleep(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,88 @@
+/**
+  ******************************************************************************
+  * @file           : imu_bridge_encoder.h
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : IMU Bridge real time output encoders header
+  ******************************************************************************
+  * @attention
+  *
+  * Real time stream output formats. Each encoder is a const table in flash
+  * and encodes a whole record, a timestamped sample of the sensors in its
+  * mask, in one call:
+  *
+  *   TEXT      legacy lines, "IMU READ:\t<tick>\t<values>..."
+  *   UNITS     signed physical units, "IMU UNITS:\t<tick>\t<values>..."
+  *   CSV       "<seq>,<tick>,<mask>,<values>...", raw int16 values
+  *   BINARY    COBS frame, int16 payload, see imu_bridge_frame.h
+  *   VARINT    COBS frame, zigzag varint payload
+  *   DELTA     COBS frames, zigzag varint of the sample to sample channel
+  *             differences, each sensor refreshed by a VARINT keyframe at
+  *             most IMU_BRIDGE_DELTA_KEY_INTERVAL records after the last
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __IMU_BRIDGE_ENCODER_H
+#define __IMU_BRIDGE_ENCODER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <stdint.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define IMU_BRIDGE_DELTA_KEY_INTERVAL   64U     /*!< Records between keyframes of a sensor, max 255 */
+
+/* Exported types ------------------------------------------------------------*/
+/**
+ * @brief Output encoders, in encoder table order
+*/
+typedef enum
+{
+    IMU_BRIDGE_ENCODER_TEXT,
+    IMU_BRIDGE_ENCODER_UNITS,
+    IMU_BRIDGE_ENCODER_CSV,
+    IMU_BRIDGE_ENCODER_BINARY,
+    IMU_BRIDGE_ENCODER_VARINT,
+    IMU_BRIDGE_ENCODER_DELTA,
+    IMU_BRIDGE_ENCODER_COUNT
+
+} IMU_Bridge_EncoderIdTypeDef;
+
+/**
+ * @brief Real time record
+*/
+typedef struct
+{
+    uint8_t mask;               /*!< IMU_Bridge_SensorTypeDef bits      */
+    uint16_t seq;               /*!< Record sequence number             */
+    tick_t tick;                /*!< Sample timestamp                   */
+    const int16_t* pValues;     /*!< Channel values, frame payload order */
+
+} IMU_Bridge_RecordTypeDef;
+
+/**
+ * @brief Output encoder
+*/
+typedef struct
+{
+    const char* pName;                                          /*!< Listed by the RTE command      */
+    uint16_t maxSize;                                           /*!< Max record size, bytes         */
+    uint16_t (*Record)(uint8_t* pOut, const IMU_Bridge_RecordTypeDef* pRecord);  /*!< Encode, returns the size */
+    void (*Reset)(void);                                        /*!< Forget the previous records, NULL if stateless */
+
+} IMU_Bridge_EncoderTypeDef;
+
+/* Exported functions --------------------------------------------------------*/
+const IMU_Bridge_EncoderTypeDef* IMU_Bridge_EncoderGet(uint32_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __IMU_BRIDGE_ENCODER_H */
@@ -0,0 +1,112 @@
+/**
+  ******************************************************************************
+  * @file           : imu_bridge_frame.h
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : IMU Bridge binary frame header
+  ******************************************************************************
+  * @attention
+  *
+  * Binary real time stream frame, all fields little endian:
+  *
+  *   | MASK | SEQ (2) | TICK (4) | PAYLOAD (2 x channels) | CRC (4) |
+  *
+  * The payload holds the int16 channels of each sensor set in MASK, in
+  * order accel X Y Z, temperature, gyro X Y Z, magnetometer X Y Z. With
+  * the VARINT bit set in MASK each channel is a zigzag varint instead: the
+  * value v mapped to (v << 1) ^ (v >> 15), then 7 bits per byte, least
+  * significant first, bit 7 set on all but the last byte.
+  *
+  * With the DELTA bit set too, TICK is a varint of the difference to the
+  * previous frame timestamp, and each channel the zigzag varint of its
+  * difference to the same channel in the previous frame holding it, both
+  * modulo 2^32 and 2^16:
+  *
+  *   | MASK | SEQ (2) | TICK DELTA (1..5) | PAYLOAD (1..3 x channels) | CRC (4) |
+  *
+  * Delta frames need the previous values, the plain VARINT frames are the
+  * keyframes. On a SEQ gap or a bad CRC a host drops all the references,
+  * timestamp included, until the next keyframe of each sensor. Varints are
+  * self delimiting, so the channels of the sensors still without reference
+  * are skipped and the others decoded.
+  *
+  * CRC is the STM32 CRC-32 (poly 0x04C11DB7, init 0xFFFFFFFF, no reflection,
+  * no final XOR) of the bytes before it, packed little endian in 32 bit
+  * words, each word fed most significant bit first, the last word padded
+  * with zero bytes.
+  *
+  * The frame is then COBS encoded and ends with a 0x00 delimiter, the only
+  * zero byte on the link. A host resyncs at the next delimiter after a lost
+  * or corrupted byte, so at most the damaged frame is dropped.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __IMU_BRIDGE_FRAME_H
+#define __IMU_BRIDGE_FRAME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define IMU_BRIDGE_FRAME_DELIMITER      0x00U
+#define IMU_BRIDGE_FRAME_VARINT         0x10U   /*!< MASK flag, zigzag varint payload */
+#define IMU_BRIDGE_FRAME_DELTA          0x20U   /*!< MASK flag, delta frame, with VARINT */
+#define IMU_BRIDGE_FRAME_SENSORS        0x0FU   /*!< MASK sensor bits               */
+#define IMU_BRIDGE_FRAME_HEADER_SIZE    7U
+#define IMU_BRIDGE_FRAME_CRC_SIZE       4U
+#define IMU_BRIDGE_FRAME_VARINT_SIZE    3U      /*!< Max bytes of an int16 varint   */
+#define IMU_BRIDGE_FRAME_DELTA_HEADER_SIZE  8U  /*!< MASK, SEQ and a 5 byte TICK varint */
+#define IMU_BRIDGE_FRAME_MAX_CHANNELS   10U
+#define IMU_BRIDGE_FRAME_RAW_SIZE(ch)   (IMU_BRIDGE_FRAME_HEADER_SIZE + 2U * (ch) + IMU_BRIDGE_FRAME_CRC_SIZE)
+#define IMU_BRIDGE_FRAME_COBS_SIZE(n)   ((n) + (n) / 254U + 2U)     /*!< Worst case, with the delimiter */
+#define IMU_BRIDGE_FRAME_MAX_SIZE       IMU_BRIDGE_FRAME_COBS_SIZE(IMU_BRIDGE_FRAME_RAW_SIZE(IMU_BRIDGE_FRAME_MAX_CHANNELS))
+#define IMU_BRIDGE_FRAME_VARINT_MAX_SIZE    IMU_BRIDGE_FRAME_COBS_SIZE(IMU_BRIDGE_FRAME_HEADER_SIZE + \
+    IMU_BRIDGE_FRAME_VARINT_SIZE * IMU_BRIDGE_FRAME_MAX_CHANNELS + IMU_BRIDGE_FRAME_CRC_SIZE)
+#define IMU_BRIDGE_FRAME_DELTA_MAX_SIZE     IMU_BRIDGE_FRAME_COBS_SIZE(IMU_BRIDGE_FRAME_DELTA_HEADER_SIZE + \
+    IMU_BRIDGE_FRAME_VARINT_SIZE * IMU_BRIDGE_FRAME_MAX_CHANNELS + IMU_BRIDGE_FRAME_CRC_SIZE)
+
+/* Exported types ------------------------------------------------------------*/
+/**
+ * @brief Sensor mask bits
+*/
+typedef enum
+{
+    IMU_BRIDGE_SENSOR_ACCEL = 0x01U,    /*!< 3 channels */
+    IMU_BRIDGE_SENSOR_TEMP  = 0x02U,    /*!< 1 channel  */
+    IMU_BRIDGE_SENSOR_GYRO  = 0x04U,    /*!< 3 channels */
+    IMU_BRIDGE_SENSOR_MAG   = 0x08U     /*!< 3 channels */
+
+} IMU_Bridge_SensorTypeDef;
+
+/**
+ * @brief Frame encoder state, COBS and CRC
+*/
+typedef struct
+{
+    uint8_t* pFrame;    /*!< Frame start                            */
+    uint8_t* pOut;      /*!< Next output byte                       */
+    uint8_t* pCode;     /*!< Code byte of the current COBS block    */
+    uint8_t code;       /*!< Current block length, plus one         */
+    uint32_t word;      /*!< CRC word being packed                  */
+    uint8_t wordBytes;  /*!< Bytes packed in the CRC word           */
+
+} IMU_Bridge_FrameEncoderTypeDef;
+
+/* Exported functions --------------------------------------------------------*/
+uint8_t IMU_Bridge_FrameChannels(uint8_t mask);
+void IMU_Bridge_FrameBegin(IMU_Bridge_FrameEncoderTypeDef* pEnc, uint8_t* pFrame, uint8_t mask, uint16_t seq, uint32_t tick);
+void IMU_Bridge_FrameBeginDelta(IMU_Bridge_FrameEncoderTypeDef* pEnc, uint8_t* pFrame, uint8_t mask, uint16_t seq, uint32_t tickDelta);
+void IMU_Bridge_FrameInt16(IMU_Bridge_FrameEncoderTypeDef* pEnc, int16_t value);
+void IMU_Bridge_FrameVarint(IMU_Bridge_FrameEncoderTypeDef* pEnc, int16_t value);
+uint16_t IMU_Bridge_FrameEnd(IMU_Bridge_FrameEncoderTypeDef* pEnc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __IMU_BRIDGE_FRAME_H */
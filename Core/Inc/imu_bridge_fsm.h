@@ -22,6 +22,7 @@ extern "C" {
 
 void IMU_Bridge_FsmInit(void);
 void IMU_Bridge_FsmUpdate(void);
+void IMU_Bridge_FsmGetStats(uint32_t* pDispatchMaxCycles);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,189 @@
+/**
+  ******************************************************************************
+  * @file           : imu_bridge_sensor.h
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : IMU Bridge sensor acquisition header
+  ******************************************************************************
+  * @attention
+  *
+  * IMU Bridge sensor acquisition, burst reads of the MPU9250 data registers
+  * and hardware FIFO streaming. The AK8963 magnetometer is read by the
+  * MPU9250 I2C master into EXT_SENS_DATA, right after the gyro registers.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __IMU_BRIDGE_SENSOR_H
+#define __IMU_BRIDGE_SENSOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "imu_bridge.h"
+#include "utils.h"
+
+#include <stdint.h>
+
+/* Defines -------------------------------------------------------------------*/
+/* MPU9250 registers */
+#define IMU_REG_SMPLRT_DIV      0x19U
+#define IMU_REG_CONFIG          0x1AU
+#define IMU_REG_GYRO_CONFIG     0x1BU
+#define IMU_REG_ACCEL_CONFIG    0x1CU
+#define IMU_REG_ACCEL_CONFIG2   0x1DU
+#define IMU_REG_FIFO_EN         0x23U
+#define IMU_REG_I2C_MST_CTRL    0x24U
+#define IMU_REG_I2C_SLV0_ADDR   0x25U   /*!< SLV0_ADDR, SLV0_REG, SLV0_CTRL         */
+#define IMU_REG_INT_PIN_CFG     0x37U
+#define IMU_REG_INT_ENABLE      0x38U
+#define IMU_REG_ACCEL_XOUT_H    0x3BU
+#define IMU_REG_TEMP_OUT_H      0x41U
+#define IMU_REG_GYRO_XOUT_H     0x43U
+#define IMU_REG_EXT_SENS_DATA   0x49U
+#define IMU_REG_I2C_SLV0_DO     0x63U
+#define IMU_REG_USER_CTRL       0x6AU
+#define IMU_REG_PWR_MGMT_1      0x6BU
+#define IMU_REG_FIFO_COUNTH     0x72U
+#define IMU_REG_FIFO_R_W        0x74U
+#define IMU_REG_WHO_AM_I        0x75U
+
+/* MPU9250 register bits */
+#define IMU_CONFIG_FIFO_MODE    0x40U   /*!< Stop writing when the FIFO is full */
+#define IMU_CONFIG_DLPF_MASK    0x07U
+#define IMU_ACCEL_CONFIG2_MASK  0x0FU   /*!< ACCEL_FCHOICE_B and A_DLPF_CFG         */
+#define IMU_FS_SEL_MASK         0x18U   /*!< GYRO_FS_SEL and ACCEL_FS_SEL           */
+#define IMU_FS_SEL_SHIFT        3U
+#define IMU_FIFO_EN_TEMP        0x80U
+#define IMU_FIFO_EN_GYRO        0x70U   /*!< Gyro X Y Z */
+#define IMU_FIFO_EN_ACCEL       0x08U
+#define IMU_USER_CTRL_FIFO_EN   0x40U
+#define IMU_USER_CTRL_FIFO_RST  0x04U
+#define IMU_USER_CTRL_I2C_IF_DIS 0x10U  /*!< SPI only, set after each reset         */
+#define IMU_USER_CTRL_I2C_MST_EN 0x20U
+#define IMU_I2C_MST_CTRL        0x4DU   /*!< WAIT_FOR_ES, 400 kHz master clock      */
+#define IMU_I2C_SLV_READ        0x80U   /*!< SLVx_ADDR read bit                     */
+#define IMU_I2C_SLV_EN          0x80U   /*!< SLVx_CTRL enable, length in low bits   */
+#define IMU_PWR_MGMT_1_H_RESET  0x80U
+#define IMU_PWR_MGMT_1_CLKSEL   0x01U   /*!< Gyro PLL clock when ready              */
+#define IMU_WHO_AM_I_MPU9250    0x71U
+#define IMU_WHO_AM_I_MPU9255    0x73U
+
+/* AK8963 magnetometer, behind the MPU9250 I2C master */
+#define IMU_MAG_ADDRESS         0x0CU
+#define IMU_MAG_REG_WIA         0x00U
+#define IMU_MAG_REG_HXL         0x03U   /*!< HXL to HZH, little endian, then ST2    */
+#define IMU_MAG_REG_CNTL1       0x0AU
+#define IMU_MAG_REG_CNTL2       0x0BU
+#define IMU_MAG_WIA             0x48U
+#define IMU_MAG_CNTL1_CONT2     0x16U   /*!< 16 bit output, 100 Hz continuous       */
+#define IMU_MAG_CNTL2_SRST      0x01U
+#define IMU_MAG_ST2_HOFL        0x08U   /*!< Magnetic sensor overflow, field invalid */
+#define IMU_MAG_READ_SIZE       7U      /*!< HXL to ST2, ST2 read ends the data hold */
+#define IMU_MAG_DELAY           10U     /*!< Wait for an I2C master transfer, ms    */
+#define IMU_INT_PIN_CFG_ANYRD   0x10U   /*!< Active high push pull 50 us pulse, clear on any read */
+#define IMU_INT_ENABLE_RAW_RDY  0x01U
+
+#define IMU_SAMPLE_SIZE         14U     /*!< ACCEL_XOUT_H to GYRO_ZOUT_L            */
+#define IMU_SAMPLE_MAG_SIZE     21U     /*!< ACCEL_XOUT_H to EXT_SENS_DATA_06, ST2  */
+#define IMU_SENSOR_COUNT        4U      /*!< Accel, temp, gyro, mag in burst order  */
+#define IMU_FIFO_SENSORS        0x07U   /*!< Sensors the FIFO takes, mag left out   */
+#define IMU_RESET_DELAY         100U    /*!< Device reset time, ms                  */
+#define IMU_FIFO_SIZE           512U    /*!< MPU9250 FIFO size                      */
+#define IMU_FIFO_COUNT_MASK     0x1FFFU /*!< FIFO_COUNT is 13 bit                   */
+#define IMU_FIFO_BURST_SIZE     252U    /*!< Max bytes drained per bus transaction  */
+#define IMU_FIFO_POLL_MS        10U     /*!< FIFO_COUNT read period, 10 frames at 1 kHz */
+#define IMU_DLPF_CFG            0x01U   /*!< 1 kHz internal rate, 184 Hz bandwidth  */
+#define IMU_DLPF_CFG_MIN        0x01U   /*!< Gyro DLPF_CFG range with a 1 kHz rate, */
+#define IMU_DLPF_CFG_MAX        0x06U   /*!< 0 and 7 run at 8 kHz, too fast to read */
+#define IMU_ACCEL_DLPF_CFG      0x00U   /*!< 1 kHz rate, 218 Hz bandwidth (reset)   */
+#define IMU_ACCEL_DLPF_CFG_MAX  0x07U
+#define IMU_INTERNAL_RATE       1000U   /*!< Internal sample rate, Hz               */
+#define IMU_SHADOW_FIRST        IMU_REG_SMPLRT_DIV  /*!< Configuration registers cached */
+#define IMU_SHADOW_SIZE         5U                  /*!< SMPLRT_DIV to ACCEL_CONFIG2    */
+#define IMU_GYRO_FS_MIN         250U    /*!< Gyro full scale, dps, 250 << FS_SEL    */
+#define IMU_ACCEL_FS_MIN        2U      /*!< Accel full scale, g, 2 << FS_SEL       */
+#define IMU_FIFO_SMPLRT_DIV     0x00U   /*!< FIFO rate 1 kHz / (1 + div)            */
+#define IMU_DRDY_SMPLRT_DIV     0x09U   /*!< Data ready rate 1 kHz / (1 + div)      */
+#define IMU_TIMER_SMPLRT_DIV    0x00U   /*!< Sensor rate when paced by the timer    */
+#define IMU_MULTI_CHANNELS      3U      /*!< Multi-rate channels: accel, temp, gyro */
+#define IMU_MULTI_TICK_US       1000U   /*!< Multi-rate scheduler period            */
+#define IMU_MULTI_RATE_MAX      (1000000U / IMU_MULTI_TICK_US)  /*!< Max channel rate, Hz */
+
+/* Raw to unit scale factors, unit = (raw x scale) >> IMU_SCALE_SHIFT, rounded */
+#define IMU_SCALE_SHIFT         15U     /*!< Raw full scale is 32768                */
+#define IMU_TEMP_SCALE          9815    /*!< 0.01 degC, 100 / 333.87 LSB/degC       */
+#define IMU_TEMP_OFFSET         2100    /*!< 0.01 degC, 21 degC at raw 0            */
+#define IMU_MAG_SCALE           (150L << IMU_SCALE_SHIFT)   /*!< nT, 0.15 uT/LSB    */
+
+/* Exported types ------------------------------------------------------------*/
+/**
+ * @brief Coherent sample of all channels, read in a single burst
+*/
+typedef struct
+{
+    int16_t accel[3];       /*!< Accelerometer X Y Z, raw   */
+    int16_t temp;           /*!< Temperature, raw           */
+    int16_t gyro[3];        /*!< Gyroscope X Y Z, raw       */
+    int16_t mag[3];         /*!< Magnetometer X Y Z, raw    */
+    tick_t tick;            /*!< Sample timestamp           */
+    uint8_t mask;           /*!< Sensors read in the burst  */
+
+} IMU_Bridge_SampleTypeDef;
+
+/**
+ * @brief Output data rate and bandwidth configuration
+*/
+typedef struct
+{
+    uint8_t rateDiv;        /*!< SMPLRT_DIV, rate is 1 kHz / (1 + div)          */
+    uint8_t gyroDlpf;       /*!< CONFIG DLPF_CFG, gyro and temperature filter   */
+    uint8_t accelDlpf;      /*!< ACCEL_CONFIG2 A_DLPF_CFG, accel filter         */
+    bool_t rateSet;         /*!< rateDiv set, else each mode uses its default   */
+
+} IMU_Bridge_FilterTypeDef;
+
+/* Exported functions --------------------------------------------------------*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_SensorInit(void);
+IMU_Bridge_StatusTypeDef IMU_Bridge_SensorCheck(void);
+IMU_Bridge_StatusTypeDef IMU_Bridge_SensorRead(uint8_t mask, IMU_Bridge_SampleTypeDef* pSample);
+bool_t IMU_Bridge_MagIsReady(void);
+IMU_Bridge_StatusTypeDef IMU_Bridge_SampleFetch(void);
+IMU_Bridge_StatusTypeDef IMU_Bridge_SampleFetchMask(uint8_t mask);
+bool_t IMU_Bridge_SampleRead(IMU_Bridge_SampleTypeDef* pSample);
+void IMU_Bridge_SampleGetStats(uint32_t* pMinPeriod, uint32_t* pMaxPeriod, uint32_t* pMissed);
+void IMU_Bridge_SampleResetStats(void);
+IMU_Bridge_StatusTypeDef IMU_Bridge_DrdyStart(void);
+IMU_Bridge_StatusTypeDef IMU_Bridge_DrdyStop(void);
+void IMU_Bridge_DrdyCallback(void);
+IMU_Bridge_StatusTypeDef IMU_Bridge_TimerStart(uint32_t periodUs);
+IMU_Bridge_StatusTypeDef IMU_Bridge_TimerStop(void);
+void IMU_Bridge_TimerCallback(void);
+IMU_Bridge_StatusTypeDef IMU_Bridge_MultiStart(const uint16_t* pRates);
+IMU_Bridge_StatusTypeDef IMU_Bridge_MultiStop(void);
+IMU_Bridge_StatusTypeDef IMU_Bridge_FifoStart(uint8_t mask);
+IMU_Bridge_StatusTypeDef IMU_Bridge_FifoStop(void);
+IMU_Bridge_StatusTypeDef IMU_Bridge_FifoUpdate(void);
+bool_t IMU_Bridge_FifoRead(int16_t* pValues, tick_t* pTick);
+void IMU_Bridge_FifoGetStats(uint32_t* pOverflow, uint32_t* pBursts);
+IMU_Bridge_StatusTypeDef IMU_Bridge_ShadowLoad(void);
+uint8_t IMU_Bridge_ShadowGet(uint8_t reg);
+void IMU_Bridge_ShadowModify(uint8_t reg, uint8_t clear, uint8_t set);
+IMU_Bridge_StatusTypeDef IMU_Bridge_ShadowFlush(void);
+IMU_Bridge_StatusTypeDef IMU_Bridge_GyroSetFullScale(uint8_t fsSel);
+IMU_Bridge_StatusTypeDef IMU_Bridge_AccelSetFullScale(uint8_t fsSel);
+void IMU_Bridge_GetFullScale(uint16_t* pGyroDps, uint16_t* pAccelG);
+void IMU_Bridge_ScaleValues(uint8_t mask, const int16_t* pValues, int32_t* pUnits);
+bool_t IMU_Bridge_FilterCheck(const IMU_Bridge_FilterTypeDef* pFilter);
+IMU_Bridge_StatusTypeDef IMU_Bridge_FilterSet(const IMU_Bridge_FilterTypeDef* pFilter);
+void IMU_Bridge_FilterGet(IMU_Bridge_FilterTypeDef* pFilter, uint8_t* pRateDiv);
+uint16_t IMU_Bridge_FilterGyroBandwidth(uint8_t dlpf);
+uint16_t IMU_Bridge_FilterAccelBandwidth(uint8_t dlpf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __IMU_BRIDGE_SENSOR_H */
@@ -0,0 +1,39 @@
+/**
+  ******************************************************************************
+  * @file           : port_crc.h
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : IMU Bridge CRC port header
+  ******************************************************************************
+  * @attention
+  *
+  * IMU Bridge CRC port header, hardware independant. CRC-32 with polynomial
+  * 0x04C11DB7, initial value 0xFFFFFFFF, no reflection and no final XOR,
+  * fed one 32 bit word at a time, most significant bit first.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PORT_CRC_H
+#define __PORT_CRC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "imu_bridge.h"
+
+#include <stdint.h>
+
+/* Exported functions --------------------------------------------------------*/
+IMU_Bridge_StatusTypeDef CRC32_Init(void);
+void CRC32_Reset(void);
+void CRC32_Feed(uint32_t word);
+uint32_t CRC32_Get(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PORT_CRC_H */
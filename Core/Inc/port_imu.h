@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * @file           : port_imu.h
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : IMU Bridge sensor bus port header
+  ******************************************************************************
+  * @attention
+  *
+  * IMU Bridge sensor bus port header, hardware independant.
+  * Register level access to the MPU9250 over a bus job queue: each job starts
+  * right from the completion interrupt of the previous one. The acquisition
+  * reads are queued from the interrupt handlers. The configuration reads and
+  * writes are queued too, in order with the acquisition, and waited for.
+  * The job queue is bus independant, the transfers go through the bus port
+  * chosen at build time: port_imu_i2c.c, or port_imu_spi.c with
+  * IMU_PORT_BUS_SPI defined.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PORT_IMU_H
+#define __PORT_IMU_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "imu_bridge.h"
+#include "utils.h"
+
+#include <stdint.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define IMU_PORT_I2C_ADDRESS    (0x68U << 1)    /*!< MPU9250 address, AD0 low   */
+#define IMU_PORT_SPI_READ       0x80U           /*!< SPI register read bit      */
+#define IMU_PORT_SPI_MAX_SIZE   256U            /*!< Max bytes per SPI transfer */
+#define IMU_PORT_TIMEOUT        10U             /*!< Blocking access timeout ms */
+#define IMU_PORT_JOB_QUEUE_SIZE 8U              /*!< Bus jobs, power of two     */
+#define IMU_PORT_WRITE_MAX_SIZE 16U             /*!< Max bytes per register write */
+#define IMU_PORT_READ_MAX_SIZE  32U             /*!< Max bytes per register read  */
+
+/* Exported types ------------------------------------------------------------*/
+/**
+ * @brief Bus job completion callback, called from the interrupt handler
+*/
+typedef void (*IMU_Port_JobCallbackTypeDef)(IMU_Bridge_StatusTypeDef status);
+
+/**
+ * @brief Bus job, consecutive registers read or write
+*/
+typedef struct
+{
+    uint8_t reg;                            /*!< First register                     */
+    bool_t write;                           /*!< Register write, else read          */
+    uint8_t* pData;                         /*!< Data, kept valid until completion  */
+    uint16_t size;                          /*!< Bytes                              */
+    IMU_Port_JobCallbackTypeDef callback;   /*!< Completion callback, may be NULL   */
+
+} IMU_Port_JobTypeDef;
+
+/* Exported functions --------------------------------------------------------*/
+IMU_Bridge_StatusTypeDef IMU_Port_Init(void);
+IMU_Bridge_StatusTypeDef IMU_Port_Read(uint8_t reg, uint8_t* pData, uint16_t size);
+IMU_Bridge_StatusTypeDef IMU_Port_Write(uint8_t reg, const uint8_t* pData, uint16_t size);
+bool_t IMU_Port_IsBusy(void);
+IMU_Bridge_StatusTypeDef IMU_Port_Submit(const IMU_Port_JobTypeDef* pJob);
+void IMU_Port_GetStats(uint32_t* pJobs, uint32_t* pErrors, uint32_t* pQueueMax, uint64_t* pBusyCycles);
+void IMU_Port_IRQHandler(void);
+
+/* Bus port, implemented by the bus chosen at build time */
+IMU_Bridge_StatusTypeDef IMU_Port_BusInit(void);
+IMU_Bridge_StatusTypeDef IMU_Port_BusStart(const IMU_Port_JobTypeDef* pJob);
+bool_t IMU_Port_BusIsReady(void);
+IMU_Bridge_StatusTypeDef IMU_Port_BusResult(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PORT_IMU_H */
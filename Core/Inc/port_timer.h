@@ -0,0 +1,40 @@
+/**
+  ******************************************************************************
+  * @file           : port_timer.h
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : IMU Bridge sample timer port header
+  ******************************************************************************
+  * @attention
+  *
+  * IMU Bridge sample timer port header, hardware independant.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PORT_TIMER_H
+#define __PORT_TIMER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "imu_bridge.h"
+
+#include <stdint.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define TIMER_TICK_HZ       1000000U    /*!< Timer resolution, 1 us         */
+#define TIMER_MAX_STEP      0x8000U     /*!< Max compare step, 16 bit timer */
+
+/* Exported functions --------------------------------------------------------*/
+IMU_Bridge_StatusTypeDef Timer_Init(void);
+IMU_Bridge_StatusTypeDef Timer_Start(uint32_t periodUs);
+IMU_Bridge_StatusTypeDef Timer_Stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PORT_TIMER_H */
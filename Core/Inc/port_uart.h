@@ -26,13 +26,22 @@ extern "C" {
 #include <stdint.h>
 
 /* Defines -------------------------------------------------------------------*/
-#define UART_BUFFER_SIZE    3
+#define UART_RX_BUFFER_SIZE 64
+#define UART_TX_BUFFER_SIZE 512     /*!< Must be a power of two */
 
 /* Exported functions --------------------------------------------------------*/
 IMU_Bridge_StatusTypeDef UART_Init(void);
 IMU_Bridge_StatusTypeDef UART_Transmit(uint8_t* pData, uint16_t size);
-void UART_ReadRxBuffer(uint8_t* pData);
+uint8_t* UART_TxReserve(uint16_t size);
+void UART_TxCommit(uint16_t size);
+void UART_RxIRQHandler(void);
+void UART_TxIRQHandler(void);
+void UART_GetTxStats(uint32_t* pHighWater, uint32_t* pOverflow);
+void UART_GetRxStats(uint32_t* pIsrMaxCycles);
 tick_t Sys_GetTick(void);
+uint32_t Sys_GetCycles(void);
+uint32_t Sys_CyclesToUs(uint32_t cycles);
+void Sys_Sleep(void);
 
 #ifdef __cplusplus
 }
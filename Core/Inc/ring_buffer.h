@@ -0,0 +1,71 @@
+/**
+  ******************************************************************************
+  * @file           : ring_buffer.h
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Lock-free SPSC byte ring buffer header
+  ******************************************************************************
+  * @attention
+  *
+  * Single producer / single consumer byte ring buffer. The producer and the
+  * consumer may run in different contexts (main loop and ISR) without
+  * critical sections. Size must be a power of two.
+  *
+  * Besides plain writes, the producer can reserve a contiguous region, fill
+  * it in place and commit it. If the region doesn't fit before the end of
+  * the storage, the tail end is skipped and the consumer jumps over it.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RING_BUFFER_H
+#define __RING_BUFFER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/* Exported types ------------------------------------------------------------*/
+/**
+ * @brief Ring buffer handle
+ * @note head and tail are free running indexes, masked on access
+*/
+typedef struct
+{
+    uint8_t *pBuffer;           /*!< Buffer storage                             */
+    uint32_t size;              /*!< Storage size, power of two                 */
+    _Atomic uint32_t head;      /*!< Write index, owned by the producer         */
+    _Atomic uint32_t tail;      /*!< Read index, owned by the consumer          */
+    _Atomic uint32_t wrap;      /*!< Index where the producer skipped to the
+                                     start of the storage                       */
+    uint32_t reserved;          /*!< Bytes reserved by the producer             */
+    uint32_t reservedSkip;      /*!< Bytes skipped by the current reservation   */
+    uint32_t highWater;         /*!< Max bytes used at once                     */
+    uint32_t overflow;          /*!< Writes dropped for lack of space           */
+
+} RingBuffer_TypeDef;
+
+/* Exported functions --------------------------------------------------------*/
+bool RingBuffer_Init(RingBuffer_TypeDef *pRing, uint8_t *pBuffer, uint32_t size);
+uint32_t RingBuffer_Used(RingBuffer_TypeDef *pRing);
+uint32_t RingBuffer_Free(RingBuffer_TypeDef *pRing);
+
+/* Producer side */
+bool RingBuffer_Write(RingBuffer_TypeDef *pRing, const uint8_t *pData, uint32_t size);
+uint8_t* RingBuffer_Reserve(RingBuffer_TypeDef *pRing, uint32_t size);
+void RingBuffer_Commit(RingBuffer_TypeDef *pRing, uint32_t size);
+
+/* Consumer side */
+uint32_t RingBuffer_Peek(RingBuffer_TypeDef *pRing, uint8_t **ppData);
+void RingBuffer_Consume(RingBuffer_TypeDef *pRing, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RING_BUFFER_H */
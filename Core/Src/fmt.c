@@ -0,0 +1,156 @@
+/**
+  ******************************************************************************
+  * @file           : fmt.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Integer text formatter
+  ******************************************************************************
+  * @attention
+  *
+  * Integer text formatter. Decimals are written two digits at a time from a
+  * digit pair table, one division by 100 per pair, straight to their final
+  * place once the digit count is known. Output matches printf "%u", "%d"
+  * and "%0*X".
+  *
+  ******************************************************************************
+  */
+
+#include "fmt.h"
+
+#include <assert.h>
+
+/* "00" to "99", the two digits of n at [2n] and [2n + 1] */
+static const char pDigitPairs[200] =
+{
+    '0','0','0','1','0','2','0','3','0','4','0','5','0','6','0','7','0','8','0','9',
+    '1','0','1','1','1','2','1','3','1','4','1','5','1','6','1','7','1','8','1','9',
+    '2','0','2','1','2','2','2','3','2','4','2','5','2','6','2','7','2','8','2','9',
+    '3','0','3','1','3','2','3','3','3','4','3','5','3','6','3','7','3','8','3','9',
+    '4','0','4','1','4','2','4','3','4','4','4','5','4','6','4','7','4','8','4','9',
+    '5','0','5','1','5','2','5','3','5','4','5','5','5','6','5','7','5','8','5','9',
+    '6','0','6','1','6','2','6','3','6','4','6','5','6','6','6','7','6','8','6','9',
+    '7','0','7','1','7','2','7','3','7','4','7','5','7','6','7','7','7','8','7','9',
+    '8','0','8','1','8','2','8','3','8','4','8','5','8','6','8','7','8','8','8','9',
+    '9','0','9','1','9','2','9','3','9','4','9','5','9','6','9','7','9','8','9','9'
+};
+
+static const char pHexDigits[16] =
+{
+    '0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F'
+};
+
+/**
+ * @brief Number of decimal digits of a value
+*/
+static uint8_t Fmt_Digits(uint32_t value)
+{
+    uint8_t digits = 1;
+
+    while (value >= 10000U) { value /= 10000U; digits += 4; }
+    if (value >= 1000U) return digits + 3;
+    if (value >= 100U) return digits + 2;
+    if (value >= 10U) return digits + 1;
+    return digits;
+}
+
+/**
+ * @brief Copy a string, without the terminating null
+*/
+char* Fmt_Str(char* pOut, const char* pStr)
+{
+    assert(pOut && pStr);
+
+    while (*pStr != '\0') *pOut++ = *pStr++;
+    return pOut;
+}
+
+/**
+ * @brief   Unsigned decimal, as "%u"
+ * @param   pOut: output, FMT_UINT32_MAX_LEN bytes
+*/
+char* Fmt_Uint32(char* pOut, uint32_t value)
+{
+    char* pEnd = pOut + Fmt_Digits(value);
+    char* p = pEnd;
+    uint32_t pair;
+
+    while (value >= 100U)
+    {
+        pair = (value % 100U) * 2U;
+        value /= 100U;
+        *--p = pDigitPairs[pair + 1U];
+        *--p = pDigitPairs[pair];
+    }
+    if (value >= 10U)
+    {
+        *--p = pDigitPairs[value * 2U + 1U];
+        *--p = pDigitPairs[value * 2U];
+    }
+    else
+    {
+        *--p = (char)('0' + value);
+    }
+    return pEnd;
+}
+
+/**
+ * @brief   Signed decimal, as "%d"
+ * @param   pOut: output, FMT_INT32_MAX_LEN bytes
+*/
+char* Fmt_Int32(char* pOut, int32_t value)
+{
+    if (value < 0)
+    {
+        *pOut++ = '-';
+        return Fmt_Uint32(pOut, 0U - (uint32_t)value);
+    }
+    return Fmt_Uint32(pOut, (uint32_t)value);
+}
+
+/**
+ * @brief   Fixed width upper case hexadecimal, as "%0*X"
+ * @param   digits: 1 to 8, the high digits beyond are dropped
+*/
+char* Fmt_Hex(char* pOut, uint32_t value, uint8_t digits)
+{
+    assert(digits >= 1U && digits <= 8U);
+
+    for (uint8_t i = digits; i > 0; i--)
+    {
+        pOut[i - 1U] = pHexDigits[value & 0x0FU];
+        value >>= 4;
+    }
+    return pOut + digits;
+}
+
+/**
+ * @brief   Tab separated int16 fields, each as "\t%d"
+ * @param   pOut: output, count x FMT_FIELD_MAX_LEN bytes
+ * @param   asUnsigned: print the raw uint16 bits, as "\t%u"
+*/
+char* Fmt_Fields(char* pOut, const int16_t* pValues, uint8_t count, bool asUnsigned)
+{
+    assert(pValues || count == 0);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        *pOut++ = '\t';
+        pOut = asUnsigned ? Fmt_Uint32(pOut, (uint16_t)pValues[i]) : Fmt_Int32(pOut, pValues[i]);
+    }
+    return pOut;
+}
+
+/**
+ * @brief   Tab separated int32 fields, each as "\t%ld"
+ * @param   pOut: output, count x FMT_FIELD32_MAX_LEN bytes
+*/
+char* Fmt_Fields32(char* pOut, const int32_t* pValues, uint8_t count)
+{
+    assert(pValues || count == 0);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        *pOut++ = '\t';
+        pOut = Fmt_Int32(pOut, pValues[i]);
+    }
+    return pOut;
+}
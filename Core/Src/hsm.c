@@ -0,0 +1,135 @@
+/**
+  ******************************************************************************
+  * @file           : hsm.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Table driven hierarchical state machine
+  ******************************************************************************
+  * @attention
+  *
+  * Generic hierarchical state machine engine. Dispatch cost only depends on
+  * the nesting depth and the size of the tables walked, not on the number
+  * of states.
+  *
+  ******************************************************************************
+  */
+
+#include "hsm.h"
+
+#include <assert.h>
+
+static uint32_t Hsm_Transition(Hsm_TypeDef* pHsm, const Hsm_TransitionTypeDef* pTransition, uint32_t event);
+
+/**
+ * @brief   Init the state machine and enter the initial state
+ * @param   pInitial: initial state, entered from the top
+*/
+void Hsm_Init(Hsm_TypeDef* pHsm, const Hsm_StateTypeDef* pInitial)
+{
+    const Hsm_StateTypeDef* pPath[HSM_MAX_DEPTH];
+    uint8_t depth = 0;
+
+    assert(pHsm && pInitial);
+
+    for (const Hsm_StateTypeDef* pState = pInitial; pState != NULL; pState = pState->pParent)
+    {
+        assert(depth < HSM_MAX_DEPTH);
+        pPath[depth++] = pState;
+    }
+    while (depth > 0)
+    {
+        depth--;
+        if (pPath[depth]->entry != NULL) pPath[depth]->entry();
+    }
+    pHsm->pState = pInitial;
+}
+
+/**
+ * @brief   Dispatch an event, and the follow-up events it produces
+*/
+void Hsm_Dispatch(Hsm_TypeDef* pHsm, uint32_t event)
+{
+    assert(pHsm && pHsm->pState);
+
+    while (event != HSM_EVENT_NONE)
+    {
+        const Hsm_TransitionTypeDef* pFound = NULL;
+
+        for (const Hsm_StateTypeDef* pState = pHsm->pState; pState != NULL && pFound == NULL; pState = pState->pParent)
+        {
+            for (uint8_t i = 0; i < pState->transitionsLen; i++)
+            {
+                if (pState->pTransitions[i].event == event)
+                {
+                    pFound = &pState->pTransitions[i];
+                    break;
+                }
+            }
+        }
+        event = (pFound != NULL) ? Hsm_Transition(pHsm, pFound, event) : HSM_EVENT_NONE;
+    }
+}
+
+/**
+ * @brief   Run the do action of the current state, or the closest parent's
+*/
+void Hsm_Run(Hsm_TypeDef* pHsm)
+{
+    assert(pHsm && pHsm->pState);
+
+    for (const Hsm_StateTypeDef* pState = pHsm->pState; pState != NULL; pState = pState->pParent)
+    {
+        if (pState->run != NULL)
+        {
+            Hsm_Dispatch(pHsm, pState->run(HSM_EVENT_NONE));
+            return;
+        }
+    }
+}
+
+/**
+ * @brief   Take a transition: exit up to the common ancestor, run the
+ *          action, enter down to the target
+ * @param   event: event that triggered the transition
+ * @retval  Follow-up event from the action
+*/
+static uint32_t Hsm_Transition(Hsm_TypeDef* pHsm, const Hsm_TransitionTypeDef* pTransition, uint32_t event)
+{
+    const Hsm_StateTypeDef* pPath[HSM_MAX_DEPTH];
+    const Hsm_StateTypeDef* pTarget = pTransition->pTarget;
+    const Hsm_StateTypeDef* pState;
+    uint8_t depth = 0;
+
+    /* Internal transition, no state change */
+    if (pTarget == NULL) return (pTransition->action != NULL) ? pTransition->action(event) : HSM_EVENT_NONE;
+
+    /* Target path up to the top, the common ancestor is the first state of
+       the current path found in it. A transition to the current state, or
+       to one of its parents, exits and enters it again. */
+    for (pState = pTarget; pState != NULL; pState = pState->pParent)
+    {
+        assert(depth < HSM_MAX_DEPTH);
+        pPath[depth++] = pState;
+    }
+
+    for (pState = pHsm->pState; pState != NULL; pState = pState->pParent)
+    {
+        uint8_t i;
+        for (i = 0; i < depth && pPath[i] != pState; i++);
+        if (i < depth && pState != pTarget)
+        {
+            depth = i;
+            break;
+        }
+        if (pState->exit != NULL) pState->exit();
+    }
+
+    event = (pTransition->action != NULL) ? pTransition->action(event) : HSM_EVENT_NONE;
+
+    while (depth > 0)
+    {
+        depth--;
+        if (pPath[depth]->entry != NULL) pPath[depth]->entry();
+    }
+    pHsm->pState = pTarget;
+    return event;
+}
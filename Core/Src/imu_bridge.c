@@ -12,12 +12,128 @@
   */
 
 #include "imu_bridge.h"
+#include "imu_bridge_fsm.h"
+#include "imu_bridge_sensor.h"
+#include "port_crc.h"
+#include "port_imu.h"
+#include "port_timer.h"
 #include "port_uart.h"
+#include "ring_buffer.h"
 
+#include <assert.h>
 #include <stdio.h>
 #include <string.h>
 
-uint8_t pCmdBuffer[4] = {'0', '0', '0', '\0'};
+/**
+ * @brief Received command, as queued in the command FIFO
+*/
+typedef struct
+{
+    char cmd[IMU_BRIDGE_CMD_MAX_LEN + 1];   /*!< Command string                     */
+    tick_t tick;                            /*!< Receive timestamp                  */
+    uint32_t cycles;                        /*!< Receive timestamp, CPU cycles      */
+
+} IMU_Bridge_CmdEntryTypeDef;
+
+/**
+ * @brief Receive timestamp of an RX fragment, queued in order with the bytes
+*/
+typedef struct
+{
+    uint32_t end;                           /*!< RX ring index past its last byte   */
+    tick_t tick;                            /*!< Receive timestamp                  */
+    uint32_t cycles;                        /*!< Receive timestamp, CPU cycles      */
+
+} IMU_Bridge_RxStampTypeDef;
+
+static uint16_t txReserved = 0;
+
+static uint8_t pCmdStorage[IMU_BRIDGE_CMD_QUEUE_SIZE];  /*!< Command FIFO storage       */
+static RingBuffer_TypeDef cmdQueue;                 /*!< Command FIFO, RX to FSM            */
+static uint32_t cmdMaxLatency = 0;                  /*!< Worst case receive to decode, us   */
+static char pCmdArg[IMU_BRIDGE_CMD_MAX_LEN + 1];    /*!< Arguments of the last command      */
+
+static uint8_t pRxStorage[IMU_BRIDGE_RX_RING_SIZE]; /*!< RX ring storage                    */
+static RingBuffer_TypeDef rxRing;                   /*!< RX ring, UART ISR to main loop     */
+static uint8_t pRxStampStorage[IMU_BRIDGE_RX_STAMP_QUEUE_SIZE]; /*!< RX timestamps storage  */
+static RingBuffer_TypeDef rxStampQueue;             /*!< RX fragment timestamps, in order   */
+static IMU_Bridge_RxStampTypeDef rxStamp;           /*!< Timestamp of the last byte handled */
+static uint32_t rxProcessMaxCycles = 0;             /*!< Worst case RX processing time      */
+
+static char pRxLine[IMU_BRIDGE_CMD_MAX_LEN + 1];    /*!< Command being assembled            */
+static uint8_t rxLineLen = 0;                       /*!< Command length so far              */
+static bool rxLineOverflow = false;                 /*!< Command too long, discard it       */
+static bool rxDelimited = false;                    /*!< Host ends commands with delimiters */
+
+static _Atomic uint32_t eventsPending = 0;          /*!< Events posted, not yet handled     */
+static volatile bool eventTickEnabled = false;      /*!< Post an event on every sys tick    */
+static uint32_t busyStart = 0;                      /*!< Cycles at the last wake up         */
+static uint64_t busyCycles = 0;                     /*!< Cycles awake since the stats read  */
+static tick_t busyWindowStart = 0;                  /*!< Tick at the stats read             */
+
+/**
+ * @brief Command table entry
+*/
+typedef struct
+{
+    uint32_t code;                          /*!< Packed command code                */
+    IMU_Bridge_CmdTypeDef cmd;              /*!< Command                            */
+
+} IMU_Bridge_CmdTableEntryTypeDef;
+
+/**
+ * @brief Command table, binary searched by IMU_Bridge_DecodeCmd()
+ * @note Must be kept sorted by code, i.e. in ASCII order
+*/
+static const IMU_Bridge_CmdTableEntryTypeDef cmdTable[] =
+{
+    { IMU_BRIDGE_CMD_CODE('A', 'A', 'W'), IMU_BRIDGE_CMD_READ_ACCEL_ALL   },
+    { IMU_BRIDGE_CMD_CODE('C', 'A', '1'), IMU_BRIDGE_CMD_CFG_ACCEL_FS2    },
+    { IMU_BRIDGE_CMD_CODE('C', 'A', '2'), IMU_BRIDGE_CMD_CFG_ACCEL_FS4    },
+    { IMU_BRIDGE_CMD_CODE('C', 'A', '3'), IMU_BRIDGE_CMD_CFG_ACCEL_FS8    },
+    { IMU_BRIDGE_CMD_CODE('C', 'A', '4'), IMU_BRIDGE_CMD_CFG_ACCEL_FS16   },
+    { IMU_BRIDGE_CMD_CODE('C', 'A', 'F'), IMU_BRIDGE_CMD_CFG_ACCEL_DLPF   },
+    { IMU_BRIDGE_CMD_CODE('C', 'F', 'G'), IMU_BRIDGE_CMD_CONFIG           },
+    { IMU_BRIDGE_CMD_CODE('C', 'G', '1'), IMU_BRIDGE_CMD_CFG_GYRO_FS250   },
+    { IMU_BRIDGE_CMD_CODE('C', 'G', '2'), IMU_BRIDGE_CMD_CFG_GYRO_FS500   },
+    { IMU_BRIDGE_CMD_CODE('C', 'G', '3'), IMU_BRIDGE_CMD_CFG_GYRO_FS1000  },
+    { IMU_BRIDGE_CMD_CODE('C', 'G', '4'), IMU_BRIDGE_CMD_CFG_GYRO_FS2000  },
+    { IMU_BRIDGE_CMD_CODE('C', 'G', 'F'), IMU_BRIDGE_CMD_CFG_GYRO_DLPF    },
+    { IMU_BRIDGE_CMD_CODE('C', 'R', 'Q'), IMU_BRIDGE_CMD_CFG_RATE_QUERY   },
+    { IMU_BRIDGE_CMD_CODE('C', 'S', 'D'), IMU_BRIDGE_CMD_CFG_RATE_DIV     },
+    { IMU_BRIDGE_CMD_CODE('E', 'X', 'T'), IMU_BRIDGE_CMD_EXIT             },
+    { IMU_BRIDGE_CMD_CODE('G', 'A', 'W'), IMU_BRIDGE_CMD_READ_GYRO_ALL    },
+    { IMU_BRIDGE_CMD_CODE('I', 'N', 'T'), IMU_BRIDGE_CMD_INIT             },
+    { IMU_BRIDGE_CMD_CODE('M', 'A', 'W'), IMU_BRIDGE_CMD_READ_MAG_ALL     },
+    { IMU_BRIDGE_CMD_CODE('N', 'A', 'W'), IMU_BRIDGE_CMD_READ_NINE_AXIS   },
+    { IMU_BRIDGE_CMD_CODE('R', 'D', 'M'), IMU_BRIDGE_CMD_READ_MODE        },
+    { IMU_BRIDGE_CMD_CODE('R', 'R', 'A'), IMU_BRIDGE_CMD_REALTIME_RATE_ACCEL },
+    { IMU_BRIDGE_CMD_CODE('R', 'R', 'G'), IMU_BRIDGE_CMD_REALTIME_RATE_GYRO  },
+    { IMU_BRIDGE_CMD_CODE('R', 'R', 'T'), IMU_BRIDGE_CMD_REALTIME_RATE_TEMP  },
+    { IMU_BRIDGE_CMD_CODE('R', 'T', 'A'), IMU_BRIDGE_CMD_REALTIME_ACCEL   },
+    { IMU_BRIDGE_CMD_CODE('R', 'T', 'B'), IMU_BRIDGE_CMD_REALTIME_BINARY  },
+    { IMU_BRIDGE_CMD_CODE('R', 'T', 'C'), IMU_BRIDGE_CMD_REALTIME_ALL     },
+    { IMU_BRIDGE_CMD_CODE('R', 'T', 'E'), IMU_BRIDGE_CMD_REALTIME_ENCODER },
+    { IMU_BRIDGE_CMD_CODE('R', 'T', 'F'), IMU_BRIDGE_CMD_REALTIME_FIFO    },
+    { IMU_BRIDGE_CMD_CODE('R', 'T', 'G'), IMU_BRIDGE_CMD_REALTIME_GYRO    },
+    { IMU_BRIDGE_CMD_CODE('R', 'T', 'I'), IMU_BRIDGE_CMD_REALTIME_DRDY    },
+    { IMU_BRIDGE_CMD_CODE('R', 'T', 'M'), IMU_BRIDGE_CMD_REALTIME         },
+    { IMU_BRIDGE_CMD_CODE('R', 'T', 'N'), IMU_BRIDGE_CMD_REALTIME_NINE_AXIS },
+    { IMU_BRIDGE_CMD_CODE('R', 'T', 'P'), IMU_BRIDGE_CMD_REALTIME_POLL    },
+    { IMU_BRIDGE_CMD_CODE('R', 'T', 'Q'), IMU_BRIDGE_CMD_REALTIME_QUERY   },
+    { IMU_BRIDGE_CMD_CODE('R', 'T', 'S'), IMU_BRIDGE_CMD_REALTIME_TIMER   },
+    { IMU_BRIDGE_CMD_CODE('R', 'T', 'T'), IMU_BRIDGE_CMD_REALTIME_TEMP    },
+    { IMU_BRIDGE_CMD_CODE('R', 'T', 'U'), IMU_BRIDGE_CMD_REALTIME_UNITS   },
+    { IMU_BRIDGE_CMD_CODE('R', 'T', 'X'), IMU_BRIDGE_CMD_REALTIME_TEXT    },
+    { IMU_BRIDGE_CMD_CODE('S', 'T', 'S'), IMU_BRIDGE_CMD_STATS            },
+    { IMU_BRIDGE_CMD_CODE('S', 'T', 'Y'), IMU_BRIDGE_CMD_SANITY           },
+    { IMU_BRIDGE_CMD_CODE('T', 'M', 'P'), IMU_BRIDGE_CMD_READ_TEMP        },
+};
+
+#define IMU_BRIDGE_CMD_TABLE_LEN    (sizeof(cmdTable) / sizeof(cmdTable[0]))
+
+static void IMU_Bridge_RxStampUpdate(uint32_t index);
+static void IMU_Bridge_RxLineEnd(void);
 
 /**
  * @brief IMU Bridge init software module
@@ -25,7 +141,16 @@ uint8_t pCmdBuffer[4] = {'0', '0', '0', '\0'};
 IMU_Bridge_StatusTypeDef IMU_Bridge_Init(void)
 {
     IMU_Bridge_StatusTypeDef status;
+
+    for (uint32_t i = 1; i < IMU_BRIDGE_CMD_TABLE_LEN; i++) assert(cmdTable[i - 1].code < cmdTable[i].code);
+
+    RingBuffer_Init(&rxRing, pRxStorage, IMU_BRIDGE_RX_RING_SIZE);
+    RingBuffer_Init(&rxStampQueue, pRxStampStorage, IMU_BRIDGE_RX_STAMP_QUEUE_SIZE);
+    RingBuffer_Init(&cmdQueue, pCmdStorage, IMU_BRIDGE_CMD_QUEUE_SIZE);
     status = UART_Init();
+    if (status == IMU_BRIDGE_OK) status = Timer_Init();
+    if (status == IMU_BRIDGE_OK) status = CRC32_Init();
+    if (status == IMU_BRIDGE_OK) status = IMU_Port_Init();
     return status;
 }
 
@@ -38,46 +163,387 @@ IMU_Bridge_StatusTypeDef IMU_Bridge_SendString(char *pMsg)
 }
 
 /**
- * @brief Callback when a complete command is received
- * @note To be called by the UART port in a receptioon complete callback
+ * @brief Reserve transmit memory to format a message in place
+ * @param len: max message length, including the string terminator
+ * @retval Pointer to len bytes, NULL if the transmit buffer is full
+*/
+char* IMU_Bridge_TxReserve(uint16_t len)
+{
+    char* pMsg = (char*)UART_TxReserve(len);
+    txReserved = (pMsg != NULL) ? len : 0;
+    return pMsg;
+}
+
+/**
+ * @brief Send the message formatted in the reserved memory
+ * @param n: message length as returned by snprintf, truncated to the
+ *           reserved length if needed
 */
-void IMU_Bridge_RxCallback(void)
+IMU_Bridge_StatusTypeDef IMU_Bridge_TxCommit(int n)
 {
-    char msg[200]; 
-    UART_ReadRxBuffer(pCmdBuffer);
-    sprintf(msg, ">> CMD CALLBACK: %s\n\r", (char*)pCmdBuffer);
-    IMU_Bridge_SendString(msg);
+    if (txReserved == 0) return IMU_BRIDGE_ERROR;
+    if (n < 0) n = 0;
+    if (n >= txReserved) n = txReserved - 1;
+    UART_TxCommit((uint16_t)n);
+    txReserved = 0;
+    return IMU_BRIDGE_OK;
 }
 
 /**
- * @brief Get current command
+ * @brief Send the binary data written in the reserved memory
+ * @param size: data length, all of it sent, no room kept for a terminator
+ * @retval IMU_BRIDGE_ERROR if nothing is reserved or size exceeds it
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_TxCommitData(uint16_t size)
+{
+    if (txReserved == 0 || size > txReserved) return IMU_BRIDGE_ERROR;
+    UART_TxCommit(size);
+    txReserved = 0;
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief Callback with new bytes received, in any fragment size
+ * @note To be called by the UART port from the reception ISR. Bytes are only
+ *       copied into the RX ring, with the fragment timestamp in the stamp
+ *       queue. Commands are assembled and echoed later by
+ *       IMU_Bridge_ProcessRx() from the main loop.
+*/
+void IMU_Bridge_RxCallback(const uint8_t* pData, uint16_t size)
+{
+    IMU_Bridge_RxStampTypeDef stamp = { .tick = Sys_GetTick(), .cycles = Sys_GetCycles() };
+    uint8_t* pStamp;
+
+    if (RingBuffer_Write(&rxRing, pData, size))
+    {
+        stamp.end = atomic_load_explicit(&rxRing.head, memory_order_relaxed);
+        pStamp = RingBuffer_Reserve(&rxStampQueue, sizeof(IMU_Bridge_RxStampTypeDef));
+        if (pStamp != NULL)
+        {
+            memcpy(pStamp, &stamp, sizeof(IMU_Bridge_RxStampTypeDef));
+            RingBuffer_Commit(&rxStampQueue, sizeof(IMU_Bridge_RxStampTypeDef));
+        }
+    }
+    IMU_Bridge_EventPost(IMU_BRIDGE_EVENT_RX);
+}
+
+/**
+ * @brief Callback when the RX line goes idle, end of a frame
+ * @note To be called by the UART port from the reception ISR. The event is
+ *       queued in order with the bytes as a NUL marker.
+*/
+void IMU_Bridge_RxIdleCallback(void)
+{
+    const uint8_t idle = IMU_BRIDGE_RX_IDLE_MARK;
+    RingBuffer_Write(&rxRing, &idle, 1);
+    IMU_Bridge_EventPost(IMU_BRIDGE_EVENT_RX);
+}
+
+/**
+ * @brief Assemble and echo the commands received since the last call
+ * @note CR, LF and ';' end a command, so several commands can arrive back
+ *       to back in the same frame. Hosts that don't use delimiters send one
+ *       command per frame, a frame shorter than a command code is a
+ *       fragment so wait for the rest.
+*/
+void IMU_Bridge_ProcessRx(void)
+{
+    uint8_t* pData;
+    uint32_t size;
+    uint32_t start = Sys_GetCycles();
+    uint32_t cycles;
+
+    while ((size = RingBuffer_Peek(&rxRing, &pData)) != 0)
+    {
+        uint32_t index = atomic_load_explicit(&rxRing.tail, memory_order_relaxed);
+
+        for (uint32_t i = 0; i < size; i++)
+        {
+            char c = (char)pData[i];
+
+            if (c == IMU_BRIDGE_RX_IDLE_MARK)
+            {
+                if (!rxDelimited && rxLineLen >= IMU_BRIDGE_CMD_CODE_LEN) IMU_Bridge_RxLineEnd();
+                continue;
+            }
+
+            IMU_Bridge_RxStampUpdate(index + i);
+            if (c == '\r' || c == '\n' || c == ';')
+            {
+                rxDelimited = true;
+                IMU_Bridge_RxLineEnd();
+            }
+            else if (rxLineLen < IMU_BRIDGE_CMD_MAX_LEN)
+            {
+                pRxLine[rxLineLen++] = c;
+            }
+            else
+            {
+                rxLineOverflow = true;
+            }
+        }
+        RingBuffer_Consume(&rxRing, size);
+
+        cycles = Sys_GetCycles() - start;
+        if (cycles > rxProcessMaxCycles) rxProcessMaxCycles = cycles;
+    }
+}
+
+/**
+ * @brief   Follow the receive timestamps up to a byte of the RX ring
+ * @param   index: RX ring index of the byte
+ * @note    A fragment whose stamp didn't fit in the queue takes the stamp
+ *          of the fragment before.
+*/
+static void IMU_Bridge_RxStampUpdate(uint32_t index)
+{
+    uint8_t* pStamp;
+
+    while ((int32_t)(rxStamp.end - index) <= 0 &&
+           RingBuffer_Peek(&rxStampQueue, &pStamp) >= sizeof(IMU_Bridge_RxStampTypeDef))
+    {
+        memcpy(&rxStamp, pStamp, sizeof(IMU_Bridge_RxStampTypeDef));
+        RingBuffer_Consume(&rxStampQueue, sizeof(IMU_Bridge_RxStampTypeDef));
+    }
+}
+
+/**
+ * @brief   End of the command being assembled, queue and echo it
+ * @note    Stamped with the receive time of its last byte. If the command
+ *          FIFO is full the command is dropped, counted and reported.
+*/
+static void IMU_Bridge_RxLineEnd(void)
+{
+    char* msg;
+    uint8_t* pEntry;
+    IMU_Bridge_CmdEntryTypeDef entry;
+
+    if (rxLineLen != 0 && !rxLineOverflow)
+    {
+        pRxLine[rxLineLen] = '\0';
+        memcpy(entry.cmd, pRxLine, rxLineLen + 1);
+        entry.tick = rxStamp.tick;
+        entry.cycles = rxStamp.cycles;
+        pEntry = RingBuffer_Reserve(&cmdQueue, sizeof(IMU_Bridge_CmdEntryTypeDef));
+        if (pEntry != NULL)
+        {
+            memcpy(pEntry, &entry, sizeof(IMU_Bridge_CmdEntryTypeDef));
+            RingBuffer_Commit(&cmdQueue, sizeof(IMU_Bridge_CmdEntryTypeDef));
+        }
+        msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+        if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE, (pEntry != NULL) ?
+            ">> CMD CALLBACK: %s\n\r" : ">> CMD DROPPED: %s\n\r", pRxLine));
+    }
+    rxLineLen = 0;
+    rxLineOverflow = false;
+}
+
+/**
+ * @brief Send bridge statistics to user
+*/
+static void IMU_Bridge_SendStats(void)
+{
+    char* msg;
+    uint32_t txHighWater, txOverflow, rxIsrMaxCycles;
+    uint32_t fifoOverflow, fifoBursts;
+    uint32_t sampleMinPeriod, sampleMaxPeriod, sampleMissed;
+    uint32_t fsmDispatchMaxCycles;
+    uint32_t busJobs, busErrors, busQueueMax;
+    uint64_t busCycles;
+    uint32_t busyMs, idleShare = 0, busShare = 0;
+    tick_t window = Sys_GetTick() - busyWindowStart;
+
+    /* Idle share since the last statistics read, permille */
+    busyMs = Sys_CyclesToUs((uint32_t)(busyCycles / 1000U));
+    if (window != 0) idleShare = (busyMs >= window) ? 0 : 1000U - (busyMs * 1000U) / window;
+    busyCycles = 0;
+    busyWindowStart = Sys_GetTick();
+
+    /* Sensor bus use over the same window, permille */
+    IMU_Port_GetStats(&busJobs, &busErrors, &busQueueMax, &busCycles);
+    busyMs = Sys_CyclesToUs((uint32_t)(busCycles / 1000U));
+    if (window != 0) busShare = (busyMs >= window) ? 1000U : (busyMs * 1000U) / window;
+
+    UART_GetTxStats(&txHighWater, &txOverflow);
+    UART_GetRxStats(&rxIsrMaxCycles);
+    IMU_Bridge_FifoGetStats(&fifoOverflow, &fifoBursts);
+    IMU_Bridge_SampleGetStats(&sampleMinPeriod, &sampleMaxPeriod, &sampleMissed);
+    IMU_Bridge_FsmGetStats(&fsmDispatchMaxCycles);
+
+    msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE,
+        "TX HIGH WATER:\t%lu\n\rTX OVERFLOW:\t%lu\n\r",
+        (unsigned long)txHighWater, (unsigned long)txOverflow));
+    msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE,
+        "RX ISR MAX:\t%lu cycles\n\rRX PROC MAX:\t%lu cycles\n\r",
+        (unsigned long)rxIsrMaxCycles, (unsigned long)rxProcessMaxCycles));
+    msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE,
+        "RX OVERFLOW:\t%lu\n\rCMD DROPPED:\t%lu\n\rCMD LATENCY:\t%lu us\n\r",
+        (unsigned long)rxRing.overflow, (unsigned long)cmdQueue.overflow, (unsigned long)cmdMaxLatency));
+    msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE,
+        "FIFO OVERFLOW:\t%lu\n\rFIFO BURSTS:\t%lu\n\r",
+        (unsigned long)fifoOverflow, (unsigned long)fifoBursts));
+    msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE,
+        "SAMPLE PERIOD:\t%lu..%lu cycles\n\rSAMPLE MISSED:\t%lu\n\r",
+        (unsigned long)sampleMinPeriod, (unsigned long)sampleMaxPeriod, (unsigned long)sampleMissed));
+    msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE,
+        "BUS JOBS:\t%lu\n\rBUS ERRORS:\t%lu\n\rBUS QUEUE MAX:\t%lu\n\r",
+        (unsigned long)busJobs, (unsigned long)busErrors, (unsigned long)busQueueMax));
+    msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE,
+        "BUS USE:\t%lu.%lu %%\n\r", (unsigned long)(busShare / 10U), (unsigned long)(busShare % 10U)));
+    msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE,
+        "FSM DISPATCH MAX:\t%lu cycles\n\r", (unsigned long)fsmDispatchMaxCycles));
+    msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE,
+        "IDLE SHARE:\t%lu.%lu %%\n\r", (unsigned long)(idleShare / 10U), (unsigned long)(idleShare % 10U)));
+}
+
+/**
+ * @brief Decode a command string
+ * @note The 3 character code is packed into an integer and binary searched
+ *       in the command table. It can be followed by arguments after a space.
+*/
+IMU_Bridge_CmdTypeDef IMU_Bridge_DecodeCmd(const char* pCmd)
+{
+    uint32_t code;
+    uint32_t low = 0;
+    uint32_t high = IMU_BRIDGE_CMD_TABLE_LEN;
+
+    if (pCmd[0] == '\0' || pCmd[1] == '\0' || pCmd[2] == '\0') return IMU_BRIDGE_CMD_INVALID;
+    if (pCmd[3] != '\0' && pCmd[3] != ' ') return IMU_BRIDGE_CMD_INVALID;
+    code = IMU_BRIDGE_CMD_CODE(pCmd[0], pCmd[1], pCmd[2]);
+
+    while (low < high)
+    {
+        uint32_t mid = (low + high) / 2;
+        if (cmdTable[mid].code == code) return cmdTable[mid].cmd;
+        if (cmdTable[mid].code < code) low = mid + 1;
+        else high = mid;
+    }
+    return IMU_BRIDGE_CMD_INVALID;
+}
+
+/**
+ * @brief Get next command from the command FIFO
+ * @retval IMU_BRIDGE_CMD_INVALID if there's no command pending
 */
 IMU_Bridge_CmdTypeDef IMU_Bridge_GetCmd(void)
 {
     IMU_Bridge_CmdTypeDef cmd;
-    if (strcmp((char*)pCmdBuffer, "STY") == 0) cmd = IMU_BRIDGE_CMD_SANITY;
-    else if (strcmp((char*)pCmdBuffer, "INT") == 0) cmd = IMU_BRIDGE_CMD_INIT;
-    else if (strcmp((char*)pCmdBuffer, "CFG") == 0) cmd = IMU_BRIDGE_CMD_CONFIG;
-    else if (strcmp((char*)pCmdBuffer, "CG1") == 0) cmd = IMU_BRIDGE_CMD_CFG_GYRO_FS250;
-    else if (strcmp((char*)pCmdBuffer, "CG2") == 0) cmd = IMU_BRIDGE_CMD_CFG_GYRO_FS500;
-    else if (strcmp((char*)pCmdBuffer, "CG3") == 0) cmd = IMU_BRIDGE_CMD_CFG_GYRO_FS1000;
-    else if (strcmp((char*)pCmdBuffer, "CG4") == 0) cmd = IMU_BRIDGE_CMD_CFG_GYRO_FS2000;
-    else if (strcmp((char*)pCmdBuffer, "CA1") == 0) cmd = IMU_BRIDGE_CMD_CFG_ACCEL_FS2;
-    else if (strcmp((char*)pCmdBuffer, "CA2") == 0) cmd = IMU_BRIDGE_CMD_CFG_ACCEL_FS4;
-    else if (strcmp((char*)pCmdBuffer, "CA3") == 0) cmd = IMU_BRIDGE_CMD_CFG_ACCEL_FS8;
-    else if (strcmp((char*)pCmdBuffer, "CA4") == 0) cmd = IMU_BRIDGE_CMD_CFG_ACCEL_FS16;
-    else if (strcmp((char*)pCmdBuffer, "RDM") == 0) cmd = IMU_BRIDGE_CMD_READ_MODE;
-    else if (strcmp((char*)pCmdBuffer, "AAW") == 0) cmd = IMU_BRIDGE_CMD_READ_ACCEL_ALL;
-    else if (strcmp((char*)pCmdBuffer, "GAW") == 0) cmd = IMU_BRIDGE_CMD_READ_GYRO_ALL;
-    else if (strcmp((char*)pCmdBuffer, "TMP") == 0) cmd = IMU_BRIDGE_CMD_READ_TEMP;
-    else if (strcmp((char*)pCmdBuffer, "RTM") == 0) cmd = IMU_BRIDGE_CMD_REALTIME;
-    else if (strcmp((char*)pCmdBuffer, "RTG") == 0) cmd = IMU_BRIDGE_CMD_REALTIME_GYRO;
-    else if (strcmp((char*)pCmdBuffer, "RTA") == 0) cmd = IMU_BRIDGE_CMD_REALTIME_ACCEL;
-    else if (strcmp((char*)pCmdBuffer, "RTT") == 0) cmd = IMU_BRIDGE_CMD_REALTIME_TEMP;
-    else if (strcmp((char*)pCmdBuffer, "EXT") == 0) cmd = IMU_BRIDGE_CMD_EXIT;
-    else cmd = IMU_BRIDGE_CMD_INVALID;
-    pCmdBuffer[0] = '0';
-    pCmdBuffer[1] = '0';
-    pCmdBuffer[2] = '0';
+    IMU_Bridge_CmdEntryTypeDef entry;
+    uint8_t* pEntry;
+    uint32_t latency;
+
+    if (RingBuffer_Peek(&cmdQueue, &pEntry) < sizeof(IMU_Bridge_CmdEntryTypeDef)) return IMU_BRIDGE_CMD_INVALID;
+    memcpy(&entry, pEntry, sizeof(IMU_Bridge_CmdEntryTypeDef));
+    RingBuffer_Consume(&cmdQueue, sizeof(IMU_Bridge_CmdEntryTypeDef));
+
+    latency = Sys_CyclesToUs(Sys_GetCycles() - entry.cycles);
+    if (latency > cmdMaxLatency) cmdMaxLatency = latency;
+
+    cmd = IMU_Bridge_DecodeCmd(entry.cmd);
+    if (cmd != IMU_BRIDGE_CMD_INVALID) strcpy(pCmdArg, &entry.cmd[IMU_BRIDGE_CMD_CODE_LEN]);
+    else pCmdArg[0] = '\0';
+
+    /* Statistics are answered by the bridge in any state */
+    if (cmd == IMU_BRIDGE_CMD_STATS)
+    {
+        IMU_Bridge_SendStats();
+        cmd = IMU_BRIDGE_CMD_INVALID;
+    }
     return cmd;
 }
+
+/**
+ * @brief   Get the numeric argument of the last command, i.e. "RTS 2500"
+ * @param   pValue: decimal argument
+ * @retval  IMU_BRIDGE_ERROR if there's no argument or it isn't a number
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_GetCmdArg(uint32_t* pValue)
+{
+    const char* p = pCmdArg;
+    uint32_t value = 0;
+
+    while (*p == ' ') p++;
+    if (*p == '\0') return IMU_BRIDGE_ERROR;
+
+    for (; *p >= '0' && *p <= '9'; p++)
+    {
+        uint32_t digit = (uint32_t)(*p - '0');
+        if (value > (UINT32_MAX - digit) / 10U) return IMU_BRIDGE_ERROR;
+        value = value * 10U + digit;
+    }
+    if (*p != '\0') return IMU_BRIDGE_ERROR;
+
+    *pValue = value;
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief   Post events to the main loop
+ * @note    Safe to call from any interrupt handler
+*/
+void IMU_Bridge_EventPost(uint32_t events)
+{
+    atomic_fetch_or(&eventsPending, events);
+}
+
+/**
+ * @brief   Take all the events posted since the last call
+*/
+uint32_t IMU_Bridge_EventTake(void)
+{
+    return atomic_exchange(&eventsPending, 0);
+}
+
+/**
+ * @brief   Check for events posted and not yet taken
+*/
+bool IMU_Bridge_EventPending(void)
+{
+    return atomic_load(&eventsPending) != 0;
+}
+
+/**
+ * @brief   Enable the sys tick event, for the work paced by delays or polling
+*/
+void IMU_Bridge_EventTickEnable(bool enable)
+{
+    eventTickEnabled = enable;
+}
+
+/**
+ * @brief   Sys tick callback
+ * @note    To be called from the SysTick handler
+*/
+void IMU_Bridge_TickCallback(void)
+{
+    if (eventTickEnabled) IMU_Bridge_EventPost(IMU_BRIDGE_EVENT_TICK);
+}
+
+/**
+ * @brief   Check for commands queued and not yet decoded
+*/
+bool IMU_Bridge_CmdPending(void)
+{
+    return RingBuffer_Used(&cmdQueue) != 0;
+}
+
+/**
+ * @brief   Sleep until the next event
+ * @note    The CPU only runs on interrupts, the time awake is accumulated
+ *          for the idle share statistics.
+*/
+void IMU_Bridge_Sleep(void)
+{
+    busyCycles += Sys_GetCycles() - busyStart;
+    Sys_Sleep();
+    busyStart = Sys_GetCycles();
+}
@@ -0,0 +1,320 @@
+/**
+  ******************************************************************************
+  * @file           : imu_bridge_encoder.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : IMU Bridge real time output encoders
+  ******************************************************************************
+  * @attention
+  *
+  * Real time stream output encoders. Each format is written as begin record,
+  * add channel and end record functions, and IMU_BRIDGE_ENCODER_RECORD()
+  * binds them into the record function of its table. The calls inside a
+  * record are direct, the stream pays one indirect call per record.
+  *
+  ******************************************************************************
+  */
+
+#include "imu_bridge_encoder.h"
+#include "imu_bridge.h"
+#include "imu_bridge_frame.h"
+#include "imu_bridge_sensor.h"
+#include "fmt.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+/**
+ * @brief Record encoding context
+*/
+typedef struct
+{
+    const IMU_Bridge_RecordTypeDef* pRecord;        /*!< Record being encoded           */
+    uint8_t* pOut;                                  /*!< Record start                   */
+    char* pText;                                    /*!< Text formats, next character   */
+    IMU_Bridge_FrameEncoderTypeDef frame;           /*!< Binary formats, framing state  */
+    int32_t units[IMU_BRIDGE_FRAME_MAX_CHANNELS];   /*!< Units format, scaled values    */
+    uint8_t layout[IMU_BRIDGE_FRAME_MAX_CHANNELS];  /*!< Delta format, reference index   */
+    uint8_t channel;                                /*!< Channel being added            */
+    bool_t asUnsigned;                              /*!< Text format, raw uint16 values */
+    bool_t keyframe;                                /*!< Delta format, absolute values  */
+
+} IMU_Bridge_EncodeCtxTypeDef;
+
+/* Channels per sensor, in mask bit order */
+static const uint8_t pDeltaChannels[IMU_SENSOR_COUNT] = { 3, 1, 3, 3 };
+
+static int16_t pDeltaRef[IMU_BRIDGE_FRAME_MAX_CHANNELS];    /*!< Last value of each channel, all sensors   */
+static uint8_t pDeltaAge[IMU_SENSOR_COUNT];                 /*!< Records since the sensor keyframe         */
+static uint8_t deltaRefMask = 0;                            /*!< Sensors with a reference                  */
+static tick_t deltaRefTick;                                 /*!< Timestamp of the last delta format record */
+
+/**
+ * @brief Record function of an encoder, from its Begin, Add and End functions
+*/
+#define IMU_BRIDGE_ENCODER_RECORD(name)                                                         \
+static uint16_t name##Record(uint8_t* pOut, const IMU_Bridge_RecordTypeDef* pRecord)            \
+{                                                                                               \
+    IMU_Bridge_EncodeCtxTypeDef ctx;                                                            \
+    uint8_t channels = IMU_Bridge_FrameChannels(pRecord->mask);                                 \
+                                                                                                \
+    assert(pOut && (pRecord->pValues || channels == 0));                                        \
+    ctx.pRecord = pRecord;                                                                      \
+    ctx.pOut = pOut;                                                                            \
+    ctx.pText = (char*)pOut;                                                                    \
+    name##Begin(&ctx);                                                                          \
+    for (ctx.channel = 0; ctx.channel < channels; ctx.channel++)                                \
+    {                                                                                           \
+        name##Add(&ctx, pRecord->pValues[ctx.channel]);                                         \
+    }                                                                                           \
+    return name##End(&ctx);                                                                     \
+}
+
+/**
+ * @brief Legacy text, single sensor lines as raw uint16 and untimed
+*/
+static void IMU_Bridge_TextBegin(IMU_Bridge_EncodeCtxTypeDef* pCtx)
+{
+    const char* pLabel;
+    uint8_t mask = pCtx->pRecord->mask;
+
+    switch (mask)
+    {
+    case IMU_BRIDGE_SENSOR_GYRO:
+        pLabel = "GYRO READ:";
+        break;
+    case IMU_BRIDGE_SENSOR_ACCEL:
+        pLabel = "ACCEL READ:";
+        break;
+    case IMU_BRIDGE_SENSOR_TEMP:
+        pLabel = "TEMP READ:";
+        break;
+    default:
+        pLabel = (mask & IMU_BRIDGE_SENSOR_MAG) ? "IMU9 READ:" : "IMU READ:";
+        break;
+    }
+    pCtx->pText = Fmt_Str(pCtx->pText, pLabel);
+
+    pCtx->asUnsigned = (mask == IMU_BRIDGE_SENSOR_GYRO || mask == IMU_BRIDGE_SENSOR_ACCEL || mask == IMU_BRIDGE_SENSOR_TEMP);
+    if (!pCtx->asUnsigned)
+    {
+        *pCtx->pText++ = '\t';
+        pCtx->pText = Fmt_Uint32(pCtx->pText, pCtx->pRecord->tick);
+    }
+}
+
+static void IMU_Bridge_TextAdd(IMU_Bridge_EncodeCtxTypeDef* pCtx, int16_t value)
+{
+    *pCtx->pText++ = '\t';
+    pCtx->pText = pCtx->asUnsigned ? Fmt_Uint32(pCtx->pText, (uint16_t)value) : Fmt_Int32(pCtx->pText, value);
+}
+
+static uint16_t IMU_Bridge_TextEnd(IMU_Bridge_EncodeCtxTypeDef* pCtx)
+{
+    pCtx->pText = Fmt_Str(pCtx->pText, "\n\r");
+    return (uint16_t)((uint8_t*)pCtx->pText - pCtx->pOut);
+}
+
+IMU_BRIDGE_ENCODER_RECORD(IMU_Bridge_Text)
+
+/**
+ * @brief Signed physical units text: accel mg, temperature 0.01 degC, gyro
+ *        mdps, mag nT, each line timestamped and labelled by its sensors
+*/
+static void IMU_Bridge_UnitsBegin(IMU_Bridge_EncodeCtxTypeDef* pCtx)
+{
+    const char* pLabel;
+    uint8_t mask = pCtx->pRecord->mask;
+
+    IMU_Bridge_ScaleValues(mask, pCtx->pRecord->pValues, pCtx->units);
+    switch (mask)
+    {
+    case IMU_BRIDGE_SENSOR_GYRO:
+        pLabel = "GYRO MDPS:";
+        break;
+    case IMU_BRIDGE_SENSOR_ACCEL:
+        pLabel = "ACCEL MG:";
+        break;
+    case IMU_BRIDGE_SENSOR_TEMP:
+        pLabel = "TEMP CDEGC:";
+        break;
+    default:
+        pLabel = (mask & IMU_BRIDGE_SENSOR_MAG) ? "IMU9 UNITS:" : "IMU UNITS:";
+        break;
+    }
+    pCtx->pText = Fmt_Str(pCtx->pText, pLabel);
+    *pCtx->pText++ = '\t';
+    pCtx->pText = Fmt_Uint32(pCtx->pText, pCtx->pRecord->tick);
+}
+
+static void IMU_Bridge_UnitsAdd(IMU_Bridge_EncodeCtxTypeDef* pCtx, int16_t value)
+{
+    *pCtx->pText++ = '\t';
+    pCtx->pText = Fmt_Int32(pCtx->pText, pCtx->units[pCtx->channel]);
+}
+
+static uint16_t IMU_Bridge_UnitsEnd(IMU_Bridge_EncodeCtxTypeDef* pCtx)
+{
+    return IMU_Bridge_TextEnd(pCtx);
+}
+
+IMU_BRIDGE_ENCODER_RECORD(IMU_Bridge_Units)
+
+/**
+ * @brief CSV, one row per record: sequence, timestamp, mask, signed values
+*/
+static void IMU_Bridge_CsvBegin(IMU_Bridge_EncodeCtxTypeDef* pCtx)
+{
+    pCtx->pText = Fmt_Uint32(pCtx->pText, pCtx->pRecord->seq);
+    *pCtx->pText++ = ',';
+    pCtx->pText = Fmt_Uint32(pCtx->pText, pCtx->pRecord->tick);
+    *pCtx->pText++ = ',';
+    pCtx->pText = Fmt_Uint32(pCtx->pText, pCtx->pRecord->mask);
+}
+
+static void IMU_Bridge_CsvAdd(IMU_Bridge_EncodeCtxTypeDef* pCtx, int16_t value)
+{
+    *pCtx->pText++ = ',';
+    pCtx->pText = Fmt_Int32(pCtx->pText, value);
+}
+
+static uint16_t IMU_Bridge_CsvEnd(IMU_Bridge_EncodeCtxTypeDef* pCtx)
+{
+    pCtx->pText = Fmt_Str(pCtx->pText, "\r\n");
+    return (uint16_t)((uint8_t*)pCtx->pText - pCtx->pOut);
+}
+
+IMU_BRIDGE_ENCODER_RECORD(IMU_Bridge_Csv)
+
+/**
+ * @brief Packed binary frame, int16 payload
+*/
+static void IMU_Bridge_BinaryBegin(IMU_Bridge_EncodeCtxTypeDef* pCtx)
+{
+    const IMU_Bridge_RecordTypeDef* pRecord = pCtx->pRecord;
+    IMU_Bridge_FrameBegin(&pCtx->frame, pCtx->pOut, pRecord->mask, pRecord->seq, pRecord->tick);
+}
+
+static void IMU_Bridge_BinaryAdd(IMU_Bridge_EncodeCtxTypeDef* pCtx, int16_t value)
+{
+    IMU_Bridge_FrameInt16(&pCtx->frame, value);
+}
+
+static uint16_t IMU_Bridge_BinaryEnd(IMU_Bridge_EncodeCtxTypeDef* pCtx)
+{
+    return IMU_Bridge_FrameEnd(&pCtx->frame);
+}
+
+IMU_BRIDGE_ENCODER_RECORD(IMU_Bridge_Binary)
+
+/**
+ * @brief Compact binary frame, zigzag varint payload
+*/
+static void IMU_Bridge_VarintBegin(IMU_Bridge_EncodeCtxTypeDef* pCtx)
+{
+    const IMU_Bridge_RecordTypeDef* pRecord = pCtx->pRecord;
+    IMU_Bridge_FrameBegin(&pCtx->frame, pCtx->pOut, pRecord->mask | IMU_BRIDGE_FRAME_VARINT, pRecord->seq, pRecord->tick);
+}
+
+static void IMU_Bridge_VarintAdd(IMU_Bridge_EncodeCtxTypeDef* pCtx, int16_t value)
+{
+    IMU_Bridge_FrameVarint(&pCtx->frame, value);
+}
+
+static uint16_t IMU_Bridge_VarintEnd(IMU_Bridge_EncodeCtxTypeDef* pCtx)
+{
+    return IMU_Bridge_FrameEnd(&pCtx->frame);
+}
+
+IMU_BRIDGE_ENCODER_RECORD(IMU_Bridge_Varint)
+
+/**
+ * @brief Delta frames, zigzag varint of the channel differences. A sensor
+ *        without reference, or due for a refresh, turns the record into a
+ *        VARINT keyframe.
+*/
+static void IMU_Bridge_DeltaBegin(IMU_Bridge_EncodeCtxTypeDef* pCtx)
+{
+    const IMU_Bridge_RecordTypeDef* pRecord = pCtx->pRecord;
+    uint8_t mask = pRecord->mask;
+    bool_t keyframe = (mask & ~deltaRefMask) != 0;
+    uint8_t index = 0;
+    uint8_t channel = 0;
+    uint8_t sensor;
+    uint8_t bit;
+
+    /* Channel positions in the reference, mask channels are in the same order */
+    for (sensor = 0, bit = IMU_BRIDGE_SENSOR_ACCEL; bit <= IMU_BRIDGE_SENSOR_MAG; sensor++, bit <<= 1)
+    {
+        for (uint8_t i = 0; i < pDeltaChannels[sensor]; i++, index++)
+        {
+            if (mask & bit) pCtx->layout[channel++] = index;
+        }
+
+        /* Aged in records of any sensor, a slow sensor is refreshed as often as a fast one */
+        if (pDeltaAge[sensor] < IMU_BRIDGE_DELTA_KEY_INTERVAL) pDeltaAge[sensor]++;
+        if ((mask & bit) && pDeltaAge[sensor] == IMU_BRIDGE_DELTA_KEY_INTERVAL) keyframe = true;
+    }
+
+    pCtx->keyframe = keyframe;
+    if (keyframe)
+    {
+        for (sensor = 0, bit = IMU_BRIDGE_SENSOR_ACCEL; bit <= IMU_BRIDGE_SENSOR_MAG; sensor++, bit <<= 1)
+        {
+            if (mask & bit) pDeltaAge[sensor] = 0;
+        }
+        deltaRefMask |= mask;
+        IMU_Bridge_FrameBegin(&pCtx->frame, pCtx->pOut, mask | IMU_BRIDGE_FRAME_VARINT, pRecord->seq, pRecord->tick);
+    }
+    else
+    {
+        IMU_Bridge_FrameBeginDelta(&pCtx->frame, pCtx->pOut, mask, pRecord->seq, pRecord->tick - deltaRefTick);
+    }
+    deltaRefTick = pRecord->tick;
+}
+
+static void IMU_Bridge_DeltaAdd(IMU_Bridge_EncodeCtxTypeDef* pCtx, int16_t value)
+{
+    int16_t* pRef = &pDeltaRef[pCtx->layout[pCtx->channel]];
+
+    IMU_Bridge_FrameVarint(&pCtx->frame, pCtx->keyframe ? value : (int16_t)(uint16_t)((uint16_t)value - (uint16_t)*pRef));
+    *pRef = value;
+}
+
+static uint16_t IMU_Bridge_DeltaEnd(IMU_Bridge_EncodeCtxTypeDef* pCtx)
+{
+    return IMU_Bridge_FrameEnd(&pCtx->frame);
+}
+
+IMU_BRIDGE_ENCODER_RECORD(IMU_Bridge_Delta)
+
+/**
+ * @brief Next delta record is a keyframe for every sensor
+*/
+static void IMU_Bridge_DeltaReset(void)
+{
+    deltaRefMask = 0;
+}
+
+/**
+ * @brief Encoder table, in IMU_Bridge_EncoderIdTypeDef order
+*/
+static const IMU_Bridge_EncoderTypeDef encoderTable[IMU_BRIDGE_ENCODER_COUNT] =
+{
+    { "TEXT",   IMU_BRIDGE_TX_LINE_SIZE,            IMU_Bridge_TextRecord,      NULL                    },
+    { "UNITS",  IMU_BRIDGE_TX_LINE_SIZE,            IMU_Bridge_UnitsRecord,     NULL                    },
+    { "CSV",    IMU_BRIDGE_TX_LINE_SIZE,            IMU_Bridge_CsvRecord,       NULL                    },
+    { "BINARY", IMU_BRIDGE_FRAME_MAX_SIZE,          IMU_Bridge_BinaryRecord,    NULL                    },
+    { "VARINT", IMU_BRIDGE_FRAME_VARINT_MAX_SIZE,   IMU_Bridge_VarintRecord,    NULL                    },
+    { "DELTA",  IMU_BRIDGE_FRAME_DELTA_MAX_SIZE,    IMU_Bridge_DeltaRecord,     IMU_Bridge_DeltaReset   },
+};
+
+/**
+ * @brief   Get an output encoder
+ * @param   id: IMU_Bridge_EncoderIdTypeDef
+ * @retval  Encoder, NULL if there is no such encoder
+*/
+const IMU_Bridge_EncoderTypeDef* IMU_Bridge_EncoderGet(uint32_t id)
+{
+    if (id >= IMU_BRIDGE_ENCODER_COUNT) return NULL;
+    return &encoderTable[id];
+}
@@ -0,0 +1,171 @@
+/**
+  ******************************************************************************
+  * @file           : imu_bridge_frame.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : IMU Bridge binary frame
+  ******************************************************************************
+  * @attention
+  *
+  * Binary real time stream frame encoding. About 5 times less bytes per
+  * sample than the text stream, and the sequence number lets the host
+  * detect lost frames.
+  *
+  * The frame is COBS encoded on the fly, straight into the transmit buffer
+  * in a single pass: each byte is copied once while the hardware CRC takes
+  * the same bytes a word at a time. COBS overhead is one byte per 254, plus
+  * the delimiter, and the host never scans for escapes.
+  *
+  * A frame is built by the output encoders as begin, one call per channel
+  * and end, the channel functions choose the payload format.
+  *
+  ******************************************************************************
+  */
+
+#include "imu_bridge_frame.h"
+#include "port_crc.h"
+
+#include <assert.h>
+
+/**
+ * @brief COBS encode a byte, a zero byte closes the current block
+*/
+static void IMU_Bridge_FramePut(IMU_Bridge_FrameEncoderTypeDef* pEnc, uint8_t byte)
+{
+    if (byte != 0)
+    {
+        *pEnc->pOut++ = byte;
+        if (++pEnc->code != 0xFFU) return;
+    }
+    *pEnc->pCode = pEnc->code;
+    pEnc->pCode = pEnc->pOut++;
+    pEnc->code = 1;
+}
+
+/**
+ * @brief Encode a byte covered by the CRC
+*/
+static void IMU_Bridge_FrameData(IMU_Bridge_FrameEncoderTypeDef* pEnc, uint8_t byte)
+{
+    pEnc->word |= (uint32_t)byte << (8U * pEnc->wordBytes);
+    if (++pEnc->wordBytes == 4U)
+    {
+        CRC32_Feed(pEnc->word);
+        pEnc->word = 0;
+        pEnc->wordBytes = 0;
+    }
+    IMU_Bridge_FramePut(pEnc, byte);
+}
+
+/**
+ * @brief Number of int16 channels for a sensor mask
+*/
+uint8_t IMU_Bridge_FrameChannels(uint8_t mask)
+{
+    uint8_t channels = 0;
+    if (mask & IMU_BRIDGE_SENSOR_ACCEL) channels += 3;
+    if (mask & IMU_BRIDGE_SENSOR_TEMP) channels += 1;
+    if (mask & IMU_BRIDGE_SENSOR_GYRO) channels += 3;
+    if (mask & IMU_BRIDGE_SENSOR_MAG) channels += 3;
+    return channels;
+}
+
+/**
+ * @brief Encode an unsigned varint, 7 bits per byte, least significant first
+*/
+static void IMU_Bridge_FrameVaruint(IMU_Bridge_FrameEncoderTypeDef* pEnc, uint32_t value)
+{
+    while (value >= 0x80U)
+    {
+        IMU_Bridge_FrameData(pEnc, (uint8_t)(value | 0x80U));
+        value >>= 7;
+    }
+    IMU_Bridge_FrameData(pEnc, (uint8_t)value);
+}
+
+/**
+ * @brief Start a frame, up to the sequence number
+*/
+static void IMU_Bridge_FrameStart(IMU_Bridge_FrameEncoderTypeDef* pEnc, uint8_t* pFrame, uint8_t mask, uint16_t seq)
+{
+    assert(pEnc && pFrame);
+
+    pEnc->pFrame = pFrame;
+    pEnc->pCode = pFrame;
+    pEnc->pOut = pFrame + 1;
+    pEnc->code = 1;
+    pEnc->word = 0;
+    pEnc->wordBytes = 0;
+
+    CRC32_Reset();
+    IMU_Bridge_FrameData(pEnc, mask);
+    IMU_Bridge_FrameData(pEnc, (uint8_t)seq);
+    IMU_Bridge_FrameData(pEnc, (uint8_t)(seq >> 8));
+}
+
+/**
+ * @brief Start a frame, COBS encoded and delimited
+ * @param pFrame: output, up to IMU_BRIDGE_FRAME_MAX_SIZE bytes, or
+ *        IMU_BRIDGE_FRAME_VARINT_MAX_SIZE with the VARINT flag
+ * @param mask: sensors in the payload, and the payload flags
+ * @param seq: frame sequence number
+ * @param tick: sample timestamp
+*/
+void IMU_Bridge_FrameBegin(IMU_Bridge_FrameEncoderTypeDef* pEnc, uint8_t* pFrame, uint8_t mask, uint16_t seq, uint32_t tick)
+{
+    IMU_Bridge_FrameStart(pEnc, pFrame, mask, seq);
+    IMU_Bridge_FrameData(pEnc, (uint8_t)tick);
+    IMU_Bridge_FrameData(pEnc, (uint8_t)(tick >> 8));
+    IMU_Bridge_FrameData(pEnc, (uint8_t)(tick >> 16));
+    IMU_Bridge_FrameData(pEnc, (uint8_t)(tick >> 24));
+}
+
+/**
+ * @brief Start a delta frame, varint payload of the channel differences
+ * @param pFrame: output, up to IMU_BRIDGE_FRAME_DELTA_MAX_SIZE bytes
+ * @param mask: sensors in the payload, the VARINT and DELTA flags are added
+ * @param seq: frame sequence number
+ * @param tickDelta: timestamp minus the one of the previous frame
+*/
+void IMU_Bridge_FrameBeginDelta(IMU_Bridge_FrameEncoderTypeDef* pEnc, uint8_t* pFrame, uint8_t mask, uint16_t seq, uint32_t tickDelta)
+{
+    IMU_Bridge_FrameStart(pEnc, pFrame, mask | IMU_BRIDGE_FRAME_VARINT | IMU_BRIDGE_FRAME_DELTA, seq);
+    IMU_Bridge_FrameVaruint(pEnc, tickDelta);
+}
+
+/**
+ * @brief Add a payload channel, little endian int16
+*/
+void IMU_Bridge_FrameInt16(IMU_Bridge_FrameEncoderTypeDef* pEnc, int16_t value)
+{
+    IMU_Bridge_FrameData(pEnc, (uint8_t)value);
+    IMU_Bridge_FrameData(pEnc, (uint8_t)((uint16_t)value >> 8));
+}
+
+/**
+ * @brief Add a payload channel, zigzag varint, 1 to 3 bytes
+*/
+void IMU_Bridge_FrameVarint(IMU_Bridge_FrameEncoderTypeDef* pEnc, int16_t value)
+{
+    IMU_Bridge_FrameVaruint(pEnc, (uint16_t)(((uint16_t)value << 1) ^ (uint16_t)(value >> 15)));
+}
+
+/**
+ * @brief Close a frame, CRC and delimiter
+ * @retval Encoded frame size in bytes, delimiter included
+*/
+uint16_t IMU_Bridge_FrameEnd(IMU_Bridge_FrameEncoderTypeDef* pEnc)
+{
+    uint32_t crc;
+
+    if (pEnc->wordBytes != 0) CRC32_Feed(pEnc->word);    /* Zero padded last word */
+    crc = CRC32_Get();
+    IMU_Bridge_FramePut(pEnc, (uint8_t)crc);
+    IMU_Bridge_FramePut(pEnc, (uint8_t)(crc >> 8));
+    IMU_Bridge_FramePut(pEnc, (uint8_t)(crc >> 16));
+    IMU_Bridge_FramePut(pEnc, (uint8_t)(crc >> 24));
+
+    *pEnc->pCode = pEnc->code;
+    *pEnc->pOut++ = IMU_BRIDGE_FRAME_DELIMITER;
+
+    return (uint16_t)(pEnc->pOut - pEnc->pFrame);
+}
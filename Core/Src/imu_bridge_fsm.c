@@ -6,66 +6,197 @@
   ******************************************************************************
   * @attention
   *
-  * IMU Bridge Finite State Machine
+  * IMU Bridge Finite State Machine, as hierarchical state machine tables run
+  * by the HSM engine. Commands are the events, plus the internal completion
+  * and error events returned by the state actions.
+  *
+  *     INIT
+  *     ERROR
+  *     OP
+  *      |- IDLE
+  *      |- SANITY
+  *      |- MODE            (EXT back to IDLE)
+  *          |- CONFIG
+  *          |- READ
+  *          |- REAL TIME
   *
   ******************************************************************************
   */
 
 #include "imu_bridge_fsm.h"
-#include "mpu9250.h"
+#include "imu_bridge_encoder.h"
+#include "imu_bridge_frame.h"
+#include "imu_bridge_sensor.h"
+#include "fmt.h"
+#include "hsm.h"
+#include "port_timer.h"
+#include "port_uart.h"
 #include "utils.h"
 
 #include <stdio.h>
 #include <string.h>
 
-/**
- * @brief IMU Bridge FSM status enum
-*/
-typedef enum
-{
-    IMU_BRIDGE_FSM_INIT_STATE   = 0x00U,
-    IMU_BRIDGE_FSM_DEINIT_STATE = 0x01U,
-    IMU_BRIDGE_FSM_OP_STATE     = 0x02U,
-    IMU_BRIDGE_FSM_ERROR_STATE  = 0x03U
-
-} IMU_Bridge_FsmStateTypeDef;
+/* Internal events, after the commands */
+#define IMU_BRIDGE_EVT_DONE     ((uint32_t)IMU_BRIDGE_CMD_INVALID + 1U)     /*!< State work completed   */
+#define IMU_BRIDGE_EVT_ERROR    ((uint32_t)IMU_BRIDGE_CMD_INVALID + 2U)     /*!< State work failed      */
 
 /**
- * @brief IMU Bridge FSM inner Op state FSM
+ * @brief IMU Bridge Real Time acquisition mode
 */
 typedef enum
 {
-    IMU_BRIDGE_FSM_OP_IDLE_STATE        = 0x00U,
-    IMU_BRIDGE_FSM_OP_SANITY_STATE      = 0x01U,
-    IMU_BRIDGE_FSM_OP_CONFIG_STATE      = 0x02U,
-    IMU_BRIDGE_FSM_OP_READ_STATE        = 0x03U,
-    IMU_BRIDGE_FSM_OP_REALTIME_STATE    = 0x04U,
+    IMU_BRIDGE_ACQ_POLL = 0x00U,    /*!< Fetch on the sys tick delay                */
+    IMU_BRIDGE_ACQ_FIFO = 0x01U,    /*!< Drain the sensor FIFO                      */
+    IMU_BRIDGE_ACQ_DRDY = 0x02U,    /*!< Burst read on the data ready interrupt     */
+    IMU_BRIDGE_ACQ_TIMER = 0x03U,   /*!< Burst read on the sample timer interrupt   */
+    IMU_BRIDGE_ACQ_MULTI = 0x04U    /*!< Per sensor rates, scheduled on the timer   */
 
-} IMU_Bridge_OpStateTypeDef;
+} IMU_Bridge_AcqTypeDef;
 
 /* Private function prototypes -----------------------------------------------*/
-static IMU_Bridge_StatusTypeDef IMU_Bridge_InitState(void);
+static void IMU_Bridge_InitState_Entry(void);
+static uint32_t IMU_Bridge_InitState(uint32_t event);
 static void IMU_Bridge_ErrorState_Entry(void);
-static void IMU_Bridge_ErrorState(void);
 static void IMU_Bridge_OpState_Entry(void);
-static IMU_Bridge_StatusTypeDef IMU_Bridge_OpState(void);
-static IMU_Bridge_StatusTypeDef IMU_Bridge_IdleState(void);
 static void IMU_Bridge_IdleState_Entry(void);
-static IMU_Bridge_StatusTypeDef IMU_Bridge_SanityState(void);
+static void IMU_Bridge_SanityState_Entry(void);
+static uint32_t IMU_Bridge_SanityState(uint32_t event);
+static uint32_t IMU_Bridge_ExitAction(uint32_t event);
 static void IMU_Bridge_ConfigState_Entry(void);
-static IMU_Bridge_StatusTypeDef IMU_Bridge_ConfigState(void);
+static uint32_t IMU_Bridge_ConfigFullScale(uint32_t event);
+static uint32_t IMU_Bridge_ConfigFilter(uint32_t event);
+static void IMU_Bridge_RateQuery(void);
 static void IMU_Bridge_ReadState_Entry(void);
-static IMU_Bridge_StatusTypeDef IMU_Bridge_ReadState(void);
+static uint32_t IMU_Bridge_ReadAction(uint32_t event);
 static void IMU_Bridge_RealTimeState_Entry(void);
-static IMU_Bridge_StatusTypeDef IMU_Bridge_RealTimeState(void);
-static bool checkExitEvent(IMU_Bridge_CmdTypeDef cmd);
+static void IMU_Bridge_RealTimeState_Exit(void);
+static uint32_t IMU_Bridge_RealTimeState(uint32_t event);
+static uint32_t IMU_Bridge_RealTimeSelect(uint32_t event);
+static uint32_t IMU_Bridge_RealTimeFormat(uint32_t event);
+static uint32_t IMU_Bridge_RealTimeAcquisition(uint32_t event);
+static uint32_t IMU_Bridge_RealTimeRate(uint32_t event);
+static IMU_Bridge_StatusTypeDef IMU_Bridge_RealTimeSetAcq(IMU_Bridge_AcqTypeDef acq);
+static IMU_Bridge_StatusTypeDef IMU_Bridge_RealTimeSetPeriod(void);
+static void IMU_Bridge_RealTimeSetDelay(void);
+static void IMU_Bridge_RealTimeQuery(void);
+static uint8_t IMU_Bridge_RealTimeMask(void);
+static void IMU_Bridge_SampleValues(uint8_t mask, const IMU_Bridge_SampleTypeDef* pSample, int16_t* pValues);
+static void IMU_Bridge_RealTimeSend(uint8_t mask, tick_t tick, const int16_t* pValues);
+static void IMU_Bridge_EncoderList(void);
+static void IMU_Bridge_EncoderSet(uint32_t id);
+static void IMU_Bridge_SendRecord(const char* pLabel, const int16_t* pValues, uint8_t count, bool_t asUnsigned);
 static void hline(void);
 
+/* State tables --------------------------------------------------------------*/
+static const Hsm_StateTypeDef initState, errorState, opState, idleState, sanityState;
+static const Hsm_StateTypeDef modeState, configState, readState, realtimeState;
+
+static const Hsm_TransitionTypeDef initTransitions[] =
+{
+    { IMU_BRIDGE_EVT_DONE,                  &idleState,     NULL                                },
+    { IMU_BRIDGE_EVT_ERROR,                 &errorState,    NULL                                },
+};
+
+static const Hsm_TransitionTypeDef errorTransitions[] =
+{
+    { IMU_BRIDGE_CMD_INIT,                  &initState,     NULL                                },
+};
+
+static const Hsm_TransitionTypeDef opTransitions[] =
+{
+    { IMU_BRIDGE_EVT_ERROR,                 &errorState,    NULL                                },
+};
+
+static const Hsm_TransitionTypeDef idleTransitions[] =
+{
+    { IMU_BRIDGE_CMD_SANITY,                &sanityState,   NULL                                },
+    { IMU_BRIDGE_CMD_CONFIG,                &configState,   NULL                                },
+    { IMU_BRIDGE_CMD_READ_MODE,             &readState,     NULL                                },
+    { IMU_BRIDGE_CMD_REALTIME,              &realtimeState, NULL                                },
+};
+
+static const Hsm_TransitionTypeDef sanityTransitions[] =
+{
+    { IMU_BRIDGE_EVT_DONE,                  &idleState,     NULL                                },
+};
+
+static const Hsm_TransitionTypeDef modeTransitions[] =
+{
+    { IMU_BRIDGE_CMD_EXIT,                  &idleState,     IMU_Bridge_ExitAction               },
+};
+
+static const Hsm_TransitionTypeDef configTransitions[] =
+{
+    { IMU_BRIDGE_CMD_CFG_GYRO_FS250,        NULL,           IMU_Bridge_ConfigFullScale          },
+    { IMU_BRIDGE_CMD_CFG_GYRO_FS500,        NULL,           IMU_Bridge_ConfigFullScale          },
+    { IMU_BRIDGE_CMD_CFG_GYRO_FS1000,       NULL,           IMU_Bridge_ConfigFullScale          },
+    { IMU_BRIDGE_CMD_CFG_GYRO_FS2000,       NULL,           IMU_Bridge_ConfigFullScale          },
+    { IMU_BRIDGE_CMD_CFG_ACCEL_FS2,         NULL,           IMU_Bridge_ConfigFullScale          },
+    { IMU_BRIDGE_CMD_CFG_ACCEL_FS4,         NULL,           IMU_Bridge_ConfigFullScale          },
+    { IMU_BRIDGE_CMD_CFG_ACCEL_FS8,         NULL,           IMU_Bridge_ConfigFullScale          },
+    { IMU_BRIDGE_CMD_CFG_ACCEL_FS16,        NULL,           IMU_Bridge_ConfigFullScale          },
+    { IMU_BRIDGE_CMD_CFG_RATE_DIV,          NULL,           IMU_Bridge_ConfigFilter             },
+    { IMU_BRIDGE_CMD_CFG_GYRO_DLPF,         NULL,           IMU_Bridge_ConfigFilter             },
+    { IMU_BRIDGE_CMD_CFG_ACCEL_DLPF,        NULL,           IMU_Bridge_ConfigFilter             },
+    { IMU_BRIDGE_CMD_CFG_RATE_QUERY,        NULL,           IMU_Bridge_ConfigFilter             },
+};
+
+static const Hsm_TransitionTypeDef readTransitions[] =
+{
+    { IMU_BRIDGE_CMD_READ_ACCEL_ALL,        NULL,           IMU_Bridge_ReadAction               },
+    { IMU_BRIDGE_CMD_READ_GYRO_ALL,         NULL,           IMU_Bridge_ReadAction               },
+    { IMU_BRIDGE_CMD_READ_TEMP,             NULL,           IMU_Bridge_ReadAction               },
+    { IMU_BRIDGE_CMD_READ_MAG_ALL,          NULL,           IMU_Bridge_ReadAction               },
+    { IMU_BRIDGE_CMD_READ_NINE_AXIS,        NULL,           IMU_Bridge_ReadAction               },
+};
+
+static const Hsm_TransitionTypeDef realtimeTransitions[] =
+{
+    { IMU_BRIDGE_CMD_REALTIME_GYRO,         NULL,           IMU_Bridge_RealTimeSelect           },
+    { IMU_BRIDGE_CMD_REALTIME_ACCEL,        NULL,           IMU_Bridge_RealTimeSelect           },
+    { IMU_BRIDGE_CMD_REALTIME_TEMP,         NULL,           IMU_Bridge_RealTimeSelect           },
+    { IMU_BRIDGE_CMD_REALTIME_ALL,          NULL,           IMU_Bridge_RealTimeSelect           },
+    { IMU_BRIDGE_CMD_REALTIME_NINE_AXIS,    NULL,           IMU_Bridge_RealTimeSelect           },
+    { IMU_BRIDGE_CMD_REALTIME_BINARY,       NULL,           IMU_Bridge_RealTimeFormat           },
+    { IMU_BRIDGE_CMD_REALTIME_TEXT,         NULL,           IMU_Bridge_RealTimeFormat           },
+    { IMU_BRIDGE_CMD_REALTIME_UNITS,        NULL,           IMU_Bridge_RealTimeFormat           },
+    { IMU_BRIDGE_CMD_REALTIME_ENCODER,      NULL,           IMU_Bridge_RealTimeFormat           },
+    { IMU_BRIDGE_CMD_REALTIME_POLL,         NULL,           IMU_Bridge_RealTimeAcquisition      },
+    { IMU_BRIDGE_CMD_REALTIME_FIFO,         NULL,           IMU_Bridge_RealTimeAcquisition      },
+    { IMU_BRIDGE_CMD_REALTIME_DRDY,         NULL,           IMU_Bridge_RealTimeAcquisition      },
+    { IMU_BRIDGE_CMD_REALTIME_TIMER,        NULL,           IMU_Bridge_RealTimeAcquisition      },
+    { IMU_BRIDGE_CMD_REALTIME_QUERY,        NULL,           IMU_Bridge_RealTimeAcquisition      },
+    { IMU_BRIDGE_CMD_REALTIME_RATE_ACCEL,   NULL,           IMU_Bridge_RealTimeRate             },
+    { IMU_BRIDGE_CMD_REALTIME_RATE_TEMP,    NULL,           IMU_Bridge_RealTimeRate             },
+    { IMU_BRIDGE_CMD_REALTIME_RATE_GYRO,    NULL,           IMU_Bridge_RealTimeRate             },
+};
+
+/*                                      parent      entry                           exit                            do                          transitions                         */
+static const Hsm_StateTypeDef initState     = { NULL,       IMU_Bridge_InitState_Entry,     NULL,                           IMU_Bridge_InitState,       HSM_TABLE(initTransitions)      };
+static const Hsm_StateTypeDef errorState    = { NULL,       IMU_Bridge_ErrorState_Entry,    NULL,                           NULL,                       HSM_TABLE(errorTransitions)     };
+static const Hsm_StateTypeDef opState       = { NULL,       IMU_Bridge_OpState_Entry,       NULL,                           NULL,                       HSM_TABLE(opTransitions)        };
+static const Hsm_StateTypeDef idleState     = { &opState,   IMU_Bridge_IdleState_Entry,     NULL,                           NULL,                       HSM_TABLE(idleTransitions)      };
+static const Hsm_StateTypeDef sanityState   = { &opState,   IMU_Bridge_SanityState_Entry,   NULL,                           IMU_Bridge_SanityState,     HSM_TABLE(sanityTransitions)    };
+static const Hsm_StateTypeDef modeState     = { &opState,   NULL,                           NULL,                           NULL,                       HSM_TABLE(modeTransitions)      };
+static const Hsm_StateTypeDef configState   = { &modeState, IMU_Bridge_ConfigState_Entry,   NULL,                           NULL,                       HSM_TABLE(configTransitions)    };
+static const Hsm_StateTypeDef readState     = { &modeState, IMU_Bridge_ReadState_Entry,     NULL,                           NULL,                       HSM_TABLE(readTransitions)      };
+static const Hsm_StateTypeDef realtimeState = { &modeState, IMU_Bridge_RealTimeState_Entry, IMU_Bridge_RealTimeState_Exit,  IMU_Bridge_RealTimeState,   HSM_TABLE(realtimeTransitions)  };
+
 /* Private variables ---------------------------------------------------------*/
-static IMU_Bridge_FsmStateTypeDef bridge_fsm_state; /*!< IMU Bridge FSM status              */
-static IMU_Bridge_OpStateTypeDef bridge_op_state;   /*!< IMU Bridge FSM status              */
+static Hsm_TypeDef bridge_hsm;                      /*!< IMU Bridge state machine           */
+static uint32_t bridge_dispatch_max_cycles = 0;     /*!< Worst case command dispatch time   */
 static delay_t realtime_delay;                      /*!< Real Time delay (sys tick timer)   */
 static IMU_Bridge_RealTime_SelTypeDef realtime_sel; /*!< Real Time mode sensor selection    */
+static const IMU_Bridge_EncoderTypeDef* realtime_encoder;  /*!< Real Time output format */
+static uint16_t realtime_seq;                       /*!< Real Time record sequence          */
+static IMU_Bridge_AcqTypeDef realtime_acq;          /*!< Real Time acquisition mode         */
+static uint8_t realtime_fifo_mask;                  /*!< Sensors in the FIFO, 0 if stopped  */
+static uint32_t realtime_period_us = IMU_BRIDGE_TIMER_PERIOD_DEF;   /*!< Timer sampling period  */
+static uint32_t realtime_period_ms = IMU_BRIDGE_REALTIME_PERIOD;    /*!< Delay sampling period  */
+static uint16_t realtime_rates[IMU_MULTI_CHANNELS] =                /*!< Multi-rate stream rates, Hz */
+{
+    IMU_BRIDGE_RATE_ACCEL_DEF, IMU_BRIDGE_RATE_TEMP_DEF, IMU_BRIDGE_RATE_GYRO_DEF
+};
 
 /**
  * @brief IMU Bridge FSM initialization
@@ -73,119 +204,89 @@ static IMU_Bridge_RealTime_SelTypeDef realtime_sel; /*!< Real Time mode sensor s
 void IMU_Bridge_FsmInit(void)
 {
     IMU_Bridge_Init();
-    bridge_fsm_state = IMU_BRIDGE_FSM_INIT_STATE;
+    Hsm_Init(&bridge_hsm, &initState);
+    IMU_Bridge_EventPost(IMU_BRIDGE_EVENT_FSM);
 }
 
 /**
  * @brief IMU Bridge FSM update
+ * @note Only runs on pending events, call IMU_Bridge_Sleep() in between
 */
 void IMU_Bridge_FsmUpdate(void)
 {
-    IMU_Bridge_StatusTypeDef status = IMU_BRIDGE_ERROR;
+    const Hsm_StateTypeDef* pLastState = bridge_hsm.pState;
+    uint32_t events = IMU_Bridge_EventTake();
+    IMU_Bridge_CmdTypeDef cmd;
+    uint32_t cycles;
 
-    switch (bridge_fsm_state)
+    if (events == 0) return;
+    if (events & IMU_BRIDGE_EVENT_RX) IMU_Bridge_ProcessRx();
+
+    cmd = IMU_Bridge_GetCmd();
+    if (cmd != IMU_BRIDGE_CMD_INVALID)
     {
-    case IMU_BRIDGE_FSM_INIT_STATE:
-        status = IMU_Bridge_InitState();
-        bridge_fsm_state = IMU_BRIDGE_FSM_OP_STATE; 
-        bridge_op_state = IMU_BRIDGE_FSM_OP_IDLE_STATE;
-        IMU_Bridge_OpState_Entry();
-        IMU_Bridge_IdleState_Entry();
-        break;
-    case IMU_BRIDGE_FSM_DEINIT_STATE:
-        /* code */
-        break;
-    case IMU_BRIDGE_FSM_OP_STATE:
-        status = IMU_Bridge_OpState();
-        break;
-    case IMU_BRIDGE_FSM_ERROR_STATE:
-        IMU_Bridge_ErrorState();
-        break;
-    default:
-        status = IMU_BRIDGE_ERROR;
-        break;
+        cycles = Sys_GetCycles();
+        Hsm_Dispatch(&bridge_hsm, cmd);
+        cycles = Sys_GetCycles() - cycles;
+        if (cycles > bridge_dispatch_max_cycles) bridge_dispatch_max_cycles = cycles;
     }
+    Hsm_Run(&bridge_hsm);
 
-    if (status != IMU_BRIDGE_OK) IMU_Bridge_ErrorState_Entry();
+    /* A new state or commands left to decode need another pass */
+    if (bridge_hsm.pState != pLastState || IMU_Bridge_CmdPending()) IMU_Bridge_EventPost(IMU_BRIDGE_EVENT_FSM);
 }
 
 /**
- * @brief IMU Bridge Init state
+ * @brief   Get FSM statistics
+ * @param   pDispatchMaxCycles: worst case command dispatch, transition actions included
 */
-static IMU_Bridge_StatusTypeDef IMU_Bridge_InitState(void)
+void IMU_Bridge_FsmGetStats(uint32_t* pDispatchMaxCycles)
 {
-    char* msg = "INIT STATE\n\r";
-    IMU_Bridge_SendString(msg);
-    if (MPU9250_Init() != MPU9250_OK) return IMU_BRIDGE_ERROR;
-    return IMU_BRIDGE_OK;
+    *pDispatchMaxCycles = bridge_dispatch_max_cycles;
 }
 
 /**
- * @brief IMU Bridge Error state entry
+ * @brief Map a status to the follow-up event
 */
-static void IMU_Bridge_ErrorState_Entry(void)
+static uint32_t IMU_Bridge_StatusEvent(IMU_Bridge_StatusTypeDef status)
 {
-    char* msg = "ERROR STATE\n\r";
+    return (status == IMU_BRIDGE_OK) ? HSM_EVENT_NONE : IMU_BRIDGE_EVT_ERROR;
+}
+
+/**
+ * @brief IMU Bridge Init state entry
+*/
+static void IMU_Bridge_InitState_Entry(void)
+{
+    char* msg = "INIT STATE\n\r";
     IMU_Bridge_SendString(msg);
-    bridge_fsm_state = IMU_BRIDGE_FSM_ERROR_STATE;
 }
 
 /**
- * @brief IMU Bridge Error state
+ * @brief IMU Bridge Init state
 */
-static void IMU_Bridge_ErrorState(void)
+static uint32_t IMU_Bridge_InitState(uint32_t event)
 {
-    if (IMU_Bridge_GetCmd() == IMU_BRIDGE_CMD_INIT)
-    {
-        bridge_fsm_state = IMU_BRIDGE_FSM_INIT_STATE;
-    }
+    if (IMU_Bridge_SensorInit() != IMU_BRIDGE_OK) return IMU_BRIDGE_EVT_ERROR;
+    return IMU_BRIDGE_EVT_DONE;
 }
 
 /**
- * @brief IMU Bridge Operational state entry
+ * @brief IMU Bridge Error state entry
 */
-static void IMU_Bridge_OpState_Entry(void)
+static void IMU_Bridge_ErrorState_Entry(void)
 {
-    char* msg = "OP STATE\n\r";
+    char* msg = "ERROR STATE\n\r";
     IMU_Bridge_SendString(msg);
 }
 
 /**
- * @brief IMU Bridge Operational state
+ * @brief IMU Bridge Operational state entry
 */
-static IMU_Bridge_StatusTypeDef IMU_Bridge_OpState(void)
+static void IMU_Bridge_OpState_Entry(void)
 {
-    IMU_Bridge_StatusTypeDef status = IMU_BRIDGE_ERROR;
-
-    switch (bridge_op_state)
-    {
-    case IMU_BRIDGE_FSM_OP_SANITY_STATE:
-        status = IMU_Bridge_SanityState();
-        break;
-
-    case IMU_BRIDGE_FSM_OP_READ_STATE:
-        status = IMU_Bridge_ReadState();
-        break;
-
-    case IMU_BRIDGE_FSM_OP_IDLE_STATE:
-        status = IMU_Bridge_IdleState();
-        break;
-
-    case IMU_BRIDGE_FSM_OP_CONFIG_STATE:
-        status = IMU_Bridge_ConfigState();
-        break;
-
-    case IMU_BRIDGE_FSM_OP_REALTIME_STATE:
-        status = IMU_Bridge_RealTimeState();
-        break;
-    
-    default:
-        status = IMU_BRIDGE_ERROR;
-        break;
-    }
-
-    return status;
-
+    char* msg = "OP STATE\n\r";
+    IMU_Bridge_SendString(msg);
 }
 
 /**
@@ -198,54 +299,37 @@ static void IMU_Bridge_IdleState_Entry(void)
 }
 
 /**
- * @brief IMU Bridge Idle State
+ * @brief IMU Bridge Sanity State entry
 */
-static IMU_Bridge_StatusTypeDef IMU_Bridge_IdleState(void)
+static void IMU_Bridge_SanityState_Entry(void)
 {
-    switch (IMU_Bridge_GetCmd())
-    {
-    case IMU_BRIDGE_CMD_SANITY:
-        bridge_op_state = IMU_BRIDGE_FSM_OP_SANITY_STATE;
-        break;
-
-    case IMU_BRIDGE_CMD_CONFIG:
-        bridge_op_state = IMU_BRIDGE_FSM_OP_CONFIG_STATE;
-        IMU_Bridge_ConfigState_Entry();
-        break;
-    
-    case IMU_BRIDGE_CMD_READ_MODE:
-        bridge_op_state = IMU_BRIDGE_FSM_OP_READ_STATE;
-        IMU_Bridge_ReadState_Entry();
-        break;
-    
-    case IMU_BRIDGE_CMD_REALTIME:
-        bridge_op_state = IMU_BRIDGE_FSM_OP_REALTIME_STATE;
-        IMU_Bridge_RealTimeState_Entry();
-        break;
-
-    default:
-        break;
-    }
-
-    return IMU_BRIDGE_OK;
+    char* msg = "SANITY STATE\n\r";
+    IMU_Bridge_SendString(msg);
 }
 
 /**
  * @brief IMU Bridge Sanity State
 */
-static IMU_Bridge_StatusTypeDef IMU_Bridge_SanityState(void)
+static uint32_t IMU_Bridge_SanityState(uint32_t event)
 {
-    char* msg = "SANITY STATE\n\r";
-    IMU_Bridge_SendString(msg);
-    if (MPU9250_SanityCheck() != MPU9250_OK){
+    if (IMU_Bridge_SensorCheck() != IMU_BRIDGE_OK){
         char* ans = "---> Sanity Check: ERROR\n\r";
         IMU_Bridge_SendString(ans);
-        return IMU_BRIDGE_ERROR;
+        return IMU_BRIDGE_EVT_ERROR;
     } 
     char* ans = "---> Sanity Check: OK\n\r";
     IMU_Bridge_SendString(ans);
-    bridge_op_state = IMU_BRIDGE_FSM_OP_IDLE_STATE;   
-    return IMU_BRIDGE_OK;
+    return IMU_BRIDGE_EVT_DONE;
+}
+
+/**
+ * @brief   Exit command action, from any mode back to Idle
+*/
+static uint32_t IMU_Bridge_ExitAction(uint32_t event)
+{
+    hline();
+    IMU_Bridge_SendString("EXIT\n\r");
+    return HSM_EVENT_NONE;
 }
 
 /**
@@ -253,44 +337,117 @@ static IMU_Bridge_StatusTypeDef IMU_Bridge_SanityState(void)
 */
 static void IMU_Bridge_ConfigState_Entry(void)
 {
-    char msg[100];
+    char* msg;
     uint8_t gyroConfig;
     uint8_t accelConfig;
 
-    strcpy(msg, "CONFIG STATE\n\r");
-    IMU_Bridge_SendString(msg);
+    IMU_Bridge_SendString("CONFIG STATE\n\r");
 
-    MPU9250_GyroReadConfig(&gyroConfig);
-    MPU9250_AccelReadConfig(&accelConfig);
-    sprintf(msg, "GYRO CONFIG WORD: 0x%X\n\rACCEL CONFIG WORD: 0x%x\n\r", gyroConfig, accelConfig);
-    IMU_Bridge_SendString(msg);
+    /* From the registers cache, no bus access */
+    gyroConfig = IMU_Bridge_ShadowGet(IMU_REG_GYRO_CONFIG);
+    accelConfig = IMU_Bridge_ShadowGet(IMU_REG_ACCEL_CONFIG);
+    msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    if (msg == NULL) return;
+    IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE,
+        "GYRO CONFIG WORD: 0x%X\n\rACCEL CONFIG WORD: 0x%x\n\r", gyroConfig, accelConfig));
 }
 
 /**
- * @brief IMU Bridge Configuration State
+ * @brief   IMU Bridge Configuration State, full scale commands
+ * @note    The commands are in FS_SEL order, CG1 to CG4 and CA1 to CA4
 */
-static IMU_Bridge_StatusTypeDef IMU_Bridge_ConfigState(void)
+static uint32_t IMU_Bridge_ConfigFullScale(uint32_t event)
 {
-    char msg[100];
+    char* msg;
+    uint16_t gyroFs, accelFs;
+    IMU_Bridge_StatusTypeDef status;
 
-    IMU_Bridge_CmdTypeDef next_cmd = IMU_Bridge_GetCmd();
+    if (event >= IMU_BRIDGE_CMD_CFG_GYRO_FS250 && event <= IMU_BRIDGE_CMD_CFG_GYRO_FS2000)
+    {
+        status = IMU_Bridge_GyroSetFullScale((uint8_t)(event - IMU_BRIDGE_CMD_CFG_GYRO_FS250));
+    }
+    else
+    {
+        status = IMU_Bridge_AccelSetFullScale((uint8_t)(event - IMU_BRIDGE_CMD_CFG_ACCEL_FS2));
+    }
+    if (status != IMU_BRIDGE_OK) return IMU_BRIDGE_EVT_ERROR;
 
-    if (next_cmd == IMU_BRIDGE_CMD_CFG_GYRO_FS250)
+    IMU_Bridge_GetFullScale(&gyroFs, &accelFs);
+    msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    if (msg == NULL) return HSM_EVENT_NONE;
+    if (event <= IMU_BRIDGE_CMD_CFG_GYRO_FS2000)
     {
-        MPU9250_GyroSetFullScale(MPU9250_GYRO_CONFIG_250DPS);
-        strcpy(msg, "Setting Gyro Full Scale to 250 dps\n\r");
-        IMU_Bridge_SendString(msg);
+        IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE, "Setting Gyro Full Scale to %u dps\n\r", gyroFs));
     }
-    if (next_cmd == IMU_BRIDGE_CMD_CFG_GYRO_FS500)
+    else
     {
-        MPU9250_GyroSetFullScale(MPU9250_GYRO_CONFIG_500DPS);
-        strcpy(msg, "Setting Gyro Full Scale to 500 dps\n\r");
-        IMU_Bridge_SendString(msg);
+        IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE, "Setting Accel Full Scale to %u g\n\r", accelFs));
     }
+    return HSM_EVENT_NONE;
+}
 
-    if (checkExitEvent(next_cmd)) bridge_op_state = IMU_BRIDGE_FSM_OP_IDLE_STATE;
-    
-    return IMU_BRIDGE_OK;
+/**
+ * @brief   IMU Bridge Configuration State, rate and bandwidth commands
+ * @note    "CSD <div>" sets SMPLRT_DIV, the rate is 1 kHz / (1 + div),
+ *          "CGF <cfg>" the gyro DLPF_CFG and "CAF <cfg>" the accel A_DLPF_CFG.
+ *          Rejected unless the rate is at least twice both bandwidths.
+*/
+static uint32_t IMU_Bridge_ConfigFilter(uint32_t event)
+{
+    IMU_Bridge_FilterTypeDef filter;
+    uint8_t rateDiv;
+    uint32_t value = 0;
+
+    if (event == IMU_BRIDGE_CMD_CFG_RATE_QUERY)
+    {
+        IMU_Bridge_RateQuery();
+        return HSM_EVENT_NONE;
+    }
+
+    IMU_Bridge_FilterGet(&filter, &rateDiv);
+    if (IMU_Bridge_GetCmdArg(&value) != IMU_BRIDGE_OK || value > UINT8_MAX)
+    {
+        IMU_Bridge_SendString("INVALID ARGUMENT\n\r");
+        return HSM_EVENT_NONE;
+    }
+    if (event == IMU_BRIDGE_CMD_CFG_RATE_DIV)
+    {
+        filter.rateDiv = (uint8_t)value;
+        filter.rateSet = true;
+    }
+    if (event == IMU_BRIDGE_CMD_CFG_GYRO_DLPF) filter.gyroDlpf = (uint8_t)value;
+    if (event == IMU_BRIDGE_CMD_CFG_ACCEL_DLPF) filter.accelDlpf = (uint8_t)value;
+
+    if (!IMU_Bridge_FilterCheck(&filter))
+    {
+        IMU_Bridge_SendString("INVALID FILTER, GYRO 1..6, ACCEL 0..7, RATE >= 2 x BW\n\r");
+        return HSM_EVENT_NONE;
+    }
+    if (IMU_Bridge_FilterSet(&filter) != IMU_BRIDGE_OK) return IMU_BRIDGE_EVT_ERROR;
+    IMU_Bridge_RateQuery();
+    return HSM_EVENT_NONE;
+}
+
+/**
+ * @brief   Send the effective output data rate and the filter bandwidths
+*/
+static void IMU_Bridge_RateQuery(void)
+{
+    char* msg;
+    IMU_Bridge_FilterTypeDef filter;
+    uint8_t rateDiv;
+    uint32_t rate;
+
+    IMU_Bridge_FilterGet(&filter, &rateDiv);
+    rate = (IMU_INTERNAL_RATE * 1000U) / (1U + rateDiv);   /* mHz */
+
+    msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE, "ODR:\t%lu.%03lu Hz (DIV %u%s)\n\r",
+        (unsigned long)(rate / 1000U), (unsigned long)(rate % 1000U), rateDiv, filter.rateSet ? "" : ", MODE DEFAULT"));
+    msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE, "GYRO BW:\t%u Hz (DLPF %u)\n\rACCEL BW:\t%u Hz (DLPF %u)\n\r",
+        IMU_Bridge_FilterGyroBandwidth(filter.gyroDlpf), filter.gyroDlpf,
+        IMU_Bridge_FilterAccelBandwidth(filter.accelDlpf), filter.accelDlpf));
 }
 
 /**
@@ -298,53 +455,74 @@ static IMU_Bridge_StatusTypeDef IMU_Bridge_ConfigState(void)
 */
 static void IMU_Bridge_ReadState_Entry(void)
 {
-    char msg[200];
-    strcpy(msg, "READ STATE\n\r");
-    IMU_Bridge_SendString(msg);
+    IMU_Bridge_SendString("READ STATE\n\r");
 }
 
 /**
- * @brief IMU Bridge Read State
+ * @brief IMU Bridge Read State, read commands
 */
-static IMU_Bridge_StatusTypeDef IMU_Bridge_ReadState(void)
+static uint32_t IMU_Bridge_ReadAction(uint32_t event)
 {
-    char msg[200];
-    uint16_t AxisX, AxisY, AxisZ, Temp;
-    IMU_Bridge_CmdTypeDef next_cmd = IMU_Bridge_GetCmd();
+    IMU_Bridge_SampleTypeDef sample;
 
-    switch (next_cmd)
+    switch (event)
     {
     case IMU_BRIDGE_CMD_READ_ACCEL_ALL:
         hline();
-        MPU9250_AccelReadRaw(&AxisX, &AxisY, &AxisZ);
-        sprintf(msg, "ACCEL READ:\t%d\t%d\t%d\n\r", AxisX, AxisY, AxisZ);
-        IMU_Bridge_SendString(msg);
+        if (IMU_Bridge_SensorRead(IMU_BRIDGE_SENSOR_ACCEL, &sample) != IMU_BRIDGE_OK) return IMU_BRIDGE_EVT_ERROR;
+        IMU_Bridge_SendRecord("ACCEL READ:", sample.accel, 3, true);
         hline();
         break;
     
     case IMU_BRIDGE_CMD_READ_GYRO_ALL:
         hline();
-        MPU9250_GyroReadRaw(&AxisX, &AxisY, &AxisZ);
-        sprintf(msg, "GYRO READ:\t%d\t%d\t%d\n\r", AxisX, AxisY, AxisZ);
-        IMU_Bridge_SendString(msg);
+        if (IMU_Bridge_SensorRead(IMU_BRIDGE_SENSOR_GYRO, &sample) != IMU_BRIDGE_OK) return IMU_BRIDGE_EVT_ERROR;
+        IMU_Bridge_SendRecord("GYRO READ:", sample.gyro, 3, true);
         hline();
         break;
     
     case IMU_BRIDGE_CMD_READ_TEMP:
         hline();
-        MPU9250_TempReadRaw(&Temp);
-        sprintf(msg, "TEMP READ:\t%d\n\r", Temp);
-        IMU_Bridge_SendString(msg);
+        if (IMU_Bridge_SensorRead(IMU_BRIDGE_SENSOR_TEMP, &sample) != IMU_BRIDGE_OK) return IMU_BRIDGE_EVT_ERROR;
+        IMU_Bridge_SendRecord("TEMP READ:", &sample.temp, 1, true);
+        hline();
+        break;
+
+    case IMU_BRIDGE_CMD_READ_MAG_ALL:
+        hline();
+        if (IMU_Bridge_SensorRead(IMU_BRIDGE_SENSOR_MAG, &sample) != IMU_BRIDGE_OK || !(sample.mask & IMU_BRIDGE_SENSOR_MAG))
+        {
+            IMU_Bridge_SendString("MAG READ: not available\n\r");
+            hline();
+            break;
+        }
+        IMU_Bridge_SendRecord("MAG READ:", sample.mag, 3, false);
+        hline();
+        break;
+
+    case IMU_BRIDGE_CMD_READ_NINE_AXIS:
+    {
+        int16_t values[IMU_BRIDGE_FRAME_MAX_CHANNELS];
+        uint8_t mask = IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_TEMP | IMU_BRIDGE_SENSOR_GYRO | IMU_BRIDGE_SENSOR_MAG;
+
+        hline();
+        if (IMU_Bridge_SensorRead(mask, &sample) != IMU_BRIDGE_OK)
+        {
+            IMU_Bridge_SendString("IMU9 READ: not available\n\r");
+            hline();
+            break;
+        }
+        /* Without the magnetometer on an AK8963 overflow */
+        IMU_Bridge_SampleValues(sample.mask, &sample, values);
+        IMU_Bridge_SendRecord("IMU9 READ:", values, IMU_Bridge_FrameChannels(sample.mask), false);
         hline();
         break;
+    }
     
     default:
         break;
     }
-
-    if (checkExitEvent(next_cmd)) bridge_op_state = IMU_BRIDGE_FSM_OP_IDLE_STATE;
-    
-    return IMU_BRIDGE_OK;
+    return HSM_EVENT_NONE;
 }
 
 /**
@@ -352,24 +530,34 @@ static IMU_Bridge_StatusTypeDef IMU_Bridge_ReadState(void)
 */
 static void IMU_Bridge_RealTimeState_Entry(void)
 {
-    char msg[200];
     realtime_sel = IMU_BRIDGE_REALTIME_ACCEL;
+    IMU_Bridge_EncoderSet(IMU_BRIDGE_ENCODER_TEXT);
+    realtime_seq = 0;
+    realtime_acq = IMU_BRIDGE_ACQ_POLL;
+    realtime_fifo_mask = 0;
+    IMU_Bridge_SampleResetStats();
+    IMU_Bridge_EventTickEnable(true);
     hline();
-    strcpy(msg, "REAL TIME STATE\n\r");
-    IMU_Bridge_SendString(msg);
-    delay_init(&realtime_delay, IMU_BRIDGE_REALTIME_PERIOD);  // Sys-tick based delay. It establishes the sampling rate
+    IMU_Bridge_SendString("REAL TIME STATE\n\r");
+    delay_init(&realtime_delay, realtime_period_ms);  // Sys-tick based delay. It establishes the sampling rate
 }
 
 /**
- * @brief IMU Bridge Real Time state
+ * @brief Exit event from Real Time state
 */
-static IMU_Bridge_StatusTypeDef IMU_Bridge_RealTimeState(void)
+static void IMU_Bridge_RealTimeState_Exit(void)
 {
-    char msg[200];
-    IMU_Bridge_CmdTypeDef next_cmd = IMU_Bridge_GetCmd();
-    uint16_t AxisX, AxisY, AxisZ, Temp;
+    /* A failure here is a bus error, the next state reports it on its own access */
+    IMU_Bridge_RealTimeSetAcq(IMU_BRIDGE_ACQ_POLL);
+    IMU_Bridge_EventTickEnable(false);
+}
 
-    switch (next_cmd)
+/**
+ * @brief Real Time sensor selection commands
+*/
+static uint32_t IMU_Bridge_RealTimeSelect(uint32_t event)
+{
+    switch (event)
     {
     case IMU_BRIDGE_CMD_REALTIME_GYRO:
         realtime_sel = IMU_BRIDGE_REALTIME_GYRO;
@@ -382,58 +570,391 @@ static IMU_Bridge_StatusTypeDef IMU_Bridge_RealTimeState(void)
     case IMU_BRIDGE_CMD_REALTIME_TEMP:
         realtime_sel = IMU_BRIDGE_REALTIME_TEMP;
         break;
-    
+
+    case IMU_BRIDGE_CMD_REALTIME_NINE_AXIS:
+        if (!IMU_Bridge_MagIsReady())
+        {
+            IMU_Bridge_SendString("---> Magnetometer not available\n\r");
+            break;
+        }
+        realtime_sel = IMU_BRIDGE_REALTIME_NINE_AXIS;
+        break;
+
     default:
+        realtime_sel = IMU_BRIDGE_REALTIME_ALL;
         break;
     }
+    return HSM_EVENT_NONE;
+}
+
+/**
+ * @brief   Real Time output format commands, "RTE <encoder>" selects any
+ *          encoder, without argument lists them. RTX, RTU and RTB are
+ *          shortcuts for the text, units and binary encoders.
+*/
+static uint32_t IMU_Bridge_RealTimeFormat(uint32_t event)
+{
+    char* msg;
+    uint32_t id;
 
-    if (delay_read(&realtime_delay))
+    switch (event)
     {
-        if (realtime_sel == IMU_BRIDGE_REALTIME_GYRO) MPU9250_GyroFetch();
-        if (realtime_sel == IMU_BRIDGE_REALTIME_ACCEL) MPU9250_AccelFetch();
-        if (realtime_sel == IMU_BRIDGE_REALTIME_TEMP) MPU9250_TempFetch();
+    case IMU_BRIDGE_CMD_REALTIME_BINARY:
+        id = IMU_BRIDGE_ENCODER_BINARY;
+        break;
+
+    case IMU_BRIDGE_CMD_REALTIME_UNITS:
+        id = IMU_BRIDGE_ENCODER_UNITS;
+        break;
+
+    case IMU_BRIDGE_CMD_REALTIME_ENCODER:
+        if (IMU_Bridge_GetCmdArg(&id) != IMU_BRIDGE_OK)
+        {
+            IMU_Bridge_EncoderList();
+            return HSM_EVENT_NONE;
+        }
+        if (IMU_Bridge_EncoderGet(id) == NULL)
+        {
+            msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+            if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE, "INVALID ENCODER, 0..%u\n\r",
+                IMU_BRIDGE_ENCODER_COUNT - 1U));
+            return HSM_EVENT_NONE;
+        }
+        break;
+
+    default:
+        id = IMU_BRIDGE_ENCODER_TEXT;
+        break;
     }
+    IMU_Bridge_EncoderSet(id);
+    return HSM_EVENT_NONE;
+}
 
-    if (MPU9250_IsDataReady())
+/**
+ * @brief   Select the Real Time output encoder, from a clean state
+*/
+static void IMU_Bridge_EncoderSet(uint32_t id)
+{
+    realtime_encoder = IMU_Bridge_EncoderGet(id);
+    if (realtime_encoder->Reset != NULL) realtime_encoder->Reset();
+}
+
+/**
+ * @brief   Send the encoder list, the current one starred
+*/
+static void IMU_Bridge_EncoderList(void)
+{
+    const IMU_Bridge_EncoderTypeDef* pEncoder;
+    char* msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    char* p;
+
+    if (msg == NULL) return;
+
+    p = Fmt_Str(msg, "ENCODERS:");
+    for (uint32_t id = 0; (pEncoder = IMU_Bridge_EncoderGet(id)) != NULL; id++)
     {
-        if (realtime_sel == IMU_BRIDGE_REALTIME_GYRO){
-            MPU9250_GyroReadFromBuffer(&AxisX, &AxisY, &AxisZ);
-            sprintf(msg, "GYRO READ:\t%d\t%d\t%d\n\r", AxisX, AxisY, AxisZ);
-            IMU_Bridge_SendString(msg);
-        } 
-        if (realtime_sel == IMU_BRIDGE_REALTIME_ACCEL){
-            MPU9250_AccelReadFromBuffer(&AxisX, &AxisY, &AxisZ);
-            sprintf(msg, "ACCEL READ:\t%d\t%d\t%d\n\r", AxisX, AxisY, AxisZ);
-            IMU_Bridge_SendString(msg);
-        } 
-        if (realtime_sel == IMU_BRIDGE_REALTIME_TEMP){
-            MPU9250_TempReadFromBuffer(&Temp);
-            sprintf(msg, "TEMP READ:\t%d\n\r", Temp);
-            IMU_Bridge_SendString(msg);
-        } 
+        *p++ = '\t';
+        p = Fmt_Uint32(p, id);
+        *p++ = ' ';
+        p = Fmt_Str(p, pEncoder->pName);
+        if (pEncoder == realtime_encoder) *p++ = '*';
     }
+    p = Fmt_Str(p, "\n\r");
+    IMU_Bridge_TxCommit((int)(p - msg));
+}
 
-    if (checkExitEvent(next_cmd)) bridge_op_state = IMU_BRIDGE_FSM_OP_IDLE_STATE;
-    
+/**
+ * @brief Real Time acquisition mode commands
+*/
+static uint32_t IMU_Bridge_RealTimeAcquisition(uint32_t event)
+{
+    switch (event)
+    {
+    case IMU_BRIDGE_CMD_REALTIME_FIFO:
+        return IMU_Bridge_StatusEvent(IMU_Bridge_RealTimeSetAcq(IMU_BRIDGE_ACQ_FIFO));
+
+    case IMU_BRIDGE_CMD_REALTIME_DRDY:
+        return IMU_Bridge_StatusEvent(IMU_Bridge_RealTimeSetAcq(IMU_BRIDGE_ACQ_DRDY));
+
+    case IMU_BRIDGE_CMD_REALTIME_TIMER:
+        return IMU_Bridge_StatusEvent(IMU_Bridge_RealTimeSetPeriod());
+
+    case IMU_BRIDGE_CMD_REALTIME_QUERY:
+        IMU_Bridge_RealTimeQuery();
+        return HSM_EVENT_NONE;
+
+    default:
+        IMU_Bridge_RealTimeSetDelay();
+        return IMU_Bridge_StatusEvent(IMU_Bridge_RealTimeSetAcq(IMU_BRIDGE_ACQ_POLL));
+    }
+}
+
+/**
+ * @brief   Real Time stream rate commands, i.e. "RRG 500" for gyro at 500 Hz,
+ *          0 to disable the channel. Switches to multi-rate acquisition, without
+ *          argument the last rate is kept.
+*/
+static uint32_t IMU_Bridge_RealTimeRate(uint32_t event)
+{
+    char* msg;
+    uint32_t rate;
+    uint8_t channel = (event == IMU_BRIDGE_CMD_REALTIME_RATE_ACCEL) ? 0 : (event == IMU_BRIDGE_CMD_REALTIME_RATE_TEMP) ? 1 : 2;
+
+    if (IMU_Bridge_GetCmdArg(&rate) == IMU_BRIDGE_OK)
+    {
+        if (rate > IMU_MULTI_RATE_MAX)
+        {
+            msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+            if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE, "INVALID RATE, 0..%lu Hz\n\r",
+                (unsigned long)IMU_MULTI_RATE_MAX));
+            return HSM_EVENT_NONE;
+        }
+        realtime_rates[channel] = (uint16_t)rate;
+
+        /* Already multi-rate, just change the rates */
+        if (realtime_acq == IMU_BRIDGE_ACQ_MULTI) return IMU_Bridge_StatusEvent(IMU_Bridge_MultiStart(realtime_rates));
+    }
+    return IMU_Bridge_StatusEvent(IMU_Bridge_RealTimeSetAcq(IMU_BRIDGE_ACQ_MULTI));
+}
+
+/**
+ * @brief IMU Bridge Real Time state, streaming
+*/
+static uint32_t IMU_Bridge_RealTimeState(uint32_t event)
+{
+    int16_t values[IMU_BRIDGE_FRAME_MAX_CHANNELS];
+    IMU_Bridge_SampleTypeDef sample;
+    tick_t tick;
+    uint8_t sensor;
+
+    /* (Re)start the FIFO on entering FIFO mode or on a new sensor selection */
+    if (realtime_acq == IMU_BRIDGE_ACQ_FIFO && realtime_fifo_mask != (IMU_Bridge_RealTimeMask() & IMU_FIFO_SENSORS))
+    {
+        realtime_fifo_mask = IMU_Bridge_RealTimeMask() & IMU_FIFO_SENSORS;
+        if (IMU_Bridge_FifoStart(realtime_fifo_mask) != IMU_BRIDGE_OK) return IMU_BRIDGE_EVT_ERROR;
+    }
+
+    if (realtime_acq == IMU_BRIDGE_ACQ_POLL && delay_read(&realtime_delay))
+    {
+        IMU_Bridge_SampleFetchMask(IMU_Bridge_RealTimeMask());
+    }
+
+    if (realtime_acq == IMU_BRIDGE_ACQ_FIFO)
+    {
+        if (IMU_Bridge_FifoUpdate() != IMU_BRIDGE_OK) return IMU_BRIDGE_EVT_ERROR;
+        while (IMU_Bridge_FifoRead(values, &tick)) IMU_Bridge_RealTimeSend(realtime_fifo_mask, tick, values);
+    }
+    else
+    {
+        /* Burst sample, started from the data ready or timer interrupts, or the sys tick delay */
+        if (IMU_Bridge_SampleRead(&sample))
+        {
+            if (realtime_acq != IMU_BRIDGE_ACQ_MULTI)
+            {
+                /* The burst may hold more sensors than selected, or miss a selection changed meanwhile */
+                sensor = IMU_Bridge_RealTimeMask() & sample.mask;
+                if (sensor != 0)
+                {
+                    IMU_Bridge_SampleValues(sensor, &sample, values);
+                    IMU_Bridge_RealTimeSend(sensor, sample.tick, values);
+                }
+            }
+            else
+            {
+                /* Multi-rate, one record per sensor due, tagged with its channel */
+                for (sensor = IMU_BRIDGE_SENSOR_ACCEL; sensor <= IMU_BRIDGE_SENSOR_GYRO; sensor <<= 1)
+                {
+                    if (!(sample.mask & sensor)) continue;
+                    IMU_Bridge_SampleValues(sensor, &sample, values);
+                    IMU_Bridge_RealTimeSend(sensor, sample.tick, values);
+                }
+            }
+        }
+    }
+
+    return HSM_EVENT_NONE;
+}
+
+/**
+ * @brief   Switch the Real Time acquisition mode
+ * @param   acq: new acquisition mode
+*/
+static IMU_Bridge_StatusTypeDef IMU_Bridge_RealTimeSetAcq(IMU_Bridge_AcqTypeDef acq)
+{
+    if (acq == realtime_acq) return IMU_BRIDGE_OK;
+
+    if (IMU_Bridge_FifoStop() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    if (IMU_Bridge_DrdyStop() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    if (IMU_Bridge_TimerStop() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    if (IMU_Bridge_MultiStop() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    realtime_acq = acq;
+    realtime_fifo_mask = 0;     /* FIFO started on the next update */
+    IMU_Bridge_SampleResetStats();
+
+    /* Sys tick events for the delay paced fetch and the FIFO count polling */
+    IMU_Bridge_EventTickEnable(acq == IMU_BRIDGE_ACQ_POLL || acq == IMU_BRIDGE_ACQ_FIFO);
+
+    if (acq == IMU_BRIDGE_ACQ_DRDY) return IMU_Bridge_DrdyStart();
+    if (acq == IMU_BRIDGE_ACQ_TIMER) return IMU_Bridge_TimerStart(realtime_period_us);
+    if (acq == IMU_BRIDGE_ACQ_MULTI) return IMU_Bridge_MultiStart(realtime_rates);
     return IMU_BRIDGE_OK;
 }
 
 /**
- * @brief   Check for exit command event
- * @param   cmd: Command received
- * @retval  bool
+ * @brief   Switch to timer paced acquisition, with the period in us given
+ *          as argument, i.e. "RTS 2500" for 400 Hz. Without argument the
+ *          last period is kept.
+*/
+static IMU_Bridge_StatusTypeDef IMU_Bridge_RealTimeSetPeriod(void)
+{
+    char* msg;
+    uint32_t period;
+
+    if (IMU_Bridge_GetCmdArg(&period) == IMU_BRIDGE_OK)
+    {
+        if (period < IMU_BRIDGE_TIMER_PERIOD_MIN || period > IMU_BRIDGE_TIMER_PERIOD_MAX)
+        {
+            msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+            if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE, "INVALID PERIOD, %lu..%lu us\n\r",
+                (unsigned long)IMU_BRIDGE_TIMER_PERIOD_MIN, (unsigned long)IMU_BRIDGE_TIMER_PERIOD_MAX));
+            return IMU_BRIDGE_OK;
+        }
+        realtime_period_us = period;
+
+        /* Already timer paced, just change the period */
+        if (realtime_acq == IMU_BRIDGE_ACQ_TIMER) return IMU_Bridge_TimerStart(realtime_period_us);
+    }
+    return IMU_Bridge_RealTimeSetAcq(IMU_BRIDGE_ACQ_TIMER);
+}
+
+/**
+ * @brief   Set the delay paced sampling period, in ms given as argument,
+ *          i.e. "RTP 20" for 50 Hz. Without argument the last period is kept.
 */
-static bool checkExitEvent(IMU_Bridge_CmdTypeDef cmd)
+static void IMU_Bridge_RealTimeSetDelay(void)
 {
-    char msg[200];
-    if (cmd == IMU_BRIDGE_CMD_EXIT)
+    char* msg;
+    uint32_t period;
+
+    if (IMU_Bridge_GetCmdArg(&period) != IMU_BRIDGE_OK) return;
+    if (period == 0 || period > IMU_BRIDGE_REALTIME_PERIOD_MAX)
     {
-        hline();
-        strcpy(msg, "EXIT\n\r");
-        IMU_Bridge_SendString(msg);
-        return true;
+        msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+        if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE, "INVALID PERIOD, 1..%lu ms\n\r",
+            (unsigned long)IMU_BRIDGE_REALTIME_PERIOD_MAX));
+        return;
     }
-    return false;
+    realtime_period_ms = period;
+    delay_write(&realtime_delay, realtime_period_ms);
+}
+
+/**
+ * @brief   Send the sampling period, configured and measured, and its jitter
+*/
+static void IMU_Bridge_RealTimeQuery(void)
+{
+    char* msg;
+    uint32_t minPeriod, maxPeriod, missed;
+
+    IMU_Bridge_SampleGetStats(&minPeriod, &maxPeriod, &missed);
+    minPeriod = Sys_CyclesToUs(minPeriod);
+    maxPeriod = Sys_CyclesToUs(maxPeriod);
+
+    msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE, "PERIOD SET:\t%lu us\n\rPERIOD MEAS:\t%lu..%lu us\n\r",
+        (unsigned long)realtime_period_us, (unsigned long)minPeriod, (unsigned long)maxPeriod));
+    msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE, "JITTER:\t%lu us\n\rMISSED:\t%lu\n\r",
+        (unsigned long)(maxPeriod - minPeriod), (unsigned long)missed));
+    IMU_Bridge_RateQuery();
+    msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    if (msg != NULL) IMU_Bridge_TxCommit(snprintf(msg, IMU_BRIDGE_TX_LINE_SIZE, "RATES A T G:\t%u\t%u\t%u Hz\n\r",
+        realtime_rates[0], realtime_rates[1], realtime_rates[2]));
+}
+
+/**
+ * @brief   Sensors of the Real Time selection
+ * @retval  IMU_Bridge_SensorTypeDef mask
+*/
+static uint8_t IMU_Bridge_RealTimeMask(void)
+{
+    switch (realtime_sel)
+    {
+    case IMU_BRIDGE_REALTIME_GYRO:
+        return IMU_BRIDGE_SENSOR_GYRO;
+    case IMU_BRIDGE_REALTIME_ACCEL:
+        return IMU_BRIDGE_SENSOR_ACCEL;
+    case IMU_BRIDGE_REALTIME_TEMP:
+        return IMU_BRIDGE_SENSOR_TEMP;
+    case IMU_BRIDGE_REALTIME_NINE_AXIS:
+        return IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_TEMP | IMU_BRIDGE_SENSOR_GYRO | IMU_BRIDGE_SENSOR_MAG;
+    default:
+        return IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_TEMP | IMU_BRIDGE_SENSOR_GYRO;
+    }
+}
+
+/**
+ * @brief   Pack the selected channels of a burst sample
+ * @param   mask: sensors to pack
+ * @param   pSample: burst sample
+ * @param   pValues: channel values, frame payload order (accel, temp, gyro, mag)
+*/
+static void IMU_Bridge_SampleValues(uint8_t mask, const IMU_Bridge_SampleTypeDef* pSample, int16_t* pValues)
+{
+    if (mask & IMU_BRIDGE_SENSOR_ACCEL)
+    {
+        *pValues++ = pSample->accel[0]; *pValues++ = pSample->accel[1]; *pValues++ = pSample->accel[2];
+    }
+    if (mask & IMU_BRIDGE_SENSOR_TEMP) *pValues++ = pSample->temp;
+    if (mask & IMU_BRIDGE_SENSOR_GYRO)
+    {
+        *pValues++ = pSample->gyro[0]; *pValues++ = pSample->gyro[1]; *pValues++ = pSample->gyro[2];
+    }
+    if (mask & IMU_BRIDGE_SENSOR_MAG)
+    {
+        *pValues++ = pSample->mag[0]; *pValues++ = pSample->mag[1]; *pValues++ = pSample->mag[2];
+    }
+}
+
+/**
+ * @brief   Send a Real Time sample, in the selected output format
+ * @param   mask: sensors of the sample
+ * @param   tick: sample timestamp
+ * @param   pValues: channel values
+*/
+static void IMU_Bridge_RealTimeSend(uint8_t mask, tick_t tick, const int16_t* pValues)
+{
+    IMU_Bridge_RecordTypeDef record = { mask, realtime_seq++, tick, pValues };  /* Counted even if dropped, the host sees the gap */
+    char* msg;
+
+    msg = IMU_Bridge_TxReserve(realtime_encoder->maxSize);
+    if (msg != NULL)
+    {
+        IMU_Bridge_TxCommitData(realtime_encoder->Record((uint8_t*)msg, &record));
+    }
+    else if (realtime_encoder->Reset != NULL)
+    {
+        /* The host misses this record, a delta on it couldn't be decoded */
+        realtime_encoder->Reset();
+    }
+}
+
+/**
+ * @brief   Send a Read mode text line: label, tab separated values
+ * @param   asUnsigned: values as raw uint16, as the single sensor lines always did
+ * @note    Same line format as the text output encoder, without timestamp
+*/
+static void IMU_Bridge_SendRecord(const char* pLabel, const int16_t* pValues, uint8_t count, bool_t asUnsigned)
+{
+    char* msg = IMU_Bridge_TxReserve(IMU_BRIDGE_TX_LINE_SIZE);
+    char* p;
+
+    if (msg == NULL) return;
+
+    p = Fmt_Str(msg, pLabel);
+    p = Fmt_Fields(p, pValues, count, asUnsigned);
+    p = Fmt_Str(p, "\n\r");
+    IMU_Bridge_TxCommit((int)(p - msg));
 }
 
 /**
@@ -0,0 +1,932 @@
+/**
+  ******************************************************************************
+  * @file           : imu_bridge_sensor.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : IMU Bridge sensor acquisition
+  ******************************************************************************
+  * @attention
+  *
+  * IMU Bridge sensor acquisition. Accel, temperature and gyro data registers
+  * are contiguous, so a whole sample is read in one bus transaction,
+  * started from the main loop or straight from the data ready or the sample
+  * timer interrupts.
+  * In FIFO mode the chip buffers the samples at its own rate and whole frames
+  * are drained in large bursts, a few transactions for many samples.
+  * Acquisition reads are bus jobs: the FIFO drain is chained from the
+  * FIFO_COUNT completion interrupt, without a pass through the main loop.
+  * The configuration registers, SMPLRT_DIV to ACCEL_CONFIG2, are contiguous
+  * and cached in RAM: reads don't touch the bus and changes are written back
+  * in a single transaction.
+  * In multi-rate mode each sensor has its own rate. A 1 kHz timer schedules
+  * them and the sensors due on a tick are read in a single burst, over the
+  * register range covering them.
+  * Only the bridge port touches the bus, so the acquisition runs the same
+  * over I2C or SPI.
+  * The AK8963 magnetometer sits on the MPU9250 auxiliary I2C bus. The MPU9250
+  * I2C master reads it on each sample into EXT_SENS_DATA, contiguous with
+  * the gyro registers, so a 9-axis sample is still a single burst.
+  *
+  ******************************************************************************
+  */
+
+#include "imu_bridge_sensor.h"
+#include "imu_bridge_frame.h"
+#include "port_imu.h"
+#include "port_timer.h"
+#include "port_uart.h"
+
+#include <assert.h>
+
+static uint8_t pSampleBuffer[IMU_SAMPLE_MAG_SIZE];  /*!< Burst read DMA buffer              */
+static tick_t sampleTick;                           /*!< Tick when the burst was started    */
+static volatile bool_t samplePending = false;       /*!< Burst read queued or in progress   */
+static volatile bool_t sampleReady = false;         /*!< Burst read complete                */
+static uint32_t sampleLastCycles;                   /*!< Cycle count at the last burst      */
+static uint32_t sampleCount = 0;                    /*!< Bursts since the stats reset       */
+static uint32_t sampleMinPeriod = UINT32_MAX;       /*!< Min cycles between bursts          */
+static uint32_t sampleMaxPeriod;                    /*!< Max cycles between bursts          */
+static uint32_t sampleMissed = 0;                   /*!< Bursts not started, bus busy       */
+static volatile bool_t drdyEnabled = false;         /*!< Data ready interrupt acquisition   */
+static bool_t timerEnabled = false;                 /*!< Timer paced acquisition            */
+static volatile uint8_t sampleMask;                 /*!< Sensors of the burst in progress   */
+static bool_t magReady = false;                     /*!< AK8963 found, auto read set up     */
+
+static volatile bool_t multiEnabled = false;        /*!< Multi-rate acquisition             */
+static uint16_t pMultiRates[IMU_MULTI_CHANNELS];    /*!< Channel rates, Hz, 0 if disabled   */
+static uint16_t pMultiPhase[IMU_MULTI_CHANNELS];    /*!< Channel rate accumulators          */
+static uint8_t multiDue;                            /*!< Channels due, burst not started    */
+
+static IMU_Bridge_FilterTypeDef sensorFilter =      /*!< Rate and bandwidth configuration   */
+{
+    .rateDiv = 0, .gyroDlpf = IMU_DLPF_CFG, .accelDlpf = IMU_ACCEL_DLPF_CFG, .rateSet = false
+};
+static uint8_t sensorRateDiv = 0;                   /*!< SMPLRT_DIV written to the chip     */
+static uint8_t pShadow[IMU_SHADOW_SIZE];            /*!< Configuration registers cache      */
+static uint8_t shadowDirty = 0;                     /*!< Cached registers to write, bitmap  */
+static bool_t shadowLoaded = false;                 /*!< Cache loaded from the chip         */
+
+/* Gyro and accel -3 dB bandwidth in Hz, by DLPF_CFG and A_DLPF_CFG (FCHOICE_B = 0) */
+static const uint16_t pGyroBandwidth[8] = { 250, 184, 92, 41, 20, 10, 5, 3600 };
+static const uint16_t pAccelBandwidth[8] = { 218, 218, 99, 45, 21, 10, 5, 420 };
+
+/* Unit scale factors by FS_SEL, full scale x 1000 over a raw 32768 (IMU_SCALE_SHIFT) */
+static const int32_t pAccelScale[4] = { 2000, 4000, 8000, 16000 };              /* mg   */
+static const int32_t pGyroScale[4] = { 250000, 500000, 1000000, 2000000 };      /* mdps */
+static int32_t accelScale = 2000;                   /*!< Accel scale of the running range   */
+static int32_t gyroScale = 250000;                  /*!< Gyro scale of the running range    */
+
+/* Data register offsets of each sensor in the burst, by IMU_Bridge_SensorTypeDef bit */
+static const uint8_t pSensorOffset[IMU_SENSOR_COUNT + 1] = { 0, 6, 8, IMU_SAMPLE_SIZE, IMU_SAMPLE_MAG_SIZE };
+
+/**
+ * @brief FIFO drain state
+*/
+typedef enum
+{
+    IMU_FIFO_OFF_STATE      = 0x00U,    /*!< FIFO mode disabled                 */
+    IMU_FIFO_IDLE_STATE     = 0x01U,    /*!< Next update reads FIFO_COUNT       */
+    IMU_FIFO_COUNT_STATE    = 0x02U,    /*!< FIFO_COUNT read in progress        */
+    IMU_FIFO_DRAIN_STATE    = 0x03U,    /*!< FIFO_R_W burst read in progress    */
+    IMU_FIFO_READY_STATE    = 0x04U,    /*!< Drained frames pending to be read  */
+    IMU_FIFO_OVERFLOW_STATE = 0x05U     /*!< FIFO to reset, frames lost         */
+
+} IMU_FifoStateTypeDef;
+
+static volatile IMU_FifoStateTypeDef fifoState = IMU_FIFO_OFF_STATE;
+static uint16_t fifoFrameSize;                      /*!< Bytes per FIFO frame               */
+static uint8_t pFifoCount[2];                       /*!< FIFO_COUNT DMA buffer              */
+static uint8_t pFifoBuffer[IMU_FIFO_BURST_SIZE];    /*!< FIFO_R_W DMA buffer                */
+static uint16_t fifoDrainSize;                      /*!< Bytes drained in the last burst    */
+static uint16_t fifoDrainPos;                       /*!< Next frame to read in the burst    */
+static uint16_t fifoCountFrames;                    /*!< Frames in the FIFO at the count    */
+static bool_t fifoBacklog;                          /*!< Frames left after the last burst   */
+static tick_t fifoTick;                             /*!< Tick when FIFO_COUNT was read      */
+static uint32_t fifoOverflow = 0;                   /*!< FIFO overflow recoveries           */
+static uint32_t fifoBursts = 0;                     /*!< FIFO drain transactions            */
+
+/**
+ * @brief Big endian register pair to int16
+*/
+static int16_t IMU_Bridge_Be16(const uint8_t* pData)
+{
+    return (int16_t)(((uint16_t)pData[0] << 8) | pData[1]);
+}
+
+/**
+ * @brief Little endian register pair to int16, AK8963 order
+*/
+static int16_t IMU_Bridge_Le16(const uint8_t* pData)
+{
+    return (int16_t)(((uint16_t)pData[1] << 8) | pData[0]);
+}
+
+/**
+ * @brief Busy wait, only for the sensor init
+*/
+static void IMU_Bridge_Delay(uint32_t ms)
+{
+    tick_t start = Sys_GetTick();
+
+    while (Sys_GetTick() - start < ms);
+}
+
+/**
+ * @brief Pick the unit scale factors of the full scale ranges in the cache
+*/
+static void IMU_Bridge_ScaleUpdate(void)
+{
+    accelScale = pAccelScale[(IMU_Bridge_ShadowGet(IMU_REG_ACCEL_CONFIG) & IMU_FS_SEL_MASK) >> IMU_FS_SEL_SHIFT];
+    gyroScale = pGyroScale[(IMU_Bridge_ShadowGet(IMU_REG_GYRO_CONFIG) & IMU_FS_SEL_MASK) >> IMU_FS_SEL_SHIFT];
+}
+
+/**
+ * @brief Raw value to unit, multiply and shift with rounding, no divide
+*/
+static int32_t IMU_Bridge_Scale(int16_t raw, int32_t scale)
+{
+    return (int32_t)(((int64_t)raw * scale + (1L << (IMU_SCALE_SHIFT - 1U))) >> IMU_SCALE_SHIFT);
+}
+
+/**
+ * @brief Wait for the end of the bus transfer in progress, if any
+*/
+static IMU_Bridge_StatusTypeDef IMU_Bridge_WaitIdle(void)
+{
+    tick_t start = Sys_GetTick();
+
+    while (IMU_Port_IsBusy())
+    {
+        if (Sys_GetTick() - start > IMU_PORT_TIMEOUT) return IMU_BRIDGE_ERROR;
+    }
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief Set a register bits, read modify write
+*/
+static IMU_Bridge_StatusTypeDef IMU_Bridge_RegUpdate(uint8_t reg, uint8_t clear, uint8_t set)
+{
+    uint8_t value;
+
+    if (IMU_Port_Read(reg, &value, 1) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    value = (uint8_t)((value & ~clear) | set);
+    return IMU_Port_Write(reg, &value, 1);
+}
+
+/**
+ * @brief   Set the sample rate and the filters
+ * @param   div: mode default SMPLRT_DIV, rate is 1 kHz / (1 + div),
+ *          overridden by the configured rate if any
+*/
+static IMU_Bridge_StatusTypeDef IMU_Bridge_SetRate(uint8_t div)
+{
+    if (sensorFilter.rateSet) div = sensorFilter.rateDiv;
+    IMU_Bridge_ShadowModify(IMU_REG_SMPLRT_DIV, 0xFFU, div);
+    IMU_Bridge_ShadowModify(IMU_REG_CONFIG, IMU_CONFIG_DLPF_MASK, sensorFilter.gyroDlpf);
+    IMU_Bridge_ShadowModify(IMU_REG_ACCEL_CONFIG2, IMU_ACCEL_CONFIG2_MASK, sensorFilter.accelDlpf);
+    if (IMU_Bridge_ShadowFlush() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    sensorRateDiv = div;
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief Flush the FIFO and restart it
+*/
+static IMU_Bridge_StatusTypeDef IMU_Bridge_FifoReset(void)
+{
+    fifoState = IMU_FIFO_IDLE_STATE;
+    fifoBacklog = false;
+    fifoTick = Sys_GetTick();
+    if (IMU_Bridge_RegUpdate(IMU_REG_USER_CTRL, IMU_USER_CTRL_FIFO_EN, IMU_USER_CTRL_FIFO_RST) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    return IMU_Bridge_RegUpdate(IMU_REG_USER_CTRL, IMU_USER_CTRL_FIFO_RST, IMU_USER_CTRL_FIFO_EN);
+}
+
+/**
+ * @brief   Decode the data registers of a burst
+ * @param   mask: sensors read, the magnetometer dropped on an AK8963 overflow
+*/
+static void IMU_Bridge_SampleDecode(const uint8_t* pData, uint8_t mask, IMU_Bridge_SampleTypeDef* pSample)
+{
+    pSample->mask = mask;
+    if ((mask & IMU_BRIDGE_SENSOR_MAG) && (pData[IMU_SAMPLE_MAG_SIZE - 1U] & IMU_MAG_ST2_HOFL))
+    {
+        pSample->mask &= (uint8_t)~IMU_BRIDGE_SENSOR_MAG;
+    }
+
+    pSample->accel[0] = IMU_Bridge_Be16(&pData[0]);
+    pSample->accel[1] = IMU_Bridge_Be16(&pData[2]);
+    pSample->accel[2] = IMU_Bridge_Be16(&pData[4]);
+    pSample->temp     = IMU_Bridge_Be16(&pData[6]);
+    pSample->gyro[0]  = IMU_Bridge_Be16(&pData[8]);
+    pSample->gyro[1]  = IMU_Bridge_Be16(&pData[10]);
+    pSample->gyro[2]  = IMU_Bridge_Be16(&pData[12]);
+    pSample->mag[0]   = IMU_Bridge_Le16(&pData[14]);
+    pSample->mag[1]   = IMU_Bridge_Le16(&pData[16]);
+    pSample->mag[2]   = IMU_Bridge_Le16(&pData[18]);
+}
+
+/**
+ * @brief   Set up an I2C master SLV0 transfer to the AK8963
+ * @param   read: read transfer, else write of value
+*/
+static IMU_Bridge_StatusTypeDef IMU_Bridge_MagSlave(bool_t read, uint8_t reg, uint8_t len, uint8_t value)
+{
+    uint8_t pSlave[3] =
+    {
+        IMU_MAG_ADDRESS | (read ? IMU_I2C_SLV_READ : 0U), reg, IMU_I2C_SLV_EN | len
+    };
+
+    if (!read && IMU_Port_Write(IMU_REG_I2C_SLV0_DO, &value, 1) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    return IMU_Port_Write(IMU_REG_I2C_SLV0_ADDR, pSlave, sizeof(pSlave));
+}
+
+/**
+ * @brief   Bring up the AK8963 through the MPU9250 I2C master
+ * @note    The I2C master runs the SLV0 transfer on each sample, at least
+ *          at the 1 kHz reset rate, so each step waits a few samples.
+ *          SLV0 is left reading HXL to ST2 on every sample.
+*/
+static IMU_Bridge_StatusTypeDef IMU_Bridge_MagInit(void)
+{
+    uint8_t value = IMU_I2C_MST_CTRL;
+
+    if (IMU_Port_Write(IMU_REG_I2C_MST_CTRL, &value, 1) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    if (IMU_Bridge_RegUpdate(IMU_REG_USER_CTRL, 0, IMU_USER_CTRL_I2C_MST_EN) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+
+    if (IMU_Bridge_MagSlave(false, IMU_MAG_REG_CNTL2, 1, IMU_MAG_CNTL2_SRST) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    IMU_Bridge_Delay(IMU_MAG_DELAY);
+
+    if (IMU_Bridge_MagSlave(true, IMU_MAG_REG_WIA, 1, 0) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    IMU_Bridge_Delay(IMU_MAG_DELAY);
+    if (IMU_Port_Read(IMU_REG_EXT_SENS_DATA, &value, 1) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    if (value != IMU_MAG_WIA) return IMU_BRIDGE_ERROR;
+
+    if (IMU_Bridge_MagSlave(false, IMU_MAG_REG_CNTL1, 1, IMU_MAG_CNTL1_CONT2) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    IMU_Bridge_Delay(IMU_MAG_DELAY);
+
+    return IMU_Bridge_MagSlave(true, IMU_MAG_REG_HXL, IMU_MAG_READ_SIZE, 0);
+}
+
+/**
+ * @brief   Reset and wake up the sensor, load the configuration cache and
+ *          set up the magnetometer
+ * @note    Over SPI the I2C slave interface is disabled, it may otherwise
+ *          take the SPI traffic for I2C start conditions.
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_SensorInit(void)
+{
+    uint8_t value = IMU_PWR_MGMT_1_H_RESET;
+
+    magReady = false;
+    if (IMU_Port_Write(IMU_REG_PWR_MGMT_1, &value, 1) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    IMU_Bridge_Delay(IMU_RESET_DELAY);
+
+    value = IMU_PWR_MGMT_1_CLKSEL;
+    if (IMU_Port_Write(IMU_REG_PWR_MGMT_1, &value, 1) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+#ifdef IMU_PORT_BUS_SPI
+    value = IMU_USER_CTRL_I2C_IF_DIS;
+    if (IMU_Port_Write(IMU_REG_USER_CTRL, &value, 1) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+#endif
+    if (IMU_Bridge_ShadowLoad() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+
+    /* No magnetometer is not fatal, the 6-axis acquisition still runs */
+    magReady = (IMU_Bridge_MagInit() == IMU_BRIDGE_OK);
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief Check the sensor identity
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_SensorCheck(void)
+{
+    uint8_t value;
+
+    if (IMU_Bridge_WaitIdle() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    if (IMU_Port_Read(IMU_REG_WHO_AM_I, &value, 1) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    if (value != IMU_WHO_AM_I_MPU9250 && value != IMU_WHO_AM_I_MPU9255) return IMU_BRIDGE_ERROR;
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief   Read some sensors, blocking
+ * @param   mask: sensors to read (IMU_Bridge_SensorTypeDef)
+ * @note    Same register range as IMU_Bridge_SampleFetchMask, the sensors
+ *          out of the range are left zero.
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_SensorRead(uint8_t mask, IMU_Bridge_SampleTypeDef* pSample)
+{
+    uint8_t pData[IMU_SAMPLE_MAG_SIZE] = {0};
+    uint8_t first = (uint8_t)__builtin_ctz(mask);
+    uint8_t last = (uint8_t)(31 - __builtin_clz(mask));
+
+    assert(pSample && mask != 0 && last < IMU_SENSOR_COUNT);
+
+    if ((mask & IMU_BRIDGE_SENSOR_MAG) && !magReady) return IMU_BRIDGE_ERROR;
+    if (IMU_Bridge_WaitIdle() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    if (IMU_Port_Read(IMU_REG_ACCEL_XOUT_H + pSensorOffset[first], &pData[pSensorOffset[first]],
+                      pSensorOffset[last + 1] - pSensorOffset[first]) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    IMU_Bridge_SampleDecode(pData, mask, pSample);
+    pSample->tick = Sys_GetTick();
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief Burst read job completion
+*/
+static void IMU_Bridge_SampleDone(IMU_Bridge_StatusTypeDef status)
+{
+    if (status == IMU_BRIDGE_OK)
+    {
+        sampleReady = true;
+        return;
+    }
+    samplePending = false;
+    sampleMissed++;
+}
+
+/**
+ * @brief Start a burst read of all the data registers, magnetometer included if found
+ * @note Safe to call from the data ready interrupt
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_SampleFetch(void)
+{
+    return IMU_Bridge_SampleFetchMask(IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_TEMP | IMU_BRIDGE_SENSOR_GYRO |
+                                      (magReady ? IMU_BRIDGE_SENSOR_MAG : 0U));
+}
+
+/**
+ * @brief Check if the magnetometer was found and set up by the sensor init
+*/
+bool_t IMU_Bridge_MagIsReady(void)
+{
+    return magReady;
+}
+
+/**
+ * @brief   Start a burst read of some sensors
+ * @param   mask: sensors to read (IMU_Bridge_SensorTypeDef)
+ * @note    One transaction from the first to the last sensor of the mask.
+ *          A sensor in between is read too, a few bytes are cheaper than
+ *          the addressing of a second transaction.
+ *          Safe to call from the data ready or timer interrupts.
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_SampleFetchMask(uint8_t mask)
+{
+    uint32_t now = Sys_GetCycles();
+    uint32_t period;
+    uint8_t first = (uint8_t)__builtin_ctz(mask);
+    uint8_t last = (uint8_t)(31 - __builtin_clz(mask));
+    IMU_Port_JobTypeDef job =
+    {
+        .reg = IMU_REG_ACCEL_XOUT_H + pSensorOffset[first], .write = false,
+        .pData = &pSampleBuffer[pSensorOffset[first]], .size = pSensorOffset[last + 1] - pSensorOffset[first],
+        .callback = IMU_Bridge_SampleDone
+    };
+
+    assert(mask != 0 && last < IMU_SENSOR_COUNT);
+
+    if ((mask & IMU_BRIDGE_SENSOR_MAG) && !magReady) return IMU_BRIDGE_ERROR;
+
+    /* The previous sample not read yet, or no room in the bus queue */
+    if (samplePending)
+    {
+        sampleMissed++;
+        return IMU_BRIDGE_ERROR;
+    }
+    sampleTick = Sys_GetTick();
+    sampleMask = mask;
+    sampleReady = false;
+    samplePending = true;
+    if (IMU_Port_Submit(&job) != IMU_BRIDGE_OK)
+    {
+        samplePending = false;
+        sampleMissed++;
+        return IMU_BRIDGE_ERROR;
+    }
+
+    /* Sampling jitter: spread of the intervals between burst starts */
+    period = now - sampleLastCycles;
+    if (sampleCount > 0 && period < sampleMinPeriod) sampleMinPeriod = period;
+    if (sampleCount > 0 && period > sampleMaxPeriod) sampleMaxPeriod = period;
+    sampleLastCycles = now;
+    sampleCount++;
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief Get the sample once the burst read is complete
+ * @retval true if a new sample was returned
+*/
+bool_t IMU_Bridge_SampleRead(IMU_Bridge_SampleTypeDef* pSample)
+{
+    assert(pSample);
+
+    if (!samplePending || !sampleReady) return false;
+
+    IMU_Bridge_SampleDecode(pSampleBuffer, sampleMask, pSample);
+    pSample->tick = sampleTick;
+    samplePending = false;
+    return true;
+}
+
+/**
+ * @brief   Get sampling statistics
+ * @param   pMinPeriod: min cycles between bursts
+ * @param   pMaxPeriod: max cycles between bursts, max - min is the jitter
+ * @param   pMissed: bursts not started because the bus was busy
+*/
+void IMU_Bridge_SampleGetStats(uint32_t* pMinPeriod, uint32_t* pMaxPeriod, uint32_t* pMissed)
+{
+    *pMinPeriod = sampleCount > 1 ? sampleMinPeriod : 0;
+    *pMaxPeriod = sampleMaxPeriod;
+    *pMissed = sampleMissed;
+}
+
+/**
+ * @brief Reset sampling statistics, i.e. on an acquisition mode change
+*/
+void IMU_Bridge_SampleResetStats(void)
+{
+    sampleCount = 0;
+    sampleMinPeriod = UINT32_MAX;
+    sampleMaxPeriod = 0;
+    sampleMissed = 0;
+}
+
+/**
+ * @brief Start data ready interrupt acquisition
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_DrdyStart(void)
+{
+    uint8_t value;
+
+    if (IMU_Bridge_WaitIdle() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    if (IMU_Bridge_SetRate(IMU_DRDY_SMPLRT_DIV) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    value = IMU_INT_PIN_CFG_ANYRD;
+    if (IMU_Port_Write(IMU_REG_INT_PIN_CFG, &value, 1) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    drdyEnabled = true;
+    value = IMU_INT_ENABLE_RAW_RDY;
+    return IMU_Port_Write(IMU_REG_INT_ENABLE, &value, 1);
+}
+
+/**
+ * @brief Stop data ready interrupt acquisition
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_DrdyStop(void)
+{
+    uint8_t value = 0;
+
+    if (!drdyEnabled) return IMU_BRIDGE_OK;
+    drdyEnabled = false;
+    if (IMU_Bridge_WaitIdle() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    return IMU_Port_Write(IMU_REG_INT_ENABLE, &value, 1);
+}
+
+/**
+ * @brief Data ready interrupt, starts the burst read on the sensor clock
+*/
+void IMU_Bridge_DrdyCallback(void)
+{
+    if (drdyEnabled) IMU_Bridge_SampleFetch();
+}
+
+/**
+ * @brief   Start FIFO streaming
+ * @param   mask: sensors to store in the FIFO (IMU_Bridge_SensorTypeDef)
+ * @note    The magnetometer is left out, see IMU_FIFO_SENSORS
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_FifoStart(uint8_t mask)
+{
+    uint8_t value;
+
+    mask &= IMU_FIFO_SENSORS;
+    fifoFrameSize = 2U * IMU_Bridge_FrameChannels(mask);
+    if (fifoFrameSize == 0) return IMU_BRIDGE_ERROR;
+    if (IMU_Bridge_WaitIdle() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    samplePending = false;
+
+    /* Stop on full keeps the frames aligned, a full FIFO is detected from FIFO_COUNT */
+    value = 0;
+    if (IMU_Port_Write(IMU_REG_FIFO_EN, &value, 1) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    IMU_Bridge_ShadowModify(IMU_REG_CONFIG, 0, IMU_CONFIG_FIFO_MODE);      /* Flushed with the rate */
+    if (IMU_Bridge_SetRate(IMU_FIFO_SMPLRT_DIV) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+
+    value = 0;
+    if (mask & IMU_BRIDGE_SENSOR_ACCEL) value |= IMU_FIFO_EN_ACCEL;
+    if (mask & IMU_BRIDGE_SENSOR_TEMP) value |= IMU_FIFO_EN_TEMP;
+    if (mask & IMU_BRIDGE_SENSOR_GYRO) value |= IMU_FIFO_EN_GYRO;
+    if (IMU_Port_Write(IMU_REG_FIFO_EN, &value, 1) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+
+    return IMU_Bridge_FifoReset();
+}
+
+/**
+ * @brief Stop FIFO streaming
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_FifoStop(void)
+{
+    uint8_t value = 0;
+
+    if (fifoState == IMU_FIFO_OFF_STATE) return IMU_BRIDGE_OK;
+    fifoState = IMU_FIFO_OFF_STATE;
+    if (IMU_Bridge_WaitIdle() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    fifoState = IMU_FIFO_OFF_STATE;     /* Over a job completed meanwhile */
+    if (IMU_Port_Write(IMU_REG_FIFO_EN, &value, 1) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    return IMU_Bridge_RegUpdate(IMU_REG_USER_CTRL, IMU_USER_CTRL_FIFO_EN, 0);
+}
+
+/**
+ * @brief FIFO drain job completion, the burst is ready
+*/
+static void IMU_Bridge_FifoDrainDone(IMU_Bridge_StatusTypeDef status)
+{
+    if (fifoState != IMU_FIFO_DRAIN_STATE) return;
+    fifoState = (status == IMU_BRIDGE_OK) ? IMU_FIFO_READY_STATE : IMU_FIFO_IDLE_STATE;
+}
+
+/**
+ * @brief FIFO_COUNT job completion, chains the drain job from the interrupt
+*/
+static void IMU_Bridge_FifoCountDone(IMU_Bridge_StatusTypeDef status)
+{
+    uint16_t count;
+    IMU_Port_JobTypeDef job = { .reg = IMU_REG_FIFO_R_W, .write = false, .pData = pFifoBuffer, .callback = IMU_Bridge_FifoDrainDone };
+
+    if (fifoState != IMU_FIFO_COUNT_STATE) return;
+    fifoState = IMU_FIFO_IDLE_STATE;
+    if (status != IMU_BRIDGE_OK) return;
+    count = (uint16_t)(((pFifoCount[0] << 8) | pFifoCount[1]) & IMU_FIFO_COUNT_MASK);
+
+    /* No room for another frame: samples were lost, or the frames are no longer aligned */
+    if (count > IMU_FIFO_SIZE - fifoFrameSize || count % fifoFrameSize != 0)
+    {
+        fifoState = IMU_FIFO_OVERFLOW_STATE;
+        return;
+    }
+
+    /* Whole frames only, as many as fit in the burst buffer, the rest on the next update */
+    fifoCountFrames = count / fifoFrameSize;
+    fifoBacklog = (count > IMU_FIFO_BURST_SIZE);
+    if (fifoBacklog) count = IMU_FIFO_BURST_SIZE - IMU_FIFO_BURST_SIZE % fifoFrameSize;
+    if (count == 0) return;
+    job.size = count;
+    fifoState = IMU_FIFO_DRAIN_STATE;
+    if (IMU_Port_Submit(&job) != IMU_BRIDGE_OK)
+    {
+        fifoState = IMU_FIFO_IDLE_STATE;
+        return;
+    }
+    fifoDrainSize = count;
+    fifoDrainPos = 0;
+    fifoBursts++;
+}
+
+/**
+ * @brief FIFO drain state machine, non blocking. Call it from the main loop
+ * @note The FIFO_COUNT read and the drain are chained bus jobs, the main
+ *       loop only starts them and handles the overflow recovery. FIFO_COUNT
+ *       is read every IMU_FIFO_POLL_MS, so each burst holds several frames,
+ *       or right away while frames are left from the last burst.
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_FifoUpdate(void)
+{
+    IMU_Port_JobTypeDef job = { .reg = IMU_REG_FIFO_COUNTH, .write = false, .pData = pFifoCount,
+        .size = sizeof(pFifoCount), .callback = IMU_Bridge_FifoCountDone };
+
+    switch (fifoState)
+    {
+    case IMU_FIFO_IDLE_STATE:
+        if (!fifoBacklog && Sys_GetTick() - fifoTick < IMU_FIFO_POLL_MS) break;
+        fifoTick = Sys_GetTick();
+        fifoState = IMU_FIFO_COUNT_STATE;
+        if (IMU_Port_Submit(&job) != IMU_BRIDGE_OK) fifoState = IMU_FIFO_IDLE_STATE;
+        break;
+
+    case IMU_FIFO_OVERFLOW_STATE:
+        fifoOverflow++;
+        if (IMU_Bridge_WaitIdle() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+        return IMU_Bridge_FifoReset();
+
+    default:
+        break;
+    }
+
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief   Get the next drained FIFO frame
+ * @param   pValues: channel values, frame payload order (accel, temp, gyro)
+ * @param   pTick: frame sample tick, worked back from the FIFO_COUNT read at
+ *          the sample rate, the last frame counted taken at the read
+ * @retval  true if a frame was returned
+*/
+bool_t IMU_Bridge_FifoRead(int16_t* pValues, tick_t* pTick)
+{
+    uint16_t age;
+    uint16_t i;
+
+    assert(pValues && pTick);
+
+    if (fifoState != IMU_FIFO_READY_STATE) return false;
+    age = fifoCountFrames - 1U - fifoDrainPos / fifoFrameSize;
+
+    /* FIFO frames follow the register order, same as the frame payload */
+    for (i = 0; i < fifoFrameSize / 2U; i++)
+    {
+        pValues[i] = IMU_Bridge_Be16(&pFifoBuffer[fifoDrainPos + 2U * i]);
+    }
+    *pTick = fifoTick - age * ((1U + sensorRateDiv) * 1000U / IMU_INTERNAL_RATE);
+
+    fifoDrainPos += fifoFrameSize;
+    if (fifoDrainPos >= fifoDrainSize) fifoState = IMU_FIFO_IDLE_STATE;
+    return true;
+}
+
+/**
+ * @brief Get FIFO statistics
+*/
+void IMU_Bridge_FifoGetStats(uint32_t* pOverflow, uint32_t* pBursts)
+{
+    *pOverflow = fifoOverflow;
+    *pBursts = fifoBursts;
+}
+
+/**
+ * @brief   Start timer paced acquisition
+ * @param   periodUs: sampling period in microseconds
+ * @note    The sensor runs at 1 kHz, the timer picks the samples
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_TimerStart(uint32_t periodUs)
+{
+    if (!timerEnabled)
+    {
+        if (IMU_Bridge_WaitIdle() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+        if (IMU_Bridge_SetRate(IMU_TIMER_SMPLRT_DIV) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    }
+    timerEnabled = true;
+    IMU_Bridge_SampleResetStats();
+    return Timer_Start(periodUs);
+}
+
+/**
+ * @brief Stop timer paced acquisition
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_TimerStop(void)
+{
+    if (!timerEnabled) return IMU_BRIDGE_OK;
+    timerEnabled = false;
+    return Timer_Stop();
+}
+
+/**
+ * @brief Sample timer interrupt, starts the burst read
+*/
+void IMU_Bridge_TimerCallback(void)
+{
+    uint8_t i;
+
+    if (!multiEnabled)
+    {
+        IMU_Bridge_SampleFetch();
+        return;
+    }
+
+    /* Each channel is due every IMU_MULTI_RATE_MAX / rate ticks, on average for
+       rates that don't divide it. Channels missed on a busy bus stay due. */
+    for (i = 0; i < IMU_MULTI_CHANNELS; i++)
+    {
+        pMultiPhase[i] += pMultiRates[i];
+        if (pMultiPhase[i] < IMU_MULTI_RATE_MAX) continue;
+        pMultiPhase[i] -= IMU_MULTI_RATE_MAX;
+        multiDue |= (uint8_t)(1U << i);
+    }
+    if (multiDue != 0 && IMU_Bridge_SampleFetchMask(multiDue) == IMU_BRIDGE_OK) multiDue = 0;
+}
+
+/**
+ * @brief   Start multi-rate acquisition, or change its rates
+ * @param   pRates: accel, temp and gyro rates in Hz, up to IMU_MULTI_RATE_MAX, 0 to disable
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_MultiStart(const uint16_t* pRates)
+{
+    uint8_t i;
+
+    assert(pRates);
+
+    /* Stop the scheduler while its state is rewritten */
+    multiEnabled = false;
+    if (IMU_Bridge_TimerStop() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    for (i = 0; i < IMU_MULTI_CHANNELS; i++)
+    {
+        assert(pRates[i] <= IMU_MULTI_RATE_MAX);
+        pMultiRates[i] = pRates[i];
+        pMultiPhase[i] = (pRates[i] != 0) ? IMU_MULTI_RATE_MAX - pRates[i] : 0;    /* First sample on the first tick */
+    }
+    multiDue = 0;
+    multiEnabled = true;
+    return IMU_Bridge_TimerStart(IMU_MULTI_TICK_US);
+}
+
+/**
+ * @brief Stop multi-rate acquisition
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_MultiStop(void)
+{
+    if (!multiEnabled) return IMU_BRIDGE_OK;
+    multiEnabled = false;
+    return IMU_Bridge_TimerStop();
+}
+
+/**
+ * @brief   Load the configuration registers cache from the chip
+ * @note    Call after every chip reset, i.e. at init
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_ShadowLoad(void)
+{
+    if (IMU_Bridge_WaitIdle() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    if (IMU_Port_Read(IMU_SHADOW_FIRST, pShadow, IMU_SHADOW_SIZE) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    shadowDirty = 0;
+    shadowLoaded = true;
+    sensorRateDiv = pShadow[IMU_REG_SMPLRT_DIV - IMU_SHADOW_FIRST];
+    IMU_Bridge_ScaleUpdate();
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief   Read a cached configuration register, no bus access
+ * @param   reg: IMU_REG_SMPLRT_DIV to IMU_REG_ACCEL_CONFIG2
+*/
+uint8_t IMU_Bridge_ShadowGet(uint8_t reg)
+{
+    assert(shadowLoaded && reg >= IMU_SHADOW_FIRST && reg < IMU_SHADOW_FIRST + IMU_SHADOW_SIZE);
+    return pShadow[reg - IMU_SHADOW_FIRST];
+}
+
+/**
+ * @brief   Change cached configuration register bits, written on the next flush
+ * @param   reg: IMU_REG_SMPLRT_DIV to IMU_REG_ACCEL_CONFIG2
+*/
+void IMU_Bridge_ShadowModify(uint8_t reg, uint8_t clear, uint8_t set)
+{
+    uint8_t value;
+
+    assert(shadowLoaded && reg >= IMU_SHADOW_FIRST && reg < IMU_SHADOW_FIRST + IMU_SHADOW_SIZE);
+    value = (uint8_t)((pShadow[reg - IMU_SHADOW_FIRST] & ~clear) | set);
+    if (value == pShadow[reg - IMU_SHADOW_FIRST]) return;
+    pShadow[reg - IMU_SHADOW_FIRST] = value;
+    shadowDirty |= (uint8_t)(1U << (reg - IMU_SHADOW_FIRST));
+}
+
+/**
+ * @brief   Write the changed configuration registers
+ * @note    One transaction from the first to the last changed register,
+ *          the unchanged ones in between are written with their cached value
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_ShadowFlush(void)
+{
+    uint8_t first, last;
+
+    if (shadowDirty == 0) return IMU_BRIDGE_OK;
+    first = (uint8_t)__builtin_ctz(shadowDirty);
+    last = (uint8_t)(31 - __builtin_clz(shadowDirty));
+    if (IMU_Port_Write(IMU_SHADOW_FIRST + first, &pShadow[first], last - first + 1U) != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    shadowDirty = 0;
+    IMU_Bridge_ScaleUpdate();   /* The full scale ranges may have changed */
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief   Set the gyro full scale
+ * @param   fsSel: GYRO_FS_SEL, 250 dps << fsSel
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_GyroSetFullScale(uint8_t fsSel)
+{
+    assert(fsSel <= (IMU_FS_SEL_MASK >> IMU_FS_SEL_SHIFT));
+
+    if (IMU_Bridge_WaitIdle() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    IMU_Bridge_ShadowModify(IMU_REG_GYRO_CONFIG, IMU_FS_SEL_MASK, (uint8_t)(fsSel << IMU_FS_SEL_SHIFT));
+    return IMU_Bridge_ShadowFlush();
+}
+
+/**
+ * @brief   Set the accel full scale
+ * @param   fsSel: ACCEL_FS_SEL, 2 g << fsSel
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_AccelSetFullScale(uint8_t fsSel)
+{
+    assert(fsSel <= (IMU_FS_SEL_MASK >> IMU_FS_SEL_SHIFT));
+
+    if (IMU_Bridge_WaitIdle() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    IMU_Bridge_ShadowModify(IMU_REG_ACCEL_CONFIG, IMU_FS_SEL_MASK, (uint8_t)(fsSel << IMU_FS_SEL_SHIFT));
+    return IMU_Bridge_ShadowFlush();
+}
+
+/**
+ * @brief   Get the full scale ranges, the raw to unit scale factors
+ * @param   pGyroDps: gyro full scale, dps for a raw 32768
+ * @param   pAccelG: accel full scale, g for a raw 32768
+ * @note    Derived from the cache, so always the ranges the chip runs with
+*/
+void IMU_Bridge_GetFullScale(uint16_t* pGyroDps, uint16_t* pAccelG)
+{
+    uint8_t gyroFsSel = (IMU_Bridge_ShadowGet(IMU_REG_GYRO_CONFIG) & IMU_FS_SEL_MASK) >> IMU_FS_SEL_SHIFT;
+    uint8_t accelFsSel = (IMU_Bridge_ShadowGet(IMU_REG_ACCEL_CONFIG) & IMU_FS_SEL_MASK) >> IMU_FS_SEL_SHIFT;
+
+    *pGyroDps = (uint16_t)(IMU_GYRO_FS_MIN << gyroFsSel);
+    *pAccelG = (uint16_t)(IMU_ACCEL_FS_MIN << accelFsSel);
+}
+
+/**
+ * @brief   Convert raw channel values to signed physical units
+ * @param   mask: sensors of the values (IMU_Bridge_SensorTypeDef)
+ * @param   pValues: raw values, frame payload order
+ * @param   pUnits: output, accel mg, temperature 0.01 degC, gyro mdps, mag nT
+ * @note    The scale factors follow the full scale ranges the chip runs with
+*/
+void IMU_Bridge_ScaleValues(uint8_t mask, const int16_t* pValues, int32_t* pUnits)
+{
+    uint8_t i;
+
+    assert(pValues && pUnits);
+
+    if (mask & IMU_BRIDGE_SENSOR_ACCEL)
+    {
+        for (i = 0; i < 3U; i++) *pUnits++ = IMU_Bridge_Scale(*pValues++, accelScale);
+    }
+    if (mask & IMU_BRIDGE_SENSOR_TEMP) *pUnits++ = IMU_Bridge_Scale(*pValues++, IMU_TEMP_SCALE) + IMU_TEMP_OFFSET;
+    if (mask & IMU_BRIDGE_SENSOR_GYRO)
+    {
+        for (i = 0; i < 3U; i++) *pUnits++ = IMU_Bridge_Scale(*pValues++, gyroScale);
+    }
+    if (mask & IMU_BRIDGE_SENSOR_MAG)
+    {
+        for (i = 0; i < 3U; i++) *pUnits++ = IMU_Bridge_Scale(*pValues++, IMU_MAG_SCALE);
+    }
+}
+
+/**
+ * @brief   Check a rate and bandwidth configuration
+ * @retval  true if the filters are in range and the output data rate is at
+ *          least twice both bandwidths, i.e. the samples don't alias
+ * @note    Without a configured rate the check is at the rate the chip runs
+ *          at, the default of the last acquisition mode.
+*/
+bool_t IMU_Bridge_FilterCheck(const IMU_Bridge_FilterTypeDef* pFilter)
+{
+    uint32_t rate;
+    uint32_t bandwidth;
+    uint8_t div;
+
+    assert(pFilter);
+
+    if (pFilter->gyroDlpf < IMU_DLPF_CFG_MIN || pFilter->gyroDlpf > IMU_DLPF_CFG_MAX) return false;
+    if (pFilter->accelDlpf > IMU_ACCEL_DLPF_CFG_MAX) return false;
+    div = pFilter->rateSet ? pFilter->rateDiv : sensorRateDiv;
+
+    /* rate >= 2 * bandwidth, without the division */
+    rate = IMU_INTERNAL_RATE;
+    bandwidth = pGyroBandwidth[pFilter->gyroDlpf];
+    if (pAccelBandwidth[pFilter->accelDlpf] > bandwidth) bandwidth = pAccelBandwidth[pFilter->accelDlpf];
+    return rate >= 2U * bandwidth * (1U + div);
+}
+
+/**
+ * @brief   Set the rate and bandwidth configuration
+ * @note    Applied to the chip right away, and on every acquisition mode start
+*/
+IMU_Bridge_StatusTypeDef IMU_Bridge_FilterSet(const IMU_Bridge_FilterTypeDef* pFilter)
+{
+    assert(pFilter && IMU_Bridge_FilterCheck(pFilter));
+
+    sensorFilter = *pFilter;
+    if (IMU_Bridge_WaitIdle() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    return IMU_Bridge_SetRate(sensorRateDiv);
+}
+
+/**
+ * @brief   Get the rate and bandwidth configuration
+ * @param   pFilter: configuration
+ * @param   pRateDiv: SMPLRT_DIV the chip runs at, the effective rate
+*/
+void IMU_Bridge_FilterGet(IMU_Bridge_FilterTypeDef* pFilter, uint8_t* pRateDiv)
+{
+    *pFilter = sensorFilter;
+    *pRateDiv = sensorRateDiv;
+}
+
+/**
+ * @brief   Gyro and temperature bandwidth, Hz
+*/
+uint16_t IMU_Bridge_FilterGyroBandwidth(uint8_t dlpf)
+{
+    return pGyroBandwidth[dlpf & IMU_CONFIG_DLPF_MASK];
+}
+
+/**
+ * @brief   Accel bandwidth, Hz
+*/
+uint16_t IMU_Bridge_FilterAccelBandwidth(uint8_t dlpf)
+{
+    return pAccelBandwidth[dlpf & IMU_CONFIG_DLPF_MASK];
+}
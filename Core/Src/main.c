@@ -96,7 +96,7 @@ int main(void)
   while (1)
   {
     IMU_Bridge_FsmUpdate();
-    HAL_Delay(5);
+    IMU_Bridge_Sleep();
     HAL_GPIO_TogglePin(LED_GPIO_Port, LED_Pin);
     /* USER CODE END WHILE */
 
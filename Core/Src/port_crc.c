@@ -0,0 +1,72 @@
+/**
+  ******************************************************************************
+  * @file           : port_crc.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : IMU Bridge CRC port for STM32F1XX
+  ******************************************************************************
+  * @attention
+  *
+  * IMU Bridge CRC port for STM32F1XX, over the CRC calculation unit. A word
+  * takes 4 AHB cycles, the data register is written directly instead of
+  * going through HAL_CRC_Accumulate() and its buffer loop.
+  * Tested on STM32F103C8T6.
+  *
+  ******************************************************************************
+  */
+
+#include "port_crc.h"
+#include "main.h"
+
+CRC_HandleTypeDef hcrc;
+
+/**
+ * @brief CRC unit init function
+*/
+IMU_Bridge_StatusTypeDef CRC32_Init(void)
+{
+    hcrc.Instance = CRC;
+    if (HAL_CRC_Init(&hcrc) != HAL_OK) return IMU_BRIDGE_ERROR;
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief Start a new CRC, back to the initial value
+*/
+void CRC32_Reset(void)
+{
+    __HAL_CRC_DR_RESET(&hcrc);
+}
+
+/**
+ * @brief Accumulate a word
+*/
+void CRC32_Feed(uint32_t word)
+{
+    hcrc.Instance->DR = word;
+}
+
+/**
+ * @brief CRC of the words fed since the last reset
+*/
+uint32_t CRC32_Get(void)
+{
+    return hcrc.Instance->DR;
+}
+
+void HAL_CRC_MspInit(CRC_HandleTypeDef* hcrc)
+{
+    if(hcrc->Instance==CRC)
+    {
+        /* CRC clock enable */
+        __HAL_RCC_CRC_CLK_ENABLE();
+    }
+}
+
+void HAL_CRC_MspDeInit(CRC_HandleTypeDef* hcrc)
+{
+    if(hcrc->Instance==CRC)
+    {
+        /* Peripheral clock disable */
+        __HAL_RCC_CRC_CLK_DISABLE();
+    }
+}
@@ -0,0 +1,242 @@
+/**
+  ******************************************************************************
+  * @file           : port_imu.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : IMU Bridge sensor bus port for STM32F1XX
+  ******************************************************************************
+  * @attention
+  *
+  * IMU Bridge sensor bus port for STM32F1XX, bus independant part: the bus
+  * job queue and the MPU9250 INT pin on EXTI. The transfers are left to the
+  * bus port, I2C or SPI. Job completion is detected in the bus interrupt
+  * hook, once the bus port is ready again.
+  * Tested on STM32F103C8T6.
+  *
+  ******************************************************************************
+  */
+
+#include "port_imu.h"
+#include "imu_bridge_sensor.h"
+#include "main.h"
+#include "port_uart.h"
+
+#include <assert.h>
+#include <string.h>
+
+static IMU_Port_JobTypeDef pJobQueue[IMU_PORT_JOB_QUEUE_SIZE];  /*!< Bus jobs, oldest running */
+static volatile uint8_t jobHead = 0;                /*!< Next job slot                      */
+static volatile uint8_t jobTail = 0;                /*!< Oldest job, running if jobActive   */
+static volatile bool_t jobActive = false;           /*!< Oldest job started on the bus      */
+static uint32_t jobStartCycles;                     /*!< Cycle count at the job start       */
+static uint32_t jobCount = 0;                       /*!< Jobs completed                     */
+static uint32_t jobErrors = 0;                      /*!< Jobs failed                        */
+static uint32_t jobQueueMax = 0;                    /*!< Max jobs queued, running included  */
+static uint64_t jobBusyCycles = 0;                  /*!< Cycles with a job on the bus       */
+static uint8_t pWriteData[IMU_PORT_WRITE_MAX_SIZE]; /*!< Register write job data            */
+static volatile bool_t writePending = false;        /*!< Register write job not completed   */
+static volatile IMU_Bridge_StatusTypeDef writeStatus; /*!< Register write job result       */
+static uint8_t pReadData[IMU_PORT_READ_MAX_SIZE];   /*!< Register read job data             */
+static volatile bool_t readPending = false;         /*!< Register read job not completed    */
+static volatile IMU_Bridge_StatusTypeDef readStatus; /*!< Register read job result         */
+
+static void IMU_Port_JobStart(void);
+static void IMU_Port_JobDone(IMU_Bridge_StatusTypeDef status);
+
+/**
+ * @brief Sensor bus init function
+*/
+IMU_Bridge_StatusTypeDef IMU_Port_Init(void)
+{
+    return IMU_Port_BusInit();
+}
+
+/**
+ * @brief Register read job completion
+*/
+static void IMU_Port_ReadDone(IMU_Bridge_StatusTypeDef status)
+{
+    readStatus = status;
+    readPending = false;
+}
+
+/**
+ * @brief   Read consecutive registers, blocking
+ * @note    Queued as a bus job and waited for, as a write, so an
+ *          acquisition job submitted meanwhile by an interrupt waits its
+ *          turn instead of failing the read. The data lands in an internal
+ *          buffer, a read timed out still completes later and the next one
+ *          is refused until then.
+*/
+IMU_Bridge_StatusTypeDef IMU_Port_Read(uint8_t reg, uint8_t* pData, uint16_t size)
+{
+    IMU_Port_JobTypeDef job = { .reg = reg, .write = false, .pData = pReadData, .size = size, .callback = IMU_Port_ReadDone };
+    tick_t start;
+
+    assert(pData);
+    if (size > IMU_PORT_READ_MAX_SIZE || readPending) return IMU_BRIDGE_ERROR;
+
+    readPending = true;
+    if (IMU_Port_Submit(&job) != IMU_BRIDGE_OK)
+    {
+        readPending = false;
+        return IMU_BRIDGE_ERROR;
+    }
+
+    start = Sys_GetTick();
+    while (readPending)
+    {
+        if (Sys_GetTick() - start > IMU_PORT_TIMEOUT) return IMU_BRIDGE_ERROR;
+    }
+    if (readStatus != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+    memcpy(pData, pReadData, size);
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief Register write job completion
+*/
+static void IMU_Port_WriteDone(IMU_Bridge_StatusTypeDef status)
+{
+    writeStatus = status;
+    writePending = false;
+}
+
+/**
+ * @brief   Write consecutive registers, blocking
+ * @note    Queued as a bus job, behind the acquisition jobs pending, and
+ *          waited for. The data is copied, a write timed out still
+ *          completes later and the next one is refused until then.
+*/
+IMU_Bridge_StatusTypeDef IMU_Port_Write(uint8_t reg, const uint8_t* pData, uint16_t size)
+{
+    IMU_Port_JobTypeDef job = { .reg = reg, .write = true, .pData = pWriteData, .size = size, .callback = IMU_Port_WriteDone };
+    tick_t start;
+
+    assert(pData);
+    if (size > IMU_PORT_WRITE_MAX_SIZE || writePending) return IMU_BRIDGE_ERROR;
+
+    memcpy(pWriteData, pData, size);
+    writePending = true;
+    if (IMU_Port_Submit(&job) != IMU_BRIDGE_OK)
+    {
+        writePending = false;
+        return IMU_BRIDGE_ERROR;
+    }
+
+    start = Sys_GetTick();
+    while (writePending)
+    {
+        if (Sys_GetTick() - start > IMU_PORT_TIMEOUT) return IMU_BRIDGE_ERROR;
+    }
+    return writeStatus;
+}
+
+/**
+ * @brief Check if a bus transfer is in progress, or jobs are queued
+*/
+bool_t IMU_Port_IsBusy(void)
+{
+    return jobHead != jobTail || !IMU_Port_BusIsReady();
+}
+
+/**
+ * @brief   Queue a bus job, started right away if the bus is free
+ * @note    Safe to call from any interrupt handler and from job callbacks
+ * @retval  IMU_BRIDGE_ERROR if the queue is full
+*/
+IMU_Bridge_StatusTypeDef IMU_Port_Submit(const IMU_Port_JobTypeDef* pJob)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint8_t depth;
+
+    assert(pJob && pJob->pData);
+
+    __disable_irq();
+    depth = (uint8_t)(jobHead - jobTail);
+    if (depth >= IMU_PORT_JOB_QUEUE_SIZE)
+    {
+        __set_PRIMASK(primask);
+        return IMU_BRIDGE_ERROR;
+    }
+    pJobQueue[jobHead & (IMU_PORT_JOB_QUEUE_SIZE - 1U)] = *pJob;
+    jobHead++;
+    if (depth + 1U > jobQueueMax) jobQueueMax = depth + 1U;
+    IMU_Port_JobStart();
+    __set_PRIMASK(primask);
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief   Get bus job statistics
+ * @param   pJobs: jobs completed
+ * @param   pErrors: jobs failed
+ * @param   pQueueMax: max jobs queued, the running one included
+ * @param   pBusyCycles: cycles with a job on the bus since the last call
+*/
+void IMU_Port_GetStats(uint32_t* pJobs, uint32_t* pErrors, uint32_t* pQueueMax, uint64_t* pBusyCycles)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    *pJobs = jobCount;
+    *pErrors = jobErrors;
+    *pQueueMax = jobQueueMax;
+    *pBusyCycles = jobBusyCycles;
+    jobBusyCycles = 0;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Start the oldest job, if any and the bus is free
+ * @note Called with the interrupts masked, or from the bus interrupts
+*/
+static void IMU_Port_JobStart(void)
+{
+    while (!jobActive && jobHead != jobTail && IMU_Port_BusIsReady())
+    {
+        jobActive = true;
+        jobStartCycles = Sys_GetCycles();
+        if (IMU_Port_BusStart(&pJobQueue[jobTail & (IMU_PORT_JOB_QUEUE_SIZE - 1U)]) != IMU_BRIDGE_OK)
+        {
+            IMU_Port_JobDone(IMU_BRIDGE_ERROR);
+        }
+    }
+}
+
+/**
+ * @brief Complete the running job and start the next one
+*/
+static void IMU_Port_JobDone(IMU_Bridge_StatusTypeDef status)
+{
+    IMU_Port_JobCallbackTypeDef callback = pJobQueue[jobTail & (IMU_PORT_JOB_QUEUE_SIZE - 1U)].callback;
+
+    jobBusyCycles += Sys_GetCycles() - jobStartCycles;
+    jobCount++;
+    if (status != IMU_BRIDGE_OK) jobErrors++;
+    jobTail++;
+    jobActive = false;
+
+    /* Jobs submitted by the callback are queued behind the pending ones */
+    if (callback != NULL) callback(status);
+    IMU_Port_JobStart();
+    IMU_Bridge_EventPost(IMU_BRIDGE_EVENT_BUS);
+}
+
+/**
+ * @brief   Bus interrupt hook, to be called after the HAL handlers
+ * @note    Completes the running job once the bus port is ready again, and
+ *          chains the next one.
+*/
+void IMU_Port_IRQHandler(void)
+{
+    if (jobActive && IMU_Port_BusIsReady()) IMU_Port_JobDone(IMU_Port_BusResult());
+    IMU_Port_JobStart();
+}
+
+/**
+ * @brief EXTI line detection callback
+*/
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+    if (GPIO_Pin == MPU_INT_Pin) IMU_Bridge_DrdyCallback();
+}
@@ -0,0 +1,142 @@
+/**
+  ******************************************************************************
+  * @file           : port_imu_i2c.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : IMU Bridge sensor I2C bus port for STM32F1XX
+  ******************************************************************************
+  * @attention
+  *
+  * IMU Bridge sensor I2C bus port for STM32F1XX, on I2C1 (PB6 SCL, PB7 SDA)
+  * at 400 kHz. Bus jobs are register reads and writes by
+  * interrupt, as they are started from interrupt handlers: the F1 HAL DMA
+  * read sends the register address polling the flags against HAL_GetTick,
+  * and the tick is frozen there. Completion is detected in the I2C
+  * interrupt hooks, not in the HAL callbacks.
+  * Tested on STM32F103C8T6.
+  *
+  ******************************************************************************
+  */
+
+#include "port_imu.h"
+#include "main.h"
+
+I2C_HandleTypeDef hi2c1;
+
+/**
+ * @brief I2C bus init function
+*/
+IMU_Bridge_StatusTypeDef IMU_Port_BusInit(void)
+{
+    hi2c1.Instance = I2C1;
+    hi2c1.Init.ClockSpeed = 400000;
+    hi2c1.Init.DutyCycle = I2C_DUTYCYCLE_2;
+    hi2c1.Init.OwnAddress1 = 0;
+    hi2c1.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
+    hi2c1.Init.DualAddressMode = I2C_DUALADDRESS_DISABLE;
+    hi2c1.Init.OwnAddress2 = 0;
+    hi2c1.Init.GeneralCallMode = I2C_GENERALCALL_DISABLE;
+    hi2c1.Init.NoStretchMode = I2C_NOSTRETCH_DISABLE;
+    if (HAL_I2C_Init(&hi2c1) != HAL_OK) return IMU_BRIDGE_ERROR;
+
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief Start a bus job transfer by interrupt
+ * @note No HAL polling, safe from the interrupt handlers chaining the jobs
+*/
+IMU_Bridge_StatusTypeDef IMU_Port_BusStart(const IMU_Port_JobTypeDef* pJob)
+{
+    HAL_StatusTypeDef status;
+
+    if (pJob->write)
+    {
+        status = HAL_I2C_Mem_Write_IT(&hi2c1, IMU_PORT_I2C_ADDRESS, pJob->reg, I2C_MEMADD_SIZE_8BIT, pJob->pData, pJob->size);
+    }
+    else
+    {
+        status = HAL_I2C_Mem_Read_IT(&hi2c1, IMU_PORT_I2C_ADDRESS, pJob->reg, I2C_MEMADD_SIZE_8BIT, pJob->pData, pJob->size);
+    }
+    return (status == HAL_OK) ? IMU_BRIDGE_OK : IMU_BRIDGE_ERROR;
+}
+
+/**
+ * @brief Check if the handle is free for a new transfer
+*/
+bool_t IMU_Port_BusIsReady(void)
+{
+    return HAL_I2C_GetState(&hi2c1) == HAL_I2C_STATE_READY;
+}
+
+/**
+ * @brief Result of the last transfer, once the handle is ready
+*/
+IMU_Bridge_StatusTypeDef IMU_Port_BusResult(void)
+{
+    return (HAL_I2C_GetError(&hi2c1) == HAL_I2C_ERROR_NONE) ? IMU_BRIDGE_OK : IMU_BRIDGE_ERROR;
+}
+
+void HAL_I2C_MspInit(I2C_HandleTypeDef* hi2c)
+{
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    if(hi2c->Instance==I2C1)
+    {
+        __HAL_RCC_GPIOB_CLK_ENABLE();
+
+        /**I2C1 GPIO Configuration
+        PB6     ------> I2C1_SCL
+        PB7     ------> I2C1_SDA
+        */
+        GPIO_InitStruct.Pin = GPIO_PIN_6|GPIO_PIN_7;
+        GPIO_InitStruct.Mode = GPIO_MODE_AF_OD;
+        GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+        HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+        /* I2C1 clock enable */
+        __HAL_RCC_I2C1_CLK_ENABLE();
+
+        /* I2C1 interrupt Init, no DMA: the jobs run by interrupt */
+        HAL_NVIC_SetPriority(I2C1_EV_IRQn, 0, 0);
+        HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+        HAL_NVIC_SetPriority(I2C1_ER_IRQn, 0, 0);
+        HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+    }
+}
+
+void HAL_I2C_MspDeInit(I2C_HandleTypeDef* hi2c)
+{
+    if(hi2c->Instance==I2C1)
+    {
+        /* Peripheral clock disable */
+        __HAL_RCC_I2C1_CLK_DISABLE();
+
+        /**I2C1 GPIO Configuration
+        PB6     ------> I2C1_SCL
+        PB7     ------> I2C1_SDA
+        */
+        HAL_GPIO_DeInit(GPIOB, GPIO_PIN_6|GPIO_PIN_7);
+
+        /* I2C1 interrupt Deinit */
+        HAL_NVIC_DisableIRQ(I2C1_EV_IRQn);
+        HAL_NVIC_DisableIRQ(I2C1_ER_IRQn);
+    }
+}
+
+/**
+ * @brief This function handles I2C1 event interrupt
+*/
+void I2C1_EV_IRQHandler(void)
+{
+    HAL_I2C_EV_IRQHandler(&hi2c1);
+    IMU_Port_IRQHandler();
+}
+
+/**
+ * @brief This function handles I2C1 error interrupt
+*/
+void I2C1_ER_IRQHandler(void)
+{
+    HAL_I2C_ER_IRQHandler(&hi2c1);
+    IMU_Port_IRQHandler();
+}
@@ -0,0 +1,258 @@
+/**
+  ******************************************************************************
+  * @file           : port_imu_spi.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : IMU Bridge sensor SPI bus port for STM32F1XX
+  ******************************************************************************
+  * @attention
+  *
+  * IMU Bridge sensor SPI bus port for STM32F1XX, on SPI1 (PA5 SCK, PA6 MISO,
+  * PA7 MOSI) with a software NCS on PA4, mode 3. The MPU9250 takes reads of
+  * the sensor data registers up to 20 MHz, any other access up to 1 MHz, so
+  * the clock is switched per transfer: 18 MHz for the sample bursts and the
+  * FIFO drains, 562.5 kHz for the configuration reads and writes.
+  * Bus jobs are full duplex DMA transfers through internal buffers, the
+  * register address byte first. Completion ends in the RX DMA interrupt.
+  * Tested on STM32F103C8T6.
+  *
+  ******************************************************************************
+  */
+
+#include "port_imu.h"
+#include "imu_bridge_sensor.h"
+#include "main.h"
+
+#include <string.h>
+
+#define IMU_PORT_SPI_NCS_PIN        GPIO_PIN_4
+#define IMU_PORT_SPI_NCS_PORT       GPIOA
+#define IMU_PORT_SPI_DATA_SPEED     SPI_BAUDRATEPRESCALER_4     /* 72 MHz APB2, 18 MHz   */
+#define IMU_PORT_SPI_REG_SPEED      SPI_BAUDRATEPRESCALER_128   /* 72 MHz APB2, 562.5 kHz */
+#define IMU_PORT_SPI_DATA_LAST      (IMU_REG_EXT_SENS_DATA + 23U)   /* EXT_SENS_DATA_23 */
+
+SPI_HandleTypeDef hspi1;
+DMA_HandleTypeDef hdma_spi1_rx;
+DMA_HandleTypeDef hdma_spi1_tx;
+
+static uint8_t pSpiTx[IMU_PORT_SPI_MAX_SIZE + 1];   /*!< Address and data out               */
+static uint8_t pSpiRx[IMU_PORT_SPI_MAX_SIZE + 1];   /*!< Dummy and data in                  */
+static uint8_t* pSpiJobData;                        /*!< Running job read data              */
+static uint16_t spiJobSize;                         /*!< Running job read bytes, 0 if write */
+
+/**
+ * @brief Set the SPI clock prescaler, SPI disabled and enabled by the next transfer
+*/
+static void IMU_Port_SpiSetSpeed(uint32_t prescaler)
+{
+    if ((hspi1.Instance->CR1 & SPI_CR1_BR) == prescaler) return;
+    __HAL_SPI_DISABLE(&hspi1);
+    MODIFY_REG(hspi1.Instance->CR1, SPI_CR1_BR, prescaler);
+    hspi1.Init.BaudRatePrescaler = prescaler;
+}
+
+/**
+ * @brief Check if a job reads sensor data only, ACCEL_XOUT_H to EXT_SENS_DATA_23 or FIFO_R_W
+*/
+static bool_t IMU_Port_SpiIsData(const IMU_Port_JobTypeDef* pJob)
+{
+    if (pJob->write) return false;
+    if (pJob->reg == IMU_REG_FIFO_R_W) return true;
+    return pJob->reg >= IMU_REG_ACCEL_XOUT_H && pJob->reg + pJob->size - 1U <= IMU_PORT_SPI_DATA_LAST;
+}
+
+/**
+ * @brief SPI bus init function
+*/
+IMU_Bridge_StatusTypeDef IMU_Port_BusInit(void)
+{
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    HAL_GPIO_WritePin(IMU_PORT_SPI_NCS_PORT, IMU_PORT_SPI_NCS_PIN, GPIO_PIN_SET);
+    GPIO_InitStruct.Pin = IMU_PORT_SPI_NCS_PIN;
+    GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+    HAL_GPIO_Init(IMU_PORT_SPI_NCS_PORT, &GPIO_InitStruct);
+
+    hspi1.Instance = SPI1;
+    hspi1.Init.Mode = SPI_MODE_MASTER;
+    hspi1.Init.Direction = SPI_DIRECTION_2LINES;
+    hspi1.Init.DataSize = SPI_DATASIZE_8BIT;
+    hspi1.Init.CLKPolarity = SPI_POLARITY_HIGH;
+    hspi1.Init.CLKPhase = SPI_PHASE_2EDGE;
+    hspi1.Init.NSS = SPI_NSS_SOFT;
+    hspi1.Init.BaudRatePrescaler = IMU_PORT_SPI_REG_SPEED;
+    hspi1.Init.FirstBit = SPI_FIRSTBIT_MSB;
+    hspi1.Init.TIMode = SPI_TIMODE_DISABLE;
+    hspi1.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+    hspi1.Init.CRCPolynomial = 10;
+    if (HAL_SPI_Init(&hspi1) != HAL_OK) return IMU_BRIDGE_ERROR;
+
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief Start a bus job transfer, full duplex DMA
+ * @note Called with the bus ready, from the job queue
+*/
+IMU_Bridge_StatusTypeDef IMU_Port_BusStart(const IMU_Port_JobTypeDef* pJob)
+{
+    if (pJob->size > IMU_PORT_SPI_MAX_SIZE) return IMU_BRIDGE_ERROR;
+
+    IMU_Port_SpiSetSpeed(IMU_Port_SpiIsData(pJob) ? IMU_PORT_SPI_DATA_SPEED : IMU_PORT_SPI_REG_SPEED);
+    if (pJob->write)
+    {
+        pSpiTx[0] = pJob->reg;
+        memcpy(&pSpiTx[1], pJob->pData, pJob->size);
+        spiJobSize = 0;
+    }
+    else
+    {
+        pSpiTx[0] = pJob->reg | IMU_PORT_SPI_READ;
+        spiJobSize = pJob->size;
+    }
+    pSpiJobData = pJob->pData;
+
+    HAL_GPIO_WritePin(IMU_PORT_SPI_NCS_PORT, IMU_PORT_SPI_NCS_PIN, GPIO_PIN_RESET);
+    if (HAL_SPI_TransmitReceive_DMA(&hspi1, pSpiTx, pSpiRx, pJob->size + 1U) != HAL_OK)
+    {
+        HAL_GPIO_WritePin(IMU_PORT_SPI_NCS_PORT, IMU_PORT_SPI_NCS_PIN, GPIO_PIN_SET);
+        return IMU_BRIDGE_ERROR;
+    }
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief Check if the handle is free for a new transfer
+*/
+bool_t IMU_Port_BusIsReady(void)
+{
+    return HAL_SPI_GetState(&hspi1) == HAL_SPI_STATE_READY;
+}
+
+/**
+ * @brief Result of the last transfer, once the handle is ready
+*/
+IMU_Bridge_StatusTypeDef IMU_Port_BusResult(void)
+{
+    return (HAL_SPI_GetError(&hspi1) == HAL_SPI_ERROR_NONE) ? IMU_BRIDGE_OK : IMU_BRIDGE_ERROR;
+}
+
+void HAL_SPI_MspInit(SPI_HandleTypeDef* hspi)
+{
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    if(hspi->Instance==SPI1)
+    {
+        /* SPI1 clock enable */
+        __HAL_RCC_SPI1_CLK_ENABLE();
+        __HAL_RCC_GPIOA_CLK_ENABLE();
+        __HAL_RCC_DMA1_CLK_ENABLE();
+
+        /**SPI1 GPIO Configuration
+        PA5     ------> SPI1_SCK
+        PA6     ------> SPI1_MISO
+        PA7     ------> SPI1_MOSI
+        */
+        GPIO_InitStruct.Pin = GPIO_PIN_5|GPIO_PIN_7;
+        GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+        GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+        HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+        GPIO_InitStruct.Pin = GPIO_PIN_6;
+        GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
+        GPIO_InitStruct.Pull = GPIO_NOPULL;
+        HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+        /* SPI1 DMA Init */
+        /* SPI1_RX Init */
+        hdma_spi1_rx.Instance = DMA1_Channel2;
+        hdma_spi1_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+        hdma_spi1_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+        hdma_spi1_rx.Init.MemInc = DMA_MINC_ENABLE;
+        hdma_spi1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_spi1_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+        hdma_spi1_rx.Init.Mode = DMA_NORMAL;
+        hdma_spi1_rx.Init.Priority = DMA_PRIORITY_HIGH;
+        if (HAL_DMA_Init(&hdma_spi1_rx) != HAL_OK)
+        {
+            Error_Handler();
+        }
+        __HAL_LINKDMA(hspi,hdmarx,hdma_spi1_rx);
+
+        /* SPI1_TX Init */
+        hdma_spi1_tx.Instance = DMA1_Channel3;
+        hdma_spi1_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+        hdma_spi1_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+        hdma_spi1_tx.Init.MemInc = DMA_MINC_ENABLE;
+        hdma_spi1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_spi1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+        hdma_spi1_tx.Init.Mode = DMA_NORMAL;
+        hdma_spi1_tx.Init.Priority = DMA_PRIORITY_MEDIUM;
+        if (HAL_DMA_Init(&hdma_spi1_tx) != HAL_OK)
+        {
+            Error_Handler();
+        }
+        __HAL_LINKDMA(hspi,hdmatx,hdma_spi1_tx);
+
+        /* DMA interrupt Init */
+        HAL_NVIC_SetPriority(DMA1_Channel2_IRQn, 0, 0);
+        HAL_NVIC_EnableIRQ(DMA1_Channel2_IRQn);
+        HAL_NVIC_SetPriority(DMA1_Channel3_IRQn, 0, 0);
+        HAL_NVIC_EnableIRQ(DMA1_Channel3_IRQn);
+    }
+}
+
+void HAL_SPI_MspDeInit(SPI_HandleTypeDef* hspi)
+{
+    if(hspi->Instance==SPI1)
+    {
+        /* Peripheral clock disable */
+        __HAL_RCC_SPI1_CLK_DISABLE();
+        HAL_GPIO_DeInit(GPIOA, GPIO_PIN_5|GPIO_PIN_6|GPIO_PIN_7);
+
+        /* SPI1 DMA DeInit */
+        HAL_DMA_DeInit(hspi->hdmarx);
+        HAL_DMA_DeInit(hspi->hdmatx);
+        HAL_NVIC_DisableIRQ(DMA1_Channel2_IRQn);
+        HAL_NVIC_DisableIRQ(DMA1_Channel3_IRQn);
+    }
+}
+
+/**
+ * @brief This function handles DMA1 channel2 global interrupt, SPI1 RX
+*/
+void DMA1_Channel2_IRQHandler(void)
+{
+    HAL_DMA_IRQHandler(&hdma_spi1_rx);
+    IMU_Port_IRQHandler();
+}
+
+/**
+ * @brief This function handles DMA1 channel3 global interrupt, SPI1 TX
+*/
+void DMA1_Channel3_IRQHandler(void)
+{
+    HAL_DMA_IRQHandler(&hdma_spi1_tx);
+}
+
+/**
+ * @brief SPI transfer complete, release the chip and hand the data to the job
+*/
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    if (hspi->Instance != SPI1) return;
+
+    HAL_GPIO_WritePin(IMU_PORT_SPI_NCS_PORT, IMU_PORT_SPI_NCS_PIN, GPIO_PIN_SET);
+    if (spiJobSize > 0) memcpy(pSpiJobData, &pSpiRx[1], spiJobSize);
+}
+
+/**
+ * @brief SPI transfer error, release the chip
+*/
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    if (hspi->Instance != SPI1) return;
+
+    HAL_GPIO_WritePin(IMU_PORT_SPI_NCS_PORT, IMU_PORT_SPI_NCS_PIN, GPIO_PIN_SET);
+}
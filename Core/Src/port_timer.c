@@ -0,0 +1,136 @@
+/**
+  ******************************************************************************
+  * @file           : port_timer.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : IMU Bridge sample timer port for STM32F1XX
+  ******************************************************************************
+  * @attention
+  *
+  * IMU Bridge sample timer port for STM32F1XX. TIM2 counts at 1 MHz and the
+  * channel 1 compare interrupt paces the sampling. Periods longer than the
+  * 16 bit counter range are split in compare steps, so any period is exact
+  * to the microsecond and doesn't drift.
+  * Tested on STM32F103C8T6.
+  *
+  ******************************************************************************
+  */
+
+#include "port_timer.h"
+#include "imu_bridge_sensor.h"
+#include "main.h"
+
+TIM_HandleTypeDef htim2;
+
+static uint32_t timerPeriod;                        /*!< Sampling period, us                */
+static volatile uint32_t timerRemaining;            /*!< Period left after the next compare */
+
+/**
+ * @brief Timer init function
+*/
+IMU_Bridge_StatusTypeDef Timer_Init(void)
+{
+    TIM_OC_InitTypeDef sConfigOC = {0};
+
+    htim2.Instance = TIM2;
+    htim2.Init.Prescaler = 71;     /* 72 MHz APB1 timer clock, 1 MHz tick */
+    htim2.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim2.Init.Period = 0xFFFF;
+    htim2.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    htim2.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    if (HAL_TIM_OC_Init(&htim2) != HAL_OK) return IMU_BRIDGE_ERROR;
+
+    sConfigOC.OCMode = TIM_OCMODE_TIMING;
+    sConfigOC.Pulse = 0;
+    sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
+    sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+    if (HAL_TIM_OC_ConfigChannel(&htim2, &sConfigOC, TIM_CHANNEL_1) != HAL_OK) return IMU_BRIDGE_ERROR;
+
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief   Program the next compare step towards the next sample
+ * @note    The last two steps of a long period split what's left evenly,
+ *          so no step is shorter than TIMER_MAX_STEP / 2. A step of a few
+ *          microseconds could pass before the compare is written, and the
+ *          sample would wait a whole counter wrap.
+*/
+static void Timer_ScheduleNext(void)
+{
+    uint32_t step;
+
+    if (timerRemaining > 2U * TIMER_MAX_STEP) step = TIMER_MAX_STEP;
+    else if (timerRemaining > TIMER_MAX_STEP) step = (timerRemaining + 1U) / 2U;
+    else step = timerRemaining;
+
+    timerRemaining -= step;
+    __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, (__HAL_TIM_GET_COMPARE(&htim2, TIM_CHANNEL_1) + step) & 0xFFFFU);
+}
+
+/**
+ * @brief   Start periodic sampling
+ * @param   periodUs: sampling period in microseconds
+*/
+IMU_Bridge_StatusTypeDef Timer_Start(uint32_t periodUs)
+{
+    if (periodUs == 0) return IMU_BRIDGE_ERROR;
+    if (Timer_Stop() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
+
+    timerPeriod = periodUs;
+    timerRemaining = periodUs;
+    __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, __HAL_TIM_GET_COUNTER(&htim2));
+    Timer_ScheduleNext();
+    __HAL_TIM_CLEAR_FLAG(&htim2, TIM_FLAG_CC1);
+
+    if (HAL_TIM_OC_Start_IT(&htim2, TIM_CHANNEL_1) != HAL_OK) return IMU_BRIDGE_ERROR;
+    return IMU_BRIDGE_OK;
+}
+
+/**
+ * @brief Stop periodic sampling
+*/
+IMU_Bridge_StatusTypeDef Timer_Stop(void)
+{
+    if (HAL_TIM_OC_Stop_IT(&htim2, TIM_CHANNEL_1) != HAL_OK) return IMU_BRIDGE_ERROR;
+    return IMU_BRIDGE_OK;
+}
+
+void HAL_TIM_OC_MspInit(TIM_HandleTypeDef* htim)
+{
+    if(htim->Instance==TIM2)
+    {
+        /* TIM2 clock enable */
+        __HAL_RCC_TIM2_CLK_ENABLE();
+
+        /* TIM2 interrupt Init */
+        HAL_NVIC_SetPriority(TIM2_IRQn, 0, 0);
+        HAL_NVIC_EnableIRQ(TIM2_IRQn);
+    }
+}
+
+void HAL_TIM_OC_MspDeInit(TIM_HandleTypeDef* htim)
+{
+    if(htim->Instance==TIM2)
+    {
+        /* Peripheral clock disable */
+        __HAL_RCC_TIM2_CLK_DISABLE();
+
+        /* TIM2 interrupt Deinit */
+        HAL_NVIC_DisableIRQ(TIM2_IRQn);
+    }
+}
+
+/**
+ * @brief Compare match callback, a sample is due when the period is consumed
+*/
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim)
+{
+    if (htim->Instance != TIM2) return;
+
+    if (timerRemaining == 0)
+    {
+        timerRemaining = timerPeriod;
+        IMU_Bridge_TimerCallback();
+    }
+    Timer_ScheduleNext();
+}
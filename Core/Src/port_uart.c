@@ -13,13 +13,25 @@
   */
 
 #include "port_uart.h"
-#include "stm32f1xx_hal.h"
+#include "ring_buffer.h"
+#include "main.h"
 
 #include <assert.h>
 #include <string.h>
 
 UART_HandleTypeDef huart1;
-static uint8_t pRxBuffer[UART_BUFFER_SIZE];
+DMA_HandleTypeDef hdma_usart1_rx;
+DMA_HandleTypeDef hdma_usart1_tx;
+
+static uint8_t pRxBuffer[UART_RX_BUFFER_SIZE];      /*!< RX circular DMA buffer             */
+static uint16_t rxLastPos;                          /*!< RX buffer position already handled */
+
+static uint8_t pTxStorage[UART_TX_BUFFER_SIZE];     /*!< TX ring storage                    */
+static RingBuffer_TypeDef txRing;                   /*!< TX ring, FSM to USART1 ISR         */
+static volatile uint16_t txDmaSize;                 /*!< Bytes in flight, 0 if DMA is idle  */
+static uint32_t rxIsrMaxCycles;                     /*!< Worst case RX event callback time  */
+
+static IMU_Bridge_StatusTypeDef UART_RxStart(void);
 
 /**
  * @brief UART init function
@@ -35,31 +47,123 @@ IMU_Bridge_StatusTypeDef UART_Init(void)
     huart1.Init.HwFlowCtl = UART_HWCONTROL_NONE;
     huart1.Init.OverSampling = UART_OVERSAMPLING_16;
 
+    RingBuffer_Init(&txRing, pTxStorage, UART_TX_BUFFER_SIZE);
+    txDmaSize = 0;
+    rxIsrMaxCycles = 0;
+
+    /* DWT cycle counter, used to profile interrupt handlers */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
     if (HAL_UART_Init(&huart1) != HAL_OK) return IMU_BRIDGE_ERROR;
 
-    HAL_UART_Receive_IT(&huart1, pRxBuffer, UART_BUFFER_SIZE);
+    if (UART_RxStart() != IMU_BRIDGE_OK) return IMU_BRIDGE_ERROR;
 
     return IMU_BRIDGE_OK;
 }
 
+/**
+ * @brief Start circular DMA reception with IDLE line detection
+*/
+static IMU_Bridge_StatusTypeDef UART_RxStart(void)
+{
+    rxLastPos = 0;
+    if (HAL_UARTEx_ReceiveToIdle_DMA(&huart1, pRxBuffer, UART_RX_BUFFER_SIZE) != HAL_OK) return IMU_BRIDGE_ERROR;
+    /* Only buffer wrap and IDLE events are needed */
+    __HAL_DMA_DISABLE_IT(&hdma_usart1_rx, DMA_IT_HT);
+    return IMU_BRIDGE_OK;
+}
+
 /**
  * @brief UART transmit data
+ * @note Non-blocking, single producer. Data is queued in the TX ring and
+ *       the USART1 interrupt is pended to drain it. Returns error if the
+ *       data doesn't fit in the free ring space.
 */
 IMU_Bridge_StatusTypeDef UART_Transmit(uint8_t* pData, uint16_t size)
 {
-    if (HAL_UART_Transmit(&huart1, pData, size, 100) != HAL_OK) return IMU_BRIDGE_ERROR;
+    if (!RingBuffer_Write(&txRing, pData, size)) return IMU_BRIDGE_ERROR;
+    HAL_NVIC_SetPendingIRQ(USART1_IRQn);
     return IMU_BRIDGE_OK;
 }
 
 /**
- * @brief Read UART RX buffer
+ * @brief Reserve a contiguous region of the TX ring to format into
+ * @retval Pointer to the region, NULL if there's no room
 */
-void UART_ReadRxBuffer(uint8_t* pData)
+uint8_t* UART_TxReserve(uint16_t size)
 {
-    assert(pData);
-    pData[0] = pRxBuffer[0];
-    pData[1] = pRxBuffer[1];
-    pData[2] = pRxBuffer[2];
+    return RingBuffer_Reserve(&txRing, size);
+}
+
+/**
+ * @brief Send the bytes written into the last reserved region
+*/
+void UART_TxCommit(uint16_t size)
+{
+    RingBuffer_Commit(&txRing, size);
+    HAL_NVIC_SetPendingIRQ(USART1_IRQn);
+}
+
+/**
+ * @brief UART TX ring consumer
+ * @note To be called from USART1_IRQHandler only. Starts a DMA transfer of
+ *       the next contiguous block of the ring if the DMA is idle.
+*/
+void UART_TxIRQHandler(void)
+{
+    uint8_t *pData;
+    uint32_t size;
+
+    if (txDmaSize != 0) return;
+
+    size = RingBuffer_Peek(&txRing, &pData);
+    if (size == 0) return;
+    if (size > UINT16_MAX) size = UINT16_MAX;
+
+    txDmaSize = (uint16_t)size;
+    if (HAL_UART_Transmit_DMA(&huart1, pData, (uint16_t)size) != HAL_OK) txDmaSize = 0;
+}
+
+/**
+ * @brief Get TX ring statistics
+ * @param pHighWater: max bytes queued at once
+ * @param pOverflow: messages dropped because the ring was full
+*/
+void UART_GetTxStats(uint32_t* pHighWater, uint32_t* pOverflow)
+{
+    assert(pHighWater);
+    assert(pOverflow);
+    *pHighWater = txRing.highWater;
+    *pOverflow = txRing.overflow;
+}
+
+/**
+ * @brief Get RX statistics
+ * @param pIsrMaxCycles: worst case RX event callback duration in CPU cycles
+*/
+void UART_GetRxStats(uint32_t* pIsrMaxCycles)
+{
+    assert(pIsrMaxCycles);
+    *pIsrMaxCycles = rxIsrMaxCycles;
+}
+
+/**
+ * @brief UART RX IDLE line check
+ * @note To be called from USART1_IRQHandler before the HAL handler. The HAL
+ *       doesn't report an IDLE event that lands right on the buffer wrap,
+ *       as there are no new bytes, but it still ends a frame.
+*/
+void UART_RxIRQHandler(void)
+{
+    if (__HAL_UART_GET_FLAG(&huart1, UART_FLAG_IDLE) &&
+        __HAL_UART_GET_IT_SOURCE(&huart1, UART_IT_IDLE) &&
+        rxLastPos == 0 &&
+        __HAL_DMA_GET_COUNTER(&hdma_usart1_rx) == UART_RX_BUFFER_SIZE)
+    {
+        IMU_Bridge_RxIdleCallback();
+    }
 }
 
 void HAL_UART_MspInit(UART_HandleTypeDef* uartHandle)
@@ -84,6 +188,39 @@ void HAL_UART_MspInit(UART_HandleTypeDef* uartHandle)
         GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
         GPIO_InitStruct.Pull = GPIO_NOPULL;
         HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+        /* USART1 DMA Init */
+        /* USART1_RX Init */
+        hdma_usart1_rx.Instance = DMA1_Channel5;
+        hdma_usart1_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+        hdma_usart1_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+        hdma_usart1_rx.Init.MemInc = DMA_MINC_ENABLE;
+        hdma_usart1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_usart1_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+        hdma_usart1_rx.Init.Mode = DMA_CIRCULAR;
+        hdma_usart1_rx.Init.Priority = DMA_PRIORITY_MEDIUM;
+        if (HAL_DMA_Init(&hdma_usart1_rx) != HAL_OK)
+        {
+            Error_Handler();
+        }
+
+        __HAL_LINKDMA(uartHandle,hdmarx,hdma_usart1_rx);
+
+        /* USART1_TX Init */
+        hdma_usart1_tx.Instance = DMA1_Channel4;
+        hdma_usart1_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+        hdma_usart1_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+        hdma_usart1_tx.Init.MemInc = DMA_MINC_ENABLE;
+        hdma_usart1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_usart1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+        hdma_usart1_tx.Init.Mode = DMA_NORMAL;
+        hdma_usart1_tx.Init.Priority = DMA_PRIORITY_LOW;
+        if (HAL_DMA_Init(&hdma_usart1_tx) != HAL_OK)
+        {
+            Error_Handler();
+        }
+
+        __HAL_LINKDMA(uartHandle,hdmatx,hdma_usart1_tx);
     
         /* USART1 interrupt Init */
         HAL_NVIC_SetPriority(USART1_IRQn, 0, 0);
@@ -104,15 +241,68 @@ void HAL_UART_MspDeInit(UART_HandleTypeDef* uartHandle)
         */
         HAL_GPIO_DeInit(GPIOA, GPIO_PIN_9|GPIO_PIN_10);
 
+        /* USART1 DMA DeInit */
+        HAL_DMA_DeInit(uartHandle->hdmarx);
+        HAL_DMA_DeInit(uartHandle->hdmatx);
+
         /* USART1 interrupt Deinit */
         HAL_NVIC_DisableIRQ(USART1_IRQn);
     }
 }
 
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+/**
+ * @brief UART RX event, called on IDLE line and on RX buffer wrap
+ * @param Size: RX buffer position of the last received byte
+*/
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+    uint32_t start = Sys_GetCycles();
+    uint32_t cycles;
+
+    if (huart->Instance != USART1) return;
+
+    if (Size > rxLastPos)
+    {
+        IMU_Bridge_RxCallback(&pRxBuffer[rxLastPos], Size - rxLastPos);
+    }
+    else if (Size < rxLastPos)
+    {
+        IMU_Bridge_RxCallback(&pRxBuffer[rxLastPos], UART_RX_BUFFER_SIZE - rxLastPos);
+        IMU_Bridge_RxCallback(pRxBuffer, Size);
+    }
+
+    if (Size == UART_RX_BUFFER_SIZE)
+    {
+        rxLastPos = 0;
+    }
+    else
+    {
+        rxLastPos = Size;
+        IMU_Bridge_RxIdleCallback();
+    }
+
+    cycles = Sys_GetCycles() - start;
+    if (cycles > rxIsrMaxCycles) rxIsrMaxCycles = cycles;
+}
+
+/**
+ * @brief UART error, the HAL aborts the reception so restart it
+*/
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if (huart->Instance != USART1) return;
+    if (huart->RxState == HAL_UART_STATE_READY) UART_RxStart();
+}
+
+/**
+ * @brief UART transmission complete, release the block and send the next one
+*/
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
 {
-    IMU_Bridge_RxCallback();
-    HAL_UART_Receive_IT(&huart1, pRxBuffer, UART_BUFFER_SIZE);
+    if (huart->Instance != USART1) return;
+    RingBuffer_Consume(&txRing, txDmaSize);
+    txDmaSize = 0;
+    UART_TxIRQHandler();
 }
 
 
@@ -123,4 +313,34 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 tick_t Sys_GetTick(void)
 {
     return (tick_t)HAL_GetTick();
+}
+
+/**
+  * @brief  Get CPU cycle counter, for profiling.
+  * @retval uint32_t
+  */
+uint32_t Sys_GetCycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+/**
+  * @brief  Convert CPU cycles to microseconds.
+  * @retval uint32_t
+  */
+uint32_t Sys_CyclesToUs(uint32_t cycles)
+{
+    return cycles / (SystemCoreClock / 1000000U);
+}
+
+/**
+  * @brief  Sleep until an interrupt, unless an event is already pending.
+  * @note   Interrupts are masked while checking, so an event posted right
+  *         before the WFI still wakes the core.
+  */
+void Sys_Sleep(void)
+{
+    __disable_irq();
+    if (!IMU_Bridge_EventPending()) __WFI();
+    __enable_irq();
 }
\ No newline at end of file
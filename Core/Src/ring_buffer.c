@@ -0,0 +1,188 @@
+/**
+  ******************************************************************************
+  * @file           : ring_buffer.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Lock-free SPSC byte ring buffer
+  ******************************************************************************
+  * @attention
+  *
+  * The producer only writes head and the consumer only writes tail. Each side
+  * publishes its index with release semantics after touching the data, so
+  * the other side never sees an index ahead of the bytes it covers.
+  *
+  ******************************************************************************
+  */
+
+#include "ring_buffer.h"
+
+#include <assert.h>
+#include <string.h>
+
+/**
+ * @brief Ring buffer init
+ * @param pRing: ring buffer handle
+ * @param pBuffer: storage, size bytes long
+ * @param size: storage size, must be a power of two
+ * @retval false if size is not a power of two
+*/
+bool RingBuffer_Init(RingBuffer_TypeDef *pRing, uint8_t *pBuffer, uint32_t size)
+{
+    assert(pRing);
+    assert(pBuffer);
+
+    if (size == 0 || (size & (size - 1)) != 0) return false;
+
+    pRing->pBuffer = pBuffer;
+    pRing->size = size;
+    atomic_store_explicit(&pRing->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&pRing->tail, 0, memory_order_relaxed);
+    atomic_store_explicit(&pRing->wrap, UINT32_MAX, memory_order_relaxed);
+    pRing->reserved = 0;
+    pRing->reservedSkip = 0;
+    pRing->highWater = 0;
+    pRing->overflow = 0;
+    return true;
+}
+
+/**
+ * @brief Bytes waiting to be consumed
+*/
+uint32_t RingBuffer_Used(RingBuffer_TypeDef *pRing)
+{
+    uint32_t head = atomic_load_explicit(&pRing->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&pRing->tail, memory_order_acquire);
+    return head - tail;
+}
+
+/**
+ * @brief Bytes available to the producer
+*/
+uint32_t RingBuffer_Free(RingBuffer_TypeDef *pRing)
+{
+    return pRing->size - RingBuffer_Used(pRing);
+}
+
+/**
+ * @brief Write data into the ring (producer side)
+ * @note All or nothing, if data doesn't fit it's dropped and counted as overflow
+ * @retval true if data was queued
+*/
+bool RingBuffer_Write(RingBuffer_TypeDef *pRing, const uint8_t *pData, uint32_t size)
+{
+    uint32_t head = atomic_load_explicit(&pRing->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&pRing->tail, memory_order_acquire);
+    uint32_t used = head - tail;
+    uint32_t offset = head & (pRing->size - 1);
+    uint32_t chunk;
+
+    if (size > pRing->size - used)
+    {
+        pRing->overflow++;
+        return false;
+    }
+
+    chunk = pRing->size - offset;
+    if (chunk > size) chunk = size;
+    memcpy(&pRing->pBuffer[offset], pData, chunk);
+    memcpy(pRing->pBuffer, pData + chunk, size - chunk);
+
+    atomic_store_explicit(&pRing->head, head + size, memory_order_release);
+
+    used += size;
+    if (used > pRing->highWater) pRing->highWater = used;
+    return true;
+}
+
+/**
+ * @brief Reserve a contiguous region to be filled in place (producer side)
+ * @note If there's no room the reservation is counted as overflow
+ * @param size: bytes to reserve
+ * @retval Pointer to the region, NULL if there's no room
+*/
+uint8_t* RingBuffer_Reserve(RingBuffer_TypeDef *pRing, uint32_t size)
+{
+    uint32_t head = atomic_load_explicit(&pRing->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&pRing->tail, memory_order_acquire);
+    uint32_t offset = head & (pRing->size - 1);
+    uint32_t skip = 0;
+
+    /* Not enough room before the end of the storage, skip to the start */
+    if (size > pRing->size - offset)
+    {
+        skip = pRing->size - offset;
+        offset = 0;
+    }
+
+    if (skip + size > pRing->size - (head - tail))
+    {
+        pRing->reserved = 0;
+        pRing->overflow++;
+        return NULL;
+    }
+
+    pRing->reserved = size;
+    pRing->reservedSkip = skip;
+    return &pRing->pBuffer[offset];
+}
+
+/**
+ * @brief Publish the bytes written in the last reserved region (producer side)
+ * @param size: bytes actually written, clamped to the reserved size
+*/
+void RingBuffer_Commit(RingBuffer_TypeDef *pRing, uint32_t size)
+{
+    uint32_t head = atomic_load_explicit(&pRing->head, memory_order_relaxed);
+    uint32_t tail;
+
+    if (size > pRing->reserved) size = pRing->reserved;
+    pRing->reserved = 0;
+    if (size == 0) return;
+
+    if (pRing->reservedSkip != 0)
+    {
+        atomic_store_explicit(&pRing->wrap, head, memory_order_relaxed);
+        head += pRing->reservedSkip;
+    }
+    atomic_store_explicit(&pRing->head, head + size, memory_order_release);
+
+    tail = atomic_load_explicit(&pRing->tail, memory_order_relaxed);
+    if (head + size - tail > pRing->highWater) pRing->highWater = head + size - tail;
+}
+
+/**
+ * @brief Get the contiguous block of data at the tail (consumer side)
+ * @param ppData: returns pointer to the first byte
+ * @retval Contiguous bytes available, 0 if empty
+*/
+uint32_t RingBuffer_Peek(RingBuffer_TypeDef *pRing, uint8_t **ppData)
+{
+    uint32_t tail = atomic_load_explicit(&pRing->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&pRing->head, memory_order_acquire);
+    uint32_t wrap = atomic_load_explicit(&pRing->wrap, memory_order_relaxed);
+    uint32_t offset;
+    uint32_t size;
+
+    /* Jump over the region skipped by a reservation */
+    if (tail != head && tail == wrap)
+    {
+        tail += pRing->size - (tail & (pRing->size - 1));
+        atomic_store_explicit(&pRing->tail, tail, memory_order_release);
+    }
+
+    offset = tail & (pRing->size - 1);
+    size = head - tail;
+    if (size > pRing->size - offset) size = pRing->size - offset;
+    if (wrap - tail < size) size = wrap - tail;
+
+    *ppData = &pRing->pBuffer[offset];
+    return size;
+}
+
+/**
+ * @brief Release bytes already processed (consumer side)
+*/
+void RingBuffer_Consume(RingBuffer_TypeDef *pRing, uint32_t size)
+{
+    uint32_t tail = atomic_load_explicit(&pRing->tail, memory_order_relaxed);
+    atomic_store_explicit(&pRing->tail, tail + size, memory_order_release);
+}
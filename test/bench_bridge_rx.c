@@ -0,0 +1,53 @@
+/**
+  ******************************************************************************
+  * @file           : bench_bridge_rx.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Command reception host benchmark
+  ******************************************************************************
+  * @attention
+  *
+  * Command reception host benchmark: the USART1 interrupt part of a command
+  * frame, bytes copied into the RX ring, against the deferred main loop
+  * part, command assembly and echo formatting, which the interrupt used to
+  * run. Host times, the split between the two is what carries over.
+  *
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "main.h"
+#include "imu_bridge.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_FRAMES        200000U
+
+static uint8_t pWire[4096];                         /*!< Bytes out of the stand-in port     */
+
+int main(void)
+{
+    static const char pFrame[] = "RTS 1000\n";
+    uint64_t isrNs = 0, processNs = 0, start;
+
+    if (IMU_Bridge_Init() != IMU_BRIDGE_OK) return 1;
+
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++)
+    {
+        start = Test_NowNs();
+        Host_UartRxWrite((const uint8_t*)pFrame, sizeof(pFrame) - 1U);
+        Host_UartRxIdle();
+        isrNs += Test_NowNs() - start;
+
+        start = Test_NowNs();
+        IMU_Bridge_ProcessRx();
+        processNs += Test_NowNs() - start;
+
+        IMU_Bridge_GetCmd();
+        Host_UartTxDrain(pWire, sizeof(pWire));
+    }
+
+    printf("%-40s %10.1f ns\n", "RX interrupt, per frame", (double)isrNs / BENCH_FRAMES);
+    printf("%-40s %10.1f ns\n", "Deferred assembly and echo, per frame", (double)processNs / BENCH_FRAMES);
+    return 0;
+}
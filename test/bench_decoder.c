@@ -0,0 +1,143 @@
+/**
+  ******************************************************************************
+  * @file           : bench_decoder.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Command decoder host benchmark
+  ******************************************************************************
+  * @attention
+  *
+  * Command decoder host benchmark: the strcmp chain IMU_Bridge_GetCmd() ran
+  * before the command table, copied here with its 21 commands, against
+  * IMU_Bridge_DecodeCmd() and its 41 commands. Hit, miss and idle inputs.
+  * On an idle tick the chain compared the empty buffer "000" to every
+  * command, now IMU_Bridge_GetCmd() returns on the empty command FIFO.
+  *
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "main.h"
+#include "imu_bridge.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_ITERATIONS    20000000U
+
+static const char* const pHits[] =
+{
+    "STY", "INT", "CFG", "CG1", "CG2", "CG3", "CG4", "CA1", "CA2", "CA3", "CA4",
+    "RDM", "AAW", "GAW", "TMP", "RTM", "RTG", "RTA", "RTT", "EXT", "STS"
+};
+static const char* const pMisses[] = { "XYZ", "CG9", "RTZ", "AAA", "STX", "ZZZ", "C", "RT" };
+
+#define BENCH_HITS      (sizeof(pHits) / sizeof(pHits[0]))
+#define BENCH_MISSES    (sizeof(pMisses) / sizeof(pMisses[0]))
+
+static const char* volatile pInput;                 /*!< Opaque to the compiler             */
+static volatile IMU_Bridge_CmdTypeDef result;       /*!< Kept, so the decode isn't dropped  */
+
+/**
+ * @brief The strcmp chain of IMU_Bridge_GetCmd() before the command table
+*/
+static IMU_Bridge_CmdTypeDef Bench_DecodeChain(const char* pCmd)
+{
+    IMU_Bridge_CmdTypeDef cmd;
+
+    if (strcmp(pCmd, "STY") == 0) cmd = IMU_BRIDGE_CMD_SANITY;
+    else if (strcmp(pCmd, "INT") == 0) cmd = IMU_BRIDGE_CMD_INIT;
+    else if (strcmp(pCmd, "CFG") == 0) cmd = IMU_BRIDGE_CMD_CONFIG;
+    else if (strcmp(pCmd, "CG1") == 0) cmd = IMU_BRIDGE_CMD_CFG_GYRO_FS250;
+    else if (strcmp(pCmd, "CG2") == 0) cmd = IMU_BRIDGE_CMD_CFG_GYRO_FS500;
+    else if (strcmp(pCmd, "CG3") == 0) cmd = IMU_BRIDGE_CMD_CFG_GYRO_FS1000;
+    else if (strcmp(pCmd, "CG4") == 0) cmd = IMU_BRIDGE_CMD_CFG_GYRO_FS2000;
+    else if (strcmp(pCmd, "CA1") == 0) cmd = IMU_BRIDGE_CMD_CFG_ACCEL_FS2;
+    else if (strcmp(pCmd, "CA2") == 0) cmd = IMU_BRIDGE_CMD_CFG_ACCEL_FS4;
+    else if (strcmp(pCmd, "CA3") == 0) cmd = IMU_BRIDGE_CMD_CFG_ACCEL_FS8;
+    else if (strcmp(pCmd, "CA4") == 0) cmd = IMU_BRIDGE_CMD_CFG_ACCEL_FS16;
+    else if (strcmp(pCmd, "RDM") == 0) cmd = IMU_BRIDGE_CMD_READ_MODE;
+    else if (strcmp(pCmd, "AAW") == 0) cmd = IMU_BRIDGE_CMD_READ_ACCEL_ALL;
+    else if (strcmp(pCmd, "GAW") == 0) cmd = IMU_BRIDGE_CMD_READ_GYRO_ALL;
+    else if (strcmp(pCmd, "TMP") == 0) cmd = IMU_BRIDGE_CMD_READ_TEMP;
+    else if (strcmp(pCmd, "RTM") == 0) cmd = IMU_BRIDGE_CMD_REALTIME;
+    else if (strcmp(pCmd, "RTG") == 0) cmd = IMU_BRIDGE_CMD_REALTIME_GYRO;
+    else if (strcmp(pCmd, "RTA") == 0) cmd = IMU_BRIDGE_CMD_REALTIME_ACCEL;
+    else if (strcmp(pCmd, "RTT") == 0) cmd = IMU_BRIDGE_CMD_REALTIME_TEMP;
+    else if (strcmp(pCmd, "EXT") == 0) cmd = IMU_BRIDGE_CMD_EXIT;
+    else if (strcmp(pCmd, "STS") == 0) cmd = IMU_BRIDGE_CMD_STATS;
+    else cmd = IMU_BRIDGE_CMD_INVALID;
+    return cmd;
+}
+
+static void Bench_ChainHit(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        pInput = pHits[i % BENCH_HITS];
+        result = Bench_DecodeChain(pInput);
+    }
+}
+
+static void Bench_TableHit(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        pInput = pHits[i % BENCH_HITS];
+        result = IMU_Bridge_DecodeCmd(pInput);
+    }
+}
+
+static void Bench_ChainMiss(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        pInput = pMisses[i % BENCH_MISSES];
+        result = Bench_DecodeChain(pInput);
+    }
+}
+
+static void Bench_TableMiss(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        pInput = pMisses[i % BENCH_MISSES];
+        result = IMU_Bridge_DecodeCmd(pInput);
+    }
+}
+
+static void Bench_ChainIdle(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        pInput = "000";
+        result = Bench_DecodeChain(pInput);
+    }
+}
+
+static void Bench_GetCmdIdle(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++) result = IMU_Bridge_GetCmd();
+}
+
+int main(void)
+{
+    if (IMU_Bridge_Init() != IMU_BRIDGE_OK) return 1;
+
+    /* Both decoders agree on the commands of the chain */
+    for (uint32_t i = 0; i < BENCH_HITS; i++)
+    {
+        if (IMU_Bridge_DecodeCmd(pHits[i]) != Bench_DecodeChain(pHits[i])) return 1;
+    }
+    for (uint32_t i = 0; i < BENCH_MISSES; i++)
+    {
+        if (IMU_Bridge_DecodeCmd(pMisses[i]) != IMU_BRIDGE_CMD_INVALID) return 1;
+    }
+
+    Test_Bench("strcmp chain, hit", Bench_ChainHit, BENCH_ITERATIONS);
+    Test_Bench("Command table, hit", Bench_TableHit, BENCH_ITERATIONS);
+    Test_Bench("strcmp chain, miss", Bench_ChainMiss, BENCH_ITERATIONS);
+    Test_Bench("Command table, miss", Bench_TableMiss, BENCH_ITERATIONS);
+    Test_Bench("strcmp chain, idle \"000\"", Bench_ChainIdle, BENCH_ITERATIONS);
+    Test_Bench("GetCmd, idle", Bench_GetCmdIdle, BENCH_ITERATIONS);
+    return 0;
+}
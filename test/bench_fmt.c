@@ -0,0 +1,118 @@
+/**
+  ******************************************************************************
+  * @file           : bench_fmt.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Integer formatter host benchmark
+  ******************************************************************************
+  * @attention
+  *
+  * Integer formatter host benchmark: the text stream lines built by the
+  * TEXT encoder over fmt.c, against the snprintf calls they replaced, and
+  * a single int32 field each way. The host printf isn't newlib-nano, only
+  * the ratio is indicative of the target.
+  *
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "fmt.h"
+#include "imu_bridge.h"
+#include "imu_bridge_encoder.h"
+#include "imu_bridge_frame.h"
+
+#include <stdio.h>
+
+#define BENCH_ITERATIONS    5000000U
+#define BENCH_SAMPLES       256U
+
+static int16_t pSamples[BENCH_SAMPLES][IMU_BRIDGE_FRAME_MAX_CHANNELS];
+static char pLine[IMU_BRIDGE_TX_LINE_SIZE];
+static volatile char sink;                          /*!< Kept, so the lines aren't dropped  */
+
+static void Bench_SnprintfImu(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        const int16_t* v = pSamples[i % BENCH_SAMPLES];
+        snprintf(pLine, sizeof(pLine), "IMU READ:\t%lu\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n\r", (unsigned long)i,
+            v[0], v[1], v[2], v[3], v[4], v[5], v[6]);
+        sink = pLine[10];
+    }
+}
+
+static void Bench_FmtImu(uint32_t iterations)
+{
+    const IMU_Bridge_EncoderTypeDef* pText = IMU_Bridge_EncoderGet(IMU_BRIDGE_ENCODER_TEXT);
+    IMU_Bridge_RecordTypeDef record = { .mask = IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_TEMP | IMU_BRIDGE_SENSOR_GYRO };
+
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        record.tick = i;
+        record.pValues = pSamples[i % BENCH_SAMPLES];
+        pText->Record((uint8_t*)pLine, &record);
+        sink = pLine[10];
+    }
+}
+
+static void Bench_SnprintfGyro(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        const int16_t* v = pSamples[i % BENCH_SAMPLES];
+        snprintf(pLine, sizeof(pLine), "GYRO READ:\t%d\t%d\t%d\n\r", (uint16_t)v[0], (uint16_t)v[1], (uint16_t)v[2]);
+        sink = pLine[10];
+    }
+}
+
+static void Bench_FmtGyro(uint32_t iterations)
+{
+    const IMU_Bridge_EncoderTypeDef* pText = IMU_Bridge_EncoderGet(IMU_BRIDGE_ENCODER_TEXT);
+    IMU_Bridge_RecordTypeDef record = { .mask = IMU_BRIDGE_SENSOR_GYRO };
+
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        record.pValues = pSamples[i % BENCH_SAMPLES];
+        pText->Record((uint8_t*)pLine, &record);
+        sink = pLine[10];
+    }
+}
+
+static void Bench_SnprintfInt32(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        snprintf(pLine, sizeof(pLine), "%ld", (long)(int32_t)(i * 2654435761U));
+        sink = pLine[0];
+    }
+}
+
+static void Bench_FmtInt32(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        Fmt_Int32(pLine, (int32_t)(i * 2654435761U));
+        sink = pLine[0];
+    }
+}
+
+int main(void)
+{
+    uint32_t seed = 11;
+
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++)
+    {
+        for (uint8_t j = 0; j < IMU_BRIDGE_FRAME_MAX_CHANNELS; j++)
+        {
+            seed = seed * 1103515245U + 12345U;
+            pSamples[i][j] = (int16_t)(seed >> 16);
+        }
+    }
+
+    Test_Bench("snprintf, IMU READ line", Bench_SnprintfImu, BENCH_ITERATIONS);
+    Test_Bench("fmt, IMU READ line", Bench_FmtImu, BENCH_ITERATIONS);
+    Test_Bench("snprintf, GYRO READ line", Bench_SnprintfGyro, BENCH_ITERATIONS);
+    Test_Bench("fmt, GYRO READ line", Bench_FmtGyro, BENCH_ITERATIONS);
+    Test_Bench("snprintf, int32", Bench_SnprintfInt32, BENCH_ITERATIONS);
+    Test_Bench("fmt, int32", Bench_FmtInt32, BENCH_ITERATIONS);
+    return 0;
+}
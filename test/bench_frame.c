@@ -0,0 +1,153 @@
+/**
+  ******************************************************************************
+  * @file           : bench_frame.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Binary stream decoder host benchmark
+  ******************************************************************************
+  * @attention
+  *
+  * Binary stream decoder host benchmark: a stream of BINARY frames from the
+  * firmware encoder, noise-like samples of all the sensors, pushed a byte at
+  * a time through the stream decoder of frame_decode.c. The time is per
+  * frame, the throughput follows from the mean frame size.
+  *
+  * Then a DELTA stream of simulated 9-axis data, through the delta decoder
+  * too, with its compression ratio against BINARY frames and TEXT lines.
+  * The samples drift by small random steps, the compression depends on
+  * how correlated the real ones are.
+  *
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "imu_bridge.h"
+#include "imu_bridge_encoder.h"
+#include "imu_bridge_frame.h"
+#include "frame_decode.h"
+
+#include <stdio.h>
+
+#define BENCH_ITERATIONS    2000000U
+#define BENCH_FRAMES        1024U
+
+static uint8_t pStream[BENCH_FRAMES * (FRAME_DECODE_MAX_SIZE + 1U)];
+static uint32_t streamSize;
+static uint8_t pDeltaStream[BENCH_FRAMES * (FRAME_DECODE_MAX_SIZE + 1U)];
+static uint32_t deltaStreamSize;
+static Frame_DeltaDecoderTypeDef delta;
+static volatile uint16_t sink;                      /*!< Kept, so the records aren't dropped */
+
+static void Bench_Decoder(uint32_t iterations)
+{
+    Frame_DecoderTypeDef decoder;
+    Frame_RecordTypeDef record;
+    uint32_t i = 0, frames = 0;
+
+    Frame_DecoderInit(&decoder);
+    decoder.synced = true;
+    while (frames < iterations)
+    {
+        if (Frame_DecoderPush(&decoder, pStream[i], &record))
+        {
+            sink = record.seq;
+            frames++;
+        }
+        if (++i == streamSize) i = 0;
+    }
+}
+
+static void Bench_DeltaDecoder(uint32_t iterations)
+{
+    Frame_DecoderTypeDef decoder;
+    Frame_RecordTypeDef record;
+    uint32_t i = 0, frames = 0;
+
+    Frame_DecoderInit(&decoder);
+    decoder.synced = true;
+    Frame_DeltaInit(&delta);
+    while (frames < iterations)
+    {
+        if (Frame_DecoderPush(&decoder, pDeltaStream[i], &record))
+        {
+            Frame_DeltaDecode(&delta, &record, decoder.frameSize);
+            sink = record.seq;
+            frames++;
+        }
+
+        /* Each pass of the capture starts over, no gap on the sequence wrap */
+        if (++i == deltaStreamSize)
+        {
+            i = 0;
+            delta.started = false;
+        }
+    }
+}
+
+/**
+ * @brief DELTA capture of simulated 9-axis data, the TEXT size of the same records
+*/
+static uint32_t Bench_DeltaCapture(void)
+{
+    const IMU_Bridge_EncoderTypeDef* pDelta = IMU_Bridge_EncoderGet(IMU_BRIDGE_ENCODER_DELTA);
+    const IMU_Bridge_EncoderTypeDef* pText = IMU_Bridge_EncoderGet(IMU_BRIDGE_ENCODER_TEXT);
+    static const uint16_t pSteps[IMU_BRIDGE_FRAME_MAX_CHANNELS] = { 33, 33, 33, 3, 17, 17, 17, 9, 9, 9 };
+    int16_t pValues[IMU_BRIDGE_FRAME_MAX_CHANNELS] = { 120, -340, 16384, 2900, 15, -8, 22, 180, -45, 390 };
+    IMU_Bridge_RecordTypeDef record = { .pValues = pValues };
+    uint8_t pLine[IMU_BRIDGE_TX_LINE_SIZE];
+    uint32_t seed = 7, textSize = 0;
+
+    pDelta->Reset();
+    for (uint32_t n = 0; n < BENCH_FRAMES; n++)
+    {
+        /* Accel, temperature and gyro at each sample, the magnetometer at a tenth of the rate */
+        record.mask = IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_TEMP | IMU_BRIDGE_SENSOR_GYRO |
+                      ((n % 10U == 0) ? IMU_BRIDGE_SENSOR_MAG : 0);
+        record.seq = (uint16_t)n;
+        record.tick = 1000U * n;
+        for (uint8_t i = 0; i < IMU_BRIDGE_FRAME_MAX_CHANNELS; i++)
+        {
+            seed = seed * 1103515245U + 12345U;
+            pValues[i] += (int16_t)((seed >> 16) % pSteps[i]) - (int16_t)(pSteps[i] / 2U);
+        }
+        deltaStreamSize += pDelta->Record(&pDeltaStream[deltaStreamSize], &record);
+        textSize += pText->Record(pLine, &record);
+    }
+    return textSize;
+}
+
+int main(void)
+{
+    const IMU_Bridge_EncoderTypeDef* pEncoder;
+    int16_t pValues[IMU_BRIDGE_FRAME_MAX_CHANNELS];
+    IMU_Bridge_RecordTypeDef record = { .pValues = pValues };
+    uint32_t seed = 5, textSize;
+    double ns;
+
+    IMU_Bridge_Init();
+    pEncoder = IMU_Bridge_EncoderGet(IMU_BRIDGE_ENCODER_BINARY);
+    for (uint32_t n = 0; n < BENCH_FRAMES; n++)
+    {
+        record.mask = IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_TEMP | IMU_BRIDGE_SENSOR_GYRO |
+                      ((n % 8U == 0) ? IMU_BRIDGE_SENSOR_MAG : 0);
+        record.seq = (uint16_t)n;
+        record.tick = 1000U * n;
+        for (uint8_t i = 0; i < IMU_BRIDGE_FRAME_MAX_CHANNELS; i++)
+        {
+            seed = seed * 1103515245U + 12345U;
+            pValues[i] = (int16_t)(seed >> 16);
+        }
+        streamSize += pEncoder->Record(&pStream[streamSize], &record);
+    }
+
+    ns = Test_Bench("stream decoder, BINARY frame", Bench_Decoder, BENCH_ITERATIONS);
+    printf("%-40s %10.1f B\n", "mean frame size", (double)streamSize / BENCH_FRAMES);
+    printf("%-40s %10.1f MB/s\n", "throughput", (double)streamSize / BENCH_FRAMES / ns * 1000.0);
+
+    textSize = Bench_DeltaCapture();
+    ns = Test_Bench("delta decoder, DELTA frame", Bench_DeltaDecoder, BENCH_ITERATIONS);
+    printf("%-40s %10.1f B\n", "mean frame size", (double)deltaStreamSize / BENCH_FRAMES);
+    printf("%-40s %10.1f MB/s\n", "throughput", (double)deltaStreamSize / BENCH_FRAMES / ns * 1000.0);
+    printf("%-40s %10.2f\n", "compression vs BINARY, live", Frame_DeltaRatio(&delta));
+    printf("%-40s %10.2f\n", "compression vs TEXT", (double)textSize / deltaStreamSize);
+    return 0;
+}
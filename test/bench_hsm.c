@@ -0,0 +1,112 @@
+/**
+  ******************************************************************************
+  * @file           : bench_hsm.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : State machine engine host benchmark
+  ******************************************************************************
+  * @attention
+  *
+  * State machine engine host benchmark, dispatch cost per event on a
+  * machine shaped as the bridge one: op > mode > realtime, the realtime
+  * table 17 entries long. Empty actions, only the engine is timed.
+  *
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "hsm.h"
+
+#define BENCH_ITERATIONS    20000000U
+#define BENCH_LEAF_EVENTS   17U
+
+enum
+{
+    BENCH_EVT_LEAF_FIRST = 0,
+    BENCH_EVT_LEAF_LAST = BENCH_LEAF_EVENTS - 1U,
+    BENCH_EVT_TOP,              /*!< Internal, handled by op            */
+    BENCH_EVT_EXIT,             /*!< mode to idle                       */
+    BENCH_EVT_REALTIME,         /*!< idle to realtime                   */
+    BENCH_EVT_UNHANDLED
+};
+
+static volatile uint32_t sink;                      /*!< Kept, so the actions aren't dropped */
+
+static void Bench_Entry(void) { sink++; }
+static uint32_t Bench_Action(uint32_t event) { sink += event; return HSM_EVENT_NONE; }
+
+static const Hsm_StateTypeDef opState, idleState, modeState, realtimeState;
+
+static const Hsm_TransitionTypeDef opTransitions[] =
+{
+    { BENCH_EVT_TOP,        NULL,               Bench_Action    },
+};
+
+static const Hsm_TransitionTypeDef idleTransitions[] =
+{
+    { BENCH_EVT_REALTIME,   &realtimeState,     NULL            },
+};
+
+static const Hsm_TransitionTypeDef modeTransitions[] =
+{
+    { BENCH_EVT_EXIT,       &idleState,         Bench_Action    },
+};
+
+static const Hsm_TransitionTypeDef realtimeTransitions[BENCH_LEAF_EVENTS] =
+{
+    {  0, NULL, Bench_Action }, {  1, NULL, Bench_Action }, {  2, NULL, Bench_Action }, {  3, NULL, Bench_Action },
+    {  4, NULL, Bench_Action }, {  5, NULL, Bench_Action }, {  6, NULL, Bench_Action }, {  7, NULL, Bench_Action },
+    {  8, NULL, Bench_Action }, {  9, NULL, Bench_Action }, { 10, NULL, Bench_Action }, { 11, NULL, Bench_Action },
+    { 12, NULL, Bench_Action }, { 13, NULL, Bench_Action }, { 14, NULL, Bench_Action }, { 15, NULL, Bench_Action },
+    { 16, NULL, Bench_Action },
+};
+
+/*                                              parent      entry           exit            do              transitions                     */
+static const Hsm_StateTypeDef opState       = { NULL,       Bench_Entry,    NULL,           NULL,           HSM_TABLE(opTransitions)        };
+static const Hsm_StateTypeDef idleState     = { &opState,   Bench_Entry,    NULL,           NULL,           HSM_TABLE(idleTransitions)      };
+static const Hsm_StateTypeDef modeState     = { &opState,   NULL,           NULL,           NULL,           HSM_TABLE(modeTransitions)      };
+static const Hsm_StateTypeDef realtimeState = { &modeState, Bench_Entry,    Bench_Entry,    Bench_Action,   HSM_TABLE(realtimeTransitions)  };
+
+static Hsm_TypeDef hsm;
+
+static void Bench_LeafFirst(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++) Hsm_Dispatch(&hsm, BENCH_EVT_LEAF_FIRST);
+}
+
+static void Bench_LeafLast(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++) Hsm_Dispatch(&hsm, BENCH_EVT_LEAF_LAST);
+}
+
+static void Bench_Top(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++) Hsm_Dispatch(&hsm, BENCH_EVT_TOP);
+}
+
+static void Bench_Unhandled(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++) Hsm_Dispatch(&hsm, BENCH_EVT_UNHANDLED);
+}
+
+static void Bench_StateChange(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++) Hsm_Dispatch(&hsm, (i & 1U) ? BENCH_EVT_REALTIME : BENCH_EVT_EXIT);
+}
+
+static void Bench_Run(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++) Hsm_Run(&hsm);
+}
+
+int main(void)
+{
+    Hsm_Init(&hsm, &realtimeState);
+
+    Test_Bench("Internal, first leaf entry", Bench_LeafFirst, BENCH_ITERATIONS);
+    Test_Bench("Internal, last leaf entry", Bench_LeafLast, BENCH_ITERATIONS);
+    Test_Bench("Internal, two levels up", Bench_Top, BENCH_ITERATIONS);
+    Test_Bench("Unhandled, all levels walked", Bench_Unhandled, BENCH_ITERATIONS);
+    Test_Bench("State change, exit and entry", Bench_StateChange, BENCH_ITERATIONS);
+    Test_Bench("Do action", Bench_Run, BENCH_ITERATIONS);
+    return (hsm.pState == &realtimeState) ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+/**
+  ******************************************************************************
+  * @file           : bench_loop.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Main loop host benchmark
+  ******************************************************************************
+  * @attention
+  *
+  * Main loop host benchmark: command latency and idle share of the event
+  * loop against the superloop it replaced, a FSM pass then HAL_Delay(5).
+  * Both run the same FSM passes on a virtual timeline, commands arriving
+  * at random times, each pass taking its host time. The superloop spins
+  * in HAL_Delay, it is never idle. Host times, the target passes are
+  * slower but still far below the 5 ms of the delay.
+  *
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "main.h"
+#include "imu_bridge.h"
+#include "imu_bridge_fsm.h"
+
+#include <stdio.h>
+
+#define BENCH_COMMANDS          2000U
+#define BENCH_LOOP_DELAY_US     5000U   /*!< HAL_Delay(5) of the superloop      */
+#define BENCH_COMMAND_PERIOD_US 20000U  /*!< Mean time between commands         */
+
+static uint8_t pWire[4096];                         /*!< Bytes out of the stand-in port     */
+static uint64_t pArrival[BENCH_COMMANDS];           /*!< Command arrival times, us          */
+
+/**
+ * @brief   A command frame received, the USART1 interrupt part
+*/
+static void Bench_Receive(void)
+{
+    static const char pFrame[] = "STS\n";
+
+    Host_UartRxWrite((const uint8_t*)pFrame, sizeof(pFrame) - 1U);
+    Host_UartRxIdle();
+}
+
+/**
+ * @brief   A FSM pass and the follow up ones, the TX drained outside
+ * @retval  Host time, us
+*/
+static double Bench_Pass(void)
+{
+    uint64_t start = Test_NowNs();
+    double us;
+
+    do
+    {
+        IMU_Bridge_FsmUpdate();
+    } while (IMU_Bridge_EventPending());
+    us = (double)(Test_NowNs() - start) / 1000.0;
+    Host_UartTxDrain(pWire, sizeof(pWire));
+    return us;
+}
+
+/**
+ * @brief Print latency statistics
+*/
+static void Bench_Report(const char* pName, double sum, double max, double busy, double span)
+{
+    char pLine[64];
+
+    snprintf(pLine, sizeof(pLine), "%s, latency mean", pName);
+    printf("%-40s %10.1f us\n", pLine, sum / BENCH_COMMANDS);
+    snprintf(pLine, sizeof(pLine), "%s, latency max", pName);
+    printf("%-40s %10.1f us\n", pLine, max);
+    snprintf(pLine, sizeof(pLine), "%s, idle share", pName);
+    printf("%-40s %10.3f %%\n", pLine, 100.0 * (1.0 - busy / span));
+}
+
+int main(void)
+{
+    uint64_t t = 0, pass;
+    uint32_t seed = 3;
+    double us, sum, max;
+
+    /* FSM up, the sensor init waits on a running tick */
+    Host_TickRun = true;
+    IMU_Bridge_FsmInit();
+    Bench_Pass();
+    Host_TickRun = false;
+
+    for (uint32_t i = 0; i < BENCH_COMMANDS; i++)
+    {
+        seed = seed * 1103515245U + 12345U;
+        t += BENCH_COMMAND_PERIOD_US / 2U + (seed >> 8) % BENCH_COMMAND_PERIOD_US;
+        pArrival[i] = t;
+    }
+
+    /* Superloop: a pass every 5 ms takes the commands received meanwhile */
+    sum = max = 0;
+    pass = 0;
+    for (uint32_t i = 0; i < BENCH_COMMANDS; i++)
+    {
+        while (pass < pArrival[i]) pass += BENCH_LOOP_DELAY_US;
+        Bench_Receive();
+        IMU_Bridge_EventPost(IMU_BRIDGE_EVENT_FSM);     /* Ran on every pass */
+        us = (double)(pass - pArrival[i]) + Bench_Pass();
+        sum += us;
+        if (us > max) max = us;
+    }
+    Bench_Report("superloop", sum, max, (double)t, (double)t);
+
+    /* Event loop: the receive interrupt wakes the core for a pass */
+    sum = max = 0;
+    for (uint32_t i = 0; i < BENCH_COMMANDS; i++)
+    {
+        Bench_Receive();
+        us = Bench_Pass();
+        sum += us;
+        if (us > max) max = us;
+    }
+    Bench_Report("event loop", sum, max, sum, (double)t);
+    return 0;
+}
@@ -0,0 +1,275 @@
+/**
+  ******************************************************************************
+  * @file           : frame_decode.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Host decoder of the binary real time stream
+  ******************************************************************************
+  * @attention
+  *
+  * Host decoder of the binary real time stream. It doesn't share code with
+  * the firmware encoder, the CRC is computed bit by bit from the frame
+  * description, so a round trip checks the encoder against the format.
+  *
+  ******************************************************************************
+  */
+
+#include "frame_decode.h"
+
+#define FRAME_DECODE_CRC_POLY   0x04C11DB7U
+#define FRAME_DECODE_SEQ_END    3U      /*!< MASK and SEQ bytes, the TICK varint of a delta frame follows */
+
+/**
+ * @brief STM32 CRC-32 of the bytes, little endian words, last one zero padded
+*/
+static uint32_t Frame_Crc(const uint8_t* pData, uint32_t size)
+{
+    uint32_t crc = 0xFFFFFFFFU;
+
+    for (uint32_t i = 0; i < size; i += 4U)
+    {
+        uint32_t word = 0;
+
+        for (uint32_t j = 0; j < 4U && i + j < size; j++) word |= (uint32_t)pData[i + j] << (8U * j);
+        crc ^= word;
+        for (uint8_t bit = 0; bit < 32U; bit++) crc = (crc & 0x80000000U) ? (crc << 1) ^ FRAME_DECODE_CRC_POLY : crc << 1;
+    }
+    return crc;
+}
+
+/**
+ * @brief   COBS decode a frame
+ * @retval  Decoded size, 0 on a bad block
+*/
+static uint32_t Frame_Unstuff(const uint8_t* pFrame, uint32_t size, uint8_t* pOut)
+{
+    uint32_t in = 0, out = 0;
+
+    while (in < size)
+    {
+        uint8_t code = pFrame[in++];
+
+        if (code == 0 || in + code - 1U > size) return 0;
+        for (uint8_t i = 1; i < code; i++) pOut[out++] = pFrame[in++];
+        if (code != 0xFFU && in < size) pOut[out++] = 0;
+    }
+    return out;
+}
+
+/**
+ * @brief   Read a varint
+ * @param   maxBytes: longest varint of the field
+ * @retval  false if the varint is cut or too long
+*/
+static bool Frame_Varuint(const uint8_t** pp, const uint8_t* pEnd, uint8_t maxBytes, uint32_t* pValue)
+{
+    uint32_t value = 0;
+
+    for (uint8_t i = 0; i < maxBytes && *pp < pEnd; i++)
+    {
+        uint8_t byte = *(*pp)++;
+
+        value |= (uint32_t)(byte & 0x7FU) << (7U * i);
+        if (!(byte & 0x80U))
+        {
+            *pValue = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief   Decode a frame
+ * @param   pFrame: COBS encoded frame, without the delimiter
+ * @param   size: frame size, up to FRAME_DECODE_MAX_SIZE
+ * @param   pRecord: decoded record
+*/
+Frame_DecodeStatusTypeDef Frame_Decode(const uint8_t* pFrame, uint32_t size, Frame_RecordTypeDef* pRecord)
+{
+    uint8_t pData[FRAME_DECODE_MAX_SIZE];
+    const uint8_t* p = pData;
+    const uint8_t* pEnd;
+    uint32_t length, crc, value;
+
+    if (size > FRAME_DECODE_MAX_SIZE) return FRAME_DECODE_COBS;
+    length = Frame_Unstuff(pFrame, size, pData);
+    if (length < FRAME_DECODE_SEQ_END + IMU_BRIDGE_FRAME_CRC_SIZE) return FRAME_DECODE_COBS;
+
+    length -= IMU_BRIDGE_FRAME_CRC_SIZE;
+    crc = (uint32_t)pData[length] | (uint32_t)pData[length + 1U] << 8 | (uint32_t)pData[length + 2U] << 16 |
+          (uint32_t)pData[length + 3U] << 24;
+    if (crc != Frame_Crc(pData, length)) return FRAME_DECODE_CRC;
+
+    pEnd = pData + length;
+    pRecord->mask = p[0];
+    pRecord->seq = (uint16_t)(p[1] | p[2] << 8);
+    pRecord->channels = IMU_Bridge_FrameChannels(pRecord->mask & IMU_BRIDGE_FRAME_SENSORS);
+    p += FRAME_DECODE_SEQ_END;
+
+    if (pRecord->mask & ~(IMU_BRIDGE_FRAME_SENSORS | IMU_BRIDGE_FRAME_VARINT | IMU_BRIDGE_FRAME_DELTA)) return FRAME_DECODE_FORMAT;
+    if (pRecord->mask & IMU_BRIDGE_FRAME_DELTA)
+    {
+        /* TICK is the varint of the timestamp difference, the channels are differences too */
+        if (!(pRecord->mask & IMU_BRIDGE_FRAME_VARINT) ||
+            !Frame_Varuint(&p, pEnd, IMU_BRIDGE_FRAME_DELTA_HEADER_SIZE - FRAME_DECODE_SEQ_END, &pRecord->tick))
+        {
+            return FRAME_DECODE_FORMAT;
+        }
+    }
+    else
+    {
+        if (length < IMU_BRIDGE_FRAME_HEADER_SIZE) return FRAME_DECODE_FORMAT;
+        pRecord->tick = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+        p += IMU_BRIDGE_FRAME_HEADER_SIZE - FRAME_DECODE_SEQ_END;
+    }
+
+    if (!(pRecord->mask & IMU_BRIDGE_FRAME_VARINT))
+    {
+        if (length != IMU_BRIDGE_FRAME_HEADER_SIZE + 2U * pRecord->channels) return FRAME_DECODE_FORMAT;
+        for (uint8_t i = 0; i < pRecord->channels; i++, p += 2) pRecord->pValues[i] = (int16_t)(uint16_t)(p[0] | p[1] << 8);
+        return FRAME_DECODE_OK;
+    }
+
+    /* Zigzag varints, v = (u >> 1) ^ -(u & 1) */
+    for (uint8_t i = 0; i < pRecord->channels; i++)
+    {
+        if (!Frame_Varuint(&p, pEnd, IMU_BRIDGE_FRAME_VARINT_SIZE, &value) || value > 0xFFFFU) return FRAME_DECODE_FORMAT;
+        pRecord->pValues[i] = (int16_t)(uint16_t)((value >> 1) ^ (0U - (value & 1U)));
+    }
+    return (p == pEnd) ? FRAME_DECODE_OK : FRAME_DECODE_FORMAT;
+}
+
+/**
+ * @brief Init a stream decoder, the first bytes up to a delimiter are dropped
+*/
+void Frame_DecoderInit(Frame_DecoderTypeDef* pDecoder)
+{
+    pDecoder->size = 0;
+    pDecoder->overrun = false;
+    pDecoder->synced = false;
+    pDecoder->frameSize = 0;
+    pDecoder->frames = 0;
+    pDecoder->errors = 0;
+}
+
+/**
+ * @brief   Push a byte of the stream
+ * @param   pRecord: decoded record, when a frame ends
+ * @retval  true if a frame ended and was decoded
+*/
+bool Frame_DecoderPush(Frame_DecoderTypeDef* pDecoder, uint8_t byte, Frame_RecordTypeDef* pRecord)
+{
+    bool decoded = false;
+
+    if (byte != IMU_BRIDGE_FRAME_DELIMITER)
+    {
+        if (pDecoder->size < FRAME_DECODE_MAX_SIZE) pDecoder->pFrame[pDecoder->size++] = byte;
+        else pDecoder->overrun = true;
+        return false;
+    }
+
+    /* Bytes before the first delimiter are a frame joined midway, not an error */
+    if (pDecoder->synced && pDecoder->size != 0)
+    {
+        decoded = !pDecoder->overrun && Frame_Decode(pDecoder->pFrame, pDecoder->size, pRecord) == FRAME_DECODE_OK;
+        if (decoded)
+        {
+            pDecoder->frameSize = pDecoder->size + 1U;
+            pDecoder->frames++;
+        }
+        else
+        {
+            pDecoder->errors++;
+        }
+    }
+    pDecoder->size = 0;
+    pDecoder->overrun = false;
+    pDecoder->synced = true;
+    return decoded;
+}
+
+/**
+ * @brief Init a delta decoder, without references
+*/
+void Frame_DeltaInit(Frame_DeltaDecoderTypeDef* pDelta)
+{
+    pDelta->refMask = 0;
+    pDelta->tickRef = false;
+    pDelta->started = false;
+    pDelta->gaps = 0;
+    pDelta->skipped = 0;
+    pDelta->wireBytes = 0;
+    pDelta->binaryBytes = 0;
+}
+
+/**
+ * @brief   Apply the references to a decoded frame of the stream
+ * @note    References are dropped on a SEQ gap, a frame rejected by
+ *          Frame_Decode shows as a gap on the next one.
+ * @param   pRecord: frame from Frame_Decode, turned into the absolute
+ *          values of the sensors with a reference, the others skipped
+ * @param   size: frame size on the wire, delimiter included
+ * @retval  true if a sensor was decoded
+*/
+bool Frame_DeltaDecode(Frame_DeltaDecoderTypeDef* pDelta, Frame_RecordTypeDef* pRecord, uint32_t size)
+{
+    uint8_t sensors = pRecord->mask & IMU_BRIDGE_FRAME_SENSORS;
+    bool delta = (pRecord->mask & IMU_BRIDGE_FRAME_DELTA) != 0;
+    uint8_t decoded = 0, in = 0, out = 0;
+
+    if (pDelta->started && pRecord->seq != (uint16_t)(pDelta->seq + 1U))
+    {
+        pDelta->refMask = 0;
+        pDelta->tickRef = false;
+        pDelta->gaps++;
+    }
+    pDelta->started = true;
+    pDelta->seq = pRecord->seq;
+    pDelta->wireBytes += size;
+    pDelta->binaryBytes += IMU_BRIDGE_FRAME_COBS_SIZE(IMU_BRIDGE_FRAME_RAW_SIZE(pRecord->channels));
+
+    /* Without a timestamp reference there are no channel references either */
+    if (!delta)
+    {
+        pDelta->tick = pRecord->tick;
+        pDelta->tickRef = true;
+    }
+    else if (pDelta->tickRef)
+    {
+        pDelta->tick += pRecord->tick;
+        pRecord->tick = pDelta->tick;
+    }
+
+    for (uint8_t bit = IMU_BRIDGE_SENSOR_ACCEL; bit <= IMU_BRIDGE_SENSOR_MAG; bit <<= 1)
+    {
+        uint8_t channels = IMU_Bridge_FrameChannels(bit);
+        int16_t* pRef = &pDelta->pRef[IMU_Bridge_FrameChannels(bit - 1U)];
+
+        if (!(sensors & bit)) continue;
+        if (!delta) pDelta->refMask |= bit;
+        if (!(pDelta->refMask & bit))
+        {
+            in += channels;
+            pDelta->skipped++;
+            continue;
+        }
+
+        for (uint8_t i = 0; i < channels; i++, in++)
+        {
+            pRef[i] = delta ? (int16_t)(uint16_t)((uint16_t)pRef[i] + (uint16_t)pRecord->pValues[in]) : pRecord->pValues[in];
+            pRecord->pValues[out++] = pRef[i];
+        }
+        decoded |= bit;
+    }
+    pRecord->mask = decoded;
+    pRecord->channels = out;
+    return decoded != 0;
+}
+
+/**
+ * @brief Compression ratio so far, bytes of the same records as BINARY frames over the bytes received
+*/
+double Frame_DeltaRatio(const Frame_DeltaDecoderTypeDef* pDelta)
+{
+    return (pDelta->wireBytes != 0) ? (double)pDelta->binaryBytes / (double)pDelta->wireBytes : 0.0;
+}
@@ -0,0 +1,107 @@
+/**
+  ******************************************************************************
+  * @file           : frame_decode.h
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Host decoder of the binary real time stream header
+  ******************************************************************************
+  * @attention
+  *
+  * Host decoder of the binary real time stream, the frame format of
+  * imu_bridge_frame.h written from its description: COBS decoding, CRC
+  * check in software and parsing of the int16, VARINT and DELTA payloads.
+  * The stream decoder takes the bytes as they come and resyncs on the next
+  * delimiter after a damaged frame. The delta decoder keeps the references
+  * of the DELTA stream and its compression ratio.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FRAME_DECODE_H
+#define __FRAME_DECODE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "imu_bridge_frame.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define FRAME_DECODE_MAX_SIZE   64U     /*!< Max frame bytes, COBS encoded, without delimiter */
+
+/* Exported types ------------------------------------------------------------*/
+/**
+ * @brief Frame decoding result
+*/
+typedef enum
+{
+    FRAME_DECODE_OK,
+    FRAME_DECODE_COBS,          /*!< Bad COBS block or frame too long   */
+    FRAME_DECODE_CRC,           /*!< CRC mismatch                       */
+    FRAME_DECODE_FORMAT         /*!< Payload doesn't match the mask     */
+
+} Frame_DecodeStatusTypeDef;
+
+/**
+ * @brief Decoded real time record
+*/
+typedef struct
+{
+    uint8_t mask;                                   /*!< MASK byte, flags included  */
+    uint16_t seq;                                   /*!< Sequence number            */
+    uint32_t tick;                                  /*!< Sample timestamp           */
+    uint8_t channels;                               /*!< Channels in pValues        */
+    int16_t pValues[IMU_BRIDGE_FRAME_MAX_CHANNELS]; /*!< Channel values             */
+
+} Frame_RecordTypeDef;
+
+/**
+ * @brief Stream decoder
+*/
+typedef struct
+{
+    uint8_t pFrame[FRAME_DECODE_MAX_SIZE];  /*!< Frame being received           */
+    uint32_t size;                          /*!< Bytes of the frame so far      */
+    bool overrun;                           /*!< Frame too long, dropped        */
+    bool synced;                            /*!< A delimiter was seen           */
+    uint32_t frameSize;                     /*!< Bytes of the last frame        */
+    uint32_t frames;                        /*!< Frames decoded                 */
+    uint32_t errors;                        /*!< Frames dropped                 */
+
+} Frame_DecoderTypeDef;
+
+/**
+ * @brief Delta decoder, references of the DELTA stream
+*/
+typedef struct
+{
+    int16_t pRef[IMU_BRIDGE_FRAME_MAX_CHANNELS];    /*!< Last value of each channel, all sensors    */
+    uint32_t tick;                                  /*!< Last timestamp                             */
+    uint8_t refMask;                                /*!< Sensors with a reference                   */
+    bool tickRef;                                   /*!< Timestamp reference valid                  */
+    bool started;                                   /*!< A frame was seen, seq valid                */
+    uint16_t seq;                                   /*!< Last sequence number                       */
+    uint32_t gaps;                                  /*!< SEQ gaps, references dropped               */
+    uint32_t skipped;                               /*!< Sensors skipped, without reference         */
+    uint64_t wireBytes;                             /*!< Frame bytes received                       */
+    uint64_t binaryBytes;                           /*!< Same records as BINARY frames              */
+
+} Frame_DeltaDecoderTypeDef;
+
+/* Exported functions --------------------------------------------------------*/
+Frame_DecodeStatusTypeDef Frame_Decode(const uint8_t* pFrame, uint32_t size, Frame_RecordTypeDef* pRecord);
+void Frame_DecoderInit(Frame_DecoderTypeDef* pDecoder);
+bool Frame_DecoderPush(Frame_DecoderTypeDef* pDecoder, uint8_t byte, Frame_RecordTypeDef* pRecord);
+void Frame_DeltaInit(Frame_DeltaDecoderTypeDef* pDelta);
+bool Frame_DeltaDecode(Frame_DeltaDecoderTypeDef* pDelta, Frame_RecordTypeDef* pRecord, uint32_t size);
+double Frame_DeltaRatio(const Frame_DeltaDecoderTypeDef* pDelta);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FRAME_DECODE_H */
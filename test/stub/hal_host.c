@@ -0,0 +1,296 @@
+/**
+  ******************************************************************************
+  * @file           : hal_host.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Host stand-in for the STM32 HAL
+  ******************************************************************************
+  * @attention
+  *
+  * Host stand-in for the STM32 HAL, the functions the ports call. Interrupt
+  * handlers run as on the target: one at a time, not while masked, and the
+  * ones pended meanwhile run on the way out.
+  * The stand-in peripherals connect their handlers on init, as the vector
+  * table would. The USART1 handler is the one of stm32f1xx_it.c, and the HAL
+  * handler part the ports rely on, the IDLE event of the circular DMA
+  * reception, is modelled after stm32f1xx_hal_uart.c.
+  *
+  ******************************************************************************
+  */
+
+#include "main.h"
+#include "port_uart.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+RCC_TypeDef Host_RCC;
+USART_TypeDef Host_USART1;
+DMA_Channel_TypeDef Host_DMA1_Channel4;
+DMA_Channel_TypeDef Host_DMA1_Channel5;
+DWT_Type Host_DWT;
+CoreDebug_Type Host_CoreDebug;
+volatile uint32_t Host_Tick = 0;
+volatile bool Host_TickRun = false;
+void (*Host_TickHook)(void) = NULL;                 /*!< Called on each running tick        */
+uint32_t SystemCoreClock = 72000000U;
+
+extern UART_HandleTypeDef huart1;
+
+static uint32_t hostPrimask = 0;                    /*!< Interrupts masked                  */
+static uint32_t hostIrqLevel = 0;                   /*!< Interrupt handler running          */
+static uint64_t hostIrqPending = 0;                 /*!< Pended interrupts, by IRQn bit     */
+static Host_IrqHandlerTypeDef pHostIrqHandlers[HOST_IRQ_COUNT];    /*!< Handlers, by IRQn  */
+static uint8_t* pHostTxData;                        /*!< USART1 TX DMA transfer in flight   */
+static uint16_t hostTxSize;                         /*!< Bytes in flight                    */
+
+static void Host_IrqDispatch(void);
+
+/**
+ * @brief USART1 interrupt handler, as in stm32f1xx_it.c
+*/
+static void Host_Usart1IRQHandler(void)
+{
+    UART_RxIRQHandler();
+    HAL_UART_IRQHandler(&huart1);
+    UART_TxIRQHandler();
+}
+
+/**
+ * @brief Run the pended interrupts, unless masked or in a handler already
+*/
+static void Host_IrqDispatch(void)
+{
+    while (hostIrqPending != 0 && hostPrimask == 0 && hostIrqLevel == 0)
+    {
+        IRQn_Type irq = (IRQn_Type)__builtin_ctzll(hostIrqPending);
+
+        hostIrqPending &= ~(1ULL << irq);
+        if (pHostIrqHandlers[irq] == NULL) continue;
+        Host_IrqEnter();
+        pHostIrqHandlers[irq]();
+        hostIrqLevel--;
+    }
+}
+
+/**
+ * @brief Connect a stand-in peripheral interrupt handler, the vector table entry
+*/
+void Host_IrqConnect(IRQn_Type irq, Host_IrqHandlerTypeDef handler)
+{
+    assert(irq >= 0 && irq < HOST_IRQ_COUNT);
+    pHostIrqHandlers[irq] = handler;
+}
+
+/**
+ * @brief Enter an interrupt handler run by a stand-in peripheral, the ones
+ *        pended meanwhile wait for the exit
+*/
+void Host_IrqEnter(void)
+{
+    hostIrqLevel++;
+}
+
+/**
+ * @brief Leave an interrupt handler, run the ones pended meanwhile
+*/
+void Host_IrqExit(void)
+{
+    hostIrqLevel--;
+    Host_IrqDispatch();
+}
+
+uint32_t Host_GetPrimask(void)
+{
+    return hostPrimask;
+}
+
+void Host_SetPrimask(uint32_t primask)
+{
+    hostPrimask = primask;
+    Host_IrqDispatch();
+}
+
+void Host_Wfi(void)
+{
+}
+
+/**
+ * @brief Bytes received by the USART1 circular RX DMA
+ * @note The buffer wrap raises the transfer complete event
+*/
+void Host_UartRxWrite(const uint8_t* pData, uint16_t size)
+{
+    DMA_Channel_TypeDef* pChannel = huart1.hdmarx->Instance;
+
+    Host_IrqEnter();
+    for (uint16_t i = 0; i < size; i++)
+    {
+        huart1.pRxBuffPtr[huart1.RxXferSize - pChannel->CNDTR] = pData[i];
+        if (--pChannel->CNDTR == 0)
+        {
+            pChannel->CNDTR = huart1.RxXferSize;
+            HAL_UARTEx_RxEventCallback(&huart1, huart1.RxXferSize);
+        }
+    }
+    Host_IrqExit();
+}
+
+/**
+ * @brief USART1 RX line idle
+*/
+void Host_UartRxIdle(void)
+{
+    Host_USART1.SR |= USART_SR_IDLE;
+    HAL_NVIC_SetPendingIRQ(USART1_IRQn);
+}
+
+/**
+ * @brief Complete the USART1 TX DMA transfer in flight
+ * @param pData: bytes sent, up to size
+ * @retval Bytes of the transfer, 0 if none in flight
+*/
+uint16_t Host_UartTxComplete(uint8_t* pData, uint32_t size)
+{
+    uint16_t sent = hostTxSize;
+
+    if (sent == 0) return 0;
+    memcpy(pData, pHostTxData, (sent < size) ? sent : size);
+    hostTxSize = 0;
+    huart1.gState = HAL_UART_STATE_READY;
+
+    Host_IrqEnter();
+    HAL_UART_TxCpltCallback(&huart1);
+    Host_IrqExit();
+    return sent;
+}
+
+/**
+ * @brief Complete the USART1 TX DMA transfers until the port stops sending
+ * @param pData: bytes sent, up to size
+ * @retval Bytes sent, may be more than size
+*/
+uint32_t Host_UartTxDrain(uint8_t* pData, uint32_t size)
+{
+    uint32_t total = 0;
+    uint16_t sent;
+
+    do
+    {
+        sent = Host_UartTxComplete(&pData[(total < size) ? total : size], (total < size) ? size - total : 0);
+        total += sent;
+    } while (sent != 0);
+    return total;
+}
+
+/* HAL ------------------------------------------------------------------------*/
+/**
+ * @brief Tick, frozen unless Host_TickRun: then each call is a millisecond
+ *        later, so the busy waits of the sensor init come to an end, and
+ *        Host_TickHook runs in them
+*/
+uint32_t HAL_GetTick(void)
+{
+    if (Host_TickRun)
+    {
+        Host_Tick++;
+        if (Host_TickHook != NULL) Host_TickHook();
+    }
+    return Host_Tick;
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+}
+
+void HAL_NVIC_SetPendingIRQ(IRQn_Type IRQn)
+{
+    hostIrqPending |= 1ULL << IRQn;
+    Host_IrqDispatch();
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef* GPIOx, GPIO_InitTypeDef* GPIO_Init)
+{
+}
+
+void HAL_GPIO_DeInit(GPIO_TypeDef* GPIOx, uint32_t GPIO_Pin)
+{
+}
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef* hdma)
+{
+    hdma->State = HAL_DMA_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef* hdma)
+{
+    hdma->State = HAL_DMA_STATE_RESET;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef* huart)
+{
+    HAL_UART_MspInit(huart);
+    if (huart->Instance == USART1) Host_IrqConnect(USART1_IRQn, Host_Usart1IRQHandler);
+    huart->gState = HAL_UART_STATE_READY;
+    huart->RxState = HAL_UART_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef* huart, uint8_t* pData, uint16_t Size)
+{
+    if (huart->RxState != HAL_UART_STATE_READY) return HAL_BUSY;
+
+    huart->pRxBuffPtr = pData;
+    huart->RxXferSize = Size;
+    huart->RxState = HAL_UART_STATE_BUSY_RX;
+    huart->ReceptionType = HAL_UART_RECEPTION_TOIDLE;
+    huart->hdmarx->Instance->CNDTR = Size;
+    huart->hdmarx->Instance->CCR |= DMA_IT_TC | DMA_IT_HT;
+    huart->Instance->CR1 |= USART_CR1_IDLEIE;
+    huart->Instance->CR3 |= USART_CR3_DMAR;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef* huart, uint8_t* pData, uint16_t Size)
+{
+    if (huart->gState != HAL_UART_STATE_READY) return HAL_BUSY;
+    if (pData == NULL || Size == 0) return HAL_ERROR;
+
+    huart->gState = HAL_UART_STATE_BUSY_TX;
+    pHostTxData = pData;
+    hostTxSize = Size;
+    return HAL_OK;
+}
+
+/**
+ * @brief USART1 HAL handler, the IDLE event of the DMA reception only
+*/
+void HAL_UART_IRQHandler(UART_HandleTypeDef* huart)
+{
+    uint16_t remaining;
+
+    if (huart->ReceptionType != HAL_UART_RECEPTION_TOIDLE) return;
+    if ((huart->Instance->SR & USART_SR_IDLE) == 0 || (huart->Instance->CR1 & USART_CR1_IDLEIE) == 0) return;
+
+    huart->Instance->SR &= ~USART_SR_IDLE;
+    remaining = (uint16_t)huart->hdmarx->Instance->CNDTR;
+    if (remaining > 0 && remaining < huart->RxXferSize)
+    {
+        HAL_UARTEx_RxEventCallback(huart, huart->RxXferSize - remaining);
+    }
+}
+
+void Error_Handler(void)
+{
+    abort();
+}
@@ -0,0 +1,71 @@
+/**
+  ******************************************************************************
+  * @file           : hal_host.h
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Host stand-in for the STM32 HAL header
+  ******************************************************************************
+  * @attention
+  *
+  * Host stand-in for the STM32 HAL, the peripherals the ports use. Register
+  * blocks live in RAM, the interrupt mask is a flag and pended interrupts run
+  * right away, or when unmasked. The UART DMA is driven by the tests: bytes
+  * are received as the circular DMA would, and transfers are completed on
+  * demand. The TIM2 counter runs on demand too.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HAL_HOST_H
+#define __HAL_HOST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define HOST_IRQ_COUNT          64      /*!< Interrupts of the pending bitmap   */
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*Host_IrqHandlerTypeDef)(void);
+
+/* Exported variables --------------------------------------------------------*/
+extern RCC_TypeDef Host_RCC;
+extern USART_TypeDef Host_USART1;
+extern DMA_Channel_TypeDef Host_DMA1_Channel4;
+extern DMA_Channel_TypeDef Host_DMA1_Channel5;
+extern DWT_Type Host_DWT;
+extern CoreDebug_Type Host_CoreDebug;
+extern TIM_TypeDef Host_TIM2;
+extern volatile uint32_t Host_Tick;
+extern volatile bool Host_TickRun;
+extern void (*Host_TickHook)(void);
+extern uint64_t Host_TimerUs;
+
+/* Exported functions --------------------------------------------------------*/
+/* Cortex-M core */
+uint32_t Host_GetPrimask(void);
+void Host_SetPrimask(uint32_t primask);
+void Host_Wfi(void);
+void Host_IrqConnect(IRQn_Type irq, Host_IrqHandlerTypeDef handler);
+void Host_IrqEnter(void);
+void Host_IrqExit(void);
+
+/* USART1 and its DMA channels */
+void Host_UartRxWrite(const uint8_t* pData, uint16_t size);
+void Host_UartRxIdle(void);
+uint16_t Host_UartTxComplete(uint8_t* pData, uint32_t size);
+uint32_t Host_UartTxDrain(uint8_t* pData, uint32_t size);
+
+/* TIM2, tim_host.c */
+void Host_TimerRun(uint32_t us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HAL_HOST_H */
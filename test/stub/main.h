@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file           : main.h
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Host stand-in for the firmware main header
+  ******************************************************************************
+  * @attention
+  *
+  * Host stand-in for the firmware main header, found first on the host
+  * include path. The real header and the HAL types come in unchanged, then
+  * the peripherals the ports touch are moved to RAM register blocks and the
+  * Cortex-M intrinsics to host functions, so the ports build and run on the
+  * host against the HAL stand-in of hal_host.c.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HOST_MAIN_H
+#define __HOST_MAIN_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "../../Core/Inc/main.h"
+
+#include "hal_host.h"
+
+/* Peripherals, RAM register blocks -------------------------------------------*/
+#undef RCC
+#define RCC                     (&Host_RCC)
+#undef USART1
+#define USART1                  (&Host_USART1)
+#undef DMA1_Channel4
+#define DMA1_Channel4           (&Host_DMA1_Channel4)
+#undef DMA1_Channel5
+#define DMA1_Channel5           (&Host_DMA1_Channel5)
+#undef TIM2
+#define TIM2                    (&Host_TIM2)
+#undef DWT
+#define DWT                     (&Host_DWT)
+#undef CoreDebug
+#define CoreDebug               (&Host_CoreDebug)
+
+/* Cortex-M intrinsics, the interrupt mask is a flag --------------------------*/
+#undef __WFI
+#define __WFI()                 Host_Wfi()
+#define __disable_irq()         Host_SetPrimask(1U)
+#define __enable_irq()          Host_SetPrimask(0U)
+#define __get_PRIMASK()         Host_GetPrimask()
+#define __set_PRIMASK(primask)  Host_SetPrimask(primask)
+
+#endif /* __HOST_MAIN_H */
@@ -0,0 +1,46 @@
+/**
+  ******************************************************************************
+  * @file           : port_crc_host.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Host stand-in for the IMU Bridge CRC port
+  ******************************************************************************
+  * @attention
+  *
+  * Host stand-in for the IMU Bridge CRC port, in place of port_crc.c. The
+  * CRC unit is computed in software, same result: CRC-32 polynomial
+  * 0x04C11DB7, 0xFFFFFFFF initial value, words fed MSB first, no reflection
+  * and no final XOR.
+  *
+  ******************************************************************************
+  */
+
+#include "port_crc.h"
+
+#define HOST_CRC_POLY           0x04C11DB7U
+
+static uint32_t hostCrc;                            /*!< CRC unit data register             */
+
+IMU_Bridge_StatusTypeDef CRC32_Init(void)
+{
+    CRC32_Reset();
+    return IMU_BRIDGE_OK;
+}
+
+void CRC32_Reset(void)
+{
+    hostCrc = 0xFFFFFFFFU;
+}
+
+void CRC32_Feed(uint32_t word)
+{
+    hostCrc ^= word;
+    for (uint8_t i = 0; i < 32U; i++)
+    {
+        hostCrc = (hostCrc & 0x80000000U) ? (hostCrc << 1) ^ HOST_CRC_POLY : hostCrc << 1;
+    }
+}
+
+uint32_t CRC32_Get(void)
+{
+    return hostCrc;
+}
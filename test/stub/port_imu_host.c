@@ -0,0 +1,367 @@
+/**
+  ******************************************************************************
+  * @file           : port_imu_host.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Host stand-in for the IMU Bridge sensor bus port
+  ******************************************************************************
+  * @attention
+  *
+  * Host stand-in for the IMU Bridge sensor bus port, in place of
+  * port_imu_i2c.c or port_imu_spi.c, over a register model of the MPU9250.
+  * The model covers what the bridge uses: the auto incremented register
+  * range, the device reset, the FIFO with its count and stop on full mode,
+  * the data ready interrupt and the I2C master SLV0 transfers to an AK8963.
+  * A bus job completes in the bus interrupt, right after the start or, when
+  * the bus is held, on the release. The data ready pulse is the EXTI0
+  * interrupt of the MPU9250 INT pin.
+  *
+  ******************************************************************************
+  */
+
+#include "port_imu_host.h"
+#include "imu_bridge_sensor.h"
+#include "main.h"
+#include "port_imu.h"
+
+#include <string.h>
+
+#define HOST_IMU_REG_COUNT      128U
+#define HOST_IMU_REG_SLV0_REG   0x26U
+#define HOST_IMU_REG_SLV0_CTRL  0x27U
+#define HOST_IMU_REG_DATA_LAST  0x60U   /*!< Data registers are read only up to EXT_SENS_DATA_23 */
+#define HOST_IMU_SLV_LEN_MASK   0x0FU
+#define HOST_IMU_PWR_MGMT_1     0x01U   /*!< PWR_MGMT_1 reset value             */
+#define HOST_IMU_FIFO_EN_GYRO_X 0x40U
+#define HOST_MAG_REG_COUNT      0x10U
+#define HOST_MAG_REG_ST2        0x09U
+#define HOST_MAG_CNTL1_MODE     0x0FU
+#define HOST_MAG_CNTL1_BIT      0x10U   /*!< 16 bit output                      */
+#define HOST_MAG_ST2_BITM       0x10U
+#define HOST_MAG_ST2_HOFL       0x08U
+
+static uint8_t pHostRegs[HOST_IMU_REG_COUNT];       /*!< MPU9250 registers                  */
+static uint8_t pHostMagRegs[HOST_MAG_REG_COUNT];    /*!< AK8963 registers                   */
+static int16_t pHostMag[3];                         /*!< AK8963 field, raw                  */
+static bool hostMagOverflow = false;                /*!< AK8963 measurements overflow       */
+static uint8_t pHostFifo[IMU_FIFO_SIZE];            /*!< FIFO, circular                     */
+static uint16_t hostFifoHead;                       /*!< Oldest FIFO byte                   */
+static uint16_t hostFifoCount;                      /*!< FIFO bytes                         */
+static IMU_Port_JobTypeDef hostJob;                 /*!< Bus job in flight                  */
+static bool hostJobActive = false;                  /*!< Bus job not completed yet          */
+static bool hostBusHold = false;                    /*!< Jobs wait for the release          */
+static uint32_t hostBusJobs = 0;                    /*!< Bus jobs started                   */
+static uint8_t hostWatchFirst = 0;                  /*!< Registers watched for writes       */
+static uint8_t hostWatchLast = 0;
+static uint32_t hostWatchJobs = 0;                  /*!< Write jobs on the watched ones     */
+
+/**
+ * @brief Power on state of the AK8963
+*/
+static void Host_MagReset(void)
+{
+    memset(pHostMagRegs, 0, sizeof(pHostMagRegs));
+    pHostMagRegs[IMU_MAG_REG_WIA] = IMU_MAG_WIA;
+}
+
+/**
+ * @brief AK8963 register write, through SLV0
+*/
+static void Host_MagWrite(uint8_t reg, uint8_t value)
+{
+    if (reg == IMU_MAG_REG_CNTL2 && (value & IMU_MAG_CNTL2_SRST)) Host_MagReset();
+    else if (reg < HOST_MAG_REG_COUNT) pHostMagRegs[reg] = value;
+}
+
+/**
+ * @brief Latch the field into the AK8963 data registers, in continuous mode
+*/
+static void Host_MagMeasure(void)
+{
+    uint8_t* pData = &pHostMagRegs[IMU_MAG_REG_HXL];
+
+    if ((pHostMagRegs[IMU_MAG_REG_CNTL1] & HOST_MAG_CNTL1_MODE) == 0) return;
+    for (uint8_t i = 0; i < 3U; i++)
+    {
+        pData[2U * i] = (uint8_t)pHostMag[i];
+        pData[2U * i + 1U] = (uint8_t)((uint16_t)pHostMag[i] >> 8);
+    }
+    pHostMagRegs[HOST_MAG_REG_ST2] = (pHostMagRegs[IMU_MAG_REG_CNTL1] & HOST_MAG_CNTL1_BIT) ? HOST_MAG_ST2_BITM : 0U;
+    if (hostMagOverflow) pHostMagRegs[HOST_MAG_REG_ST2] |= HOST_MAG_ST2_HOFL;
+}
+
+/**
+ * @brief   I2C master SLV0 transfer to the AK8963
+ * @param   config: slave set up just now, writes are run once
+*/
+static void Host_ImuSlaveRun(bool config)
+{
+    uint8_t addr = pHostRegs[IMU_REG_I2C_SLV0_ADDR];
+    uint8_t reg = pHostRegs[HOST_IMU_REG_SLV0_REG];
+    uint8_t ctrl = pHostRegs[HOST_IMU_REG_SLV0_CTRL];
+
+    if ((pHostRegs[IMU_REG_USER_CTRL] & IMU_USER_CTRL_I2C_MST_EN) == 0 || (ctrl & IMU_I2C_SLV_EN) == 0) return;
+    if ((addr & ~IMU_I2C_SLV_READ) != IMU_MAG_ADDRESS) return;
+
+    if ((addr & IMU_I2C_SLV_READ) == 0)
+    {
+        if (config) Host_MagWrite(reg, pHostRegs[IMU_REG_I2C_SLV0_DO]);
+        return;
+    }
+    for (uint8_t i = 0; i < (ctrl & HOST_IMU_SLV_LEN_MASK); i++)
+    {
+        pHostRegs[IMU_REG_EXT_SENS_DATA + i] = (reg + i < HOST_MAG_REG_COUNT) ? pHostMagRegs[reg + i] : 0U;
+    }
+}
+
+/**
+ * @brief Append data registers to the FIFO, stop on full or drop the oldest
+*/
+static void Host_ImuFifoWrite(uint8_t reg, uint8_t size)
+{
+    for (uint8_t i = 0; i < size; i++)
+    {
+        if (hostFifoCount == IMU_FIFO_SIZE)
+        {
+            hostFifoHead = (hostFifoHead + 1U) % IMU_FIFO_SIZE;
+            hostFifoCount--;
+        }
+        pHostFifo[(hostFifoHead + hostFifoCount) % IMU_FIFO_SIZE] = pHostRegs[reg + i];
+        hostFifoCount++;
+    }
+}
+
+/**
+ * @brief Store a sample in the FIFO, the enabled sensors in register order
+*/
+static void Host_ImuFifoSample(void)
+{
+    uint8_t enable = pHostRegs[IMU_REG_FIFO_EN];
+    uint16_t size = 0;
+
+    if ((pHostRegs[IMU_REG_USER_CTRL] & IMU_USER_CTRL_FIFO_EN) == 0) return;
+
+    if (enable & IMU_FIFO_EN_ACCEL) size += 6U;
+    if (enable & IMU_FIFO_EN_TEMP) size += 2U;
+    for (uint8_t i = 0; i < 3U; i++) if (enable & (HOST_IMU_FIFO_EN_GYRO_X >> i)) size += 2U;
+    if ((pHostRegs[IMU_REG_CONFIG] & IMU_CONFIG_FIFO_MODE) && hostFifoCount + size > IMU_FIFO_SIZE) return;
+
+    if (enable & IMU_FIFO_EN_ACCEL) Host_ImuFifoWrite(IMU_REG_ACCEL_XOUT_H, 6U);
+    if (enable & IMU_FIFO_EN_TEMP) Host_ImuFifoWrite(IMU_REG_TEMP_OUT_H, 2U);
+    for (uint8_t i = 0; i < 3U; i++)
+    {
+        if (enable & (HOST_IMU_FIFO_EN_GYRO_X >> i)) Host_ImuFifoWrite(IMU_REG_GYRO_XOUT_H + 2U * i, 2U);
+    }
+}
+
+/**
+ * @brief Register read, the FIFO ones pop the data
+*/
+static uint8_t Host_ImuRegRead(uint8_t reg)
+{
+    uint8_t value;
+
+    switch (reg)
+    {
+        case IMU_REG_FIFO_COUNTH:
+            return (uint8_t)(hostFifoCount >> 8);
+
+        case IMU_REG_FIFO_COUNTH + 1U:
+            return (uint8_t)hostFifoCount;
+
+        case IMU_REG_FIFO_R_W:
+            if (hostFifoCount == 0) return 0xFFU;
+            value = pHostFifo[hostFifoHead];
+            hostFifoHead = (hostFifoHead + 1U) % IMU_FIFO_SIZE;
+            hostFifoCount--;
+            return value;
+
+        default:
+            return pHostRegs[reg & (HOST_IMU_REG_COUNT - 1U)];
+    }
+}
+
+/**
+ * @brief Register write, the read only ones are left unchanged
+*/
+static void Host_ImuRegWrite(uint8_t reg, uint8_t value)
+{
+    switch (reg)
+    {
+        case IMU_REG_PWR_MGMT_1:
+            if (value & IMU_PWR_MGMT_1_H_RESET) Host_ImuReset();
+            else pHostRegs[reg] = value;
+            break;
+
+        case IMU_REG_USER_CTRL:
+            if (value & IMU_USER_CTRL_FIFO_RST) hostFifoCount = 0;
+            pHostRegs[reg] = value & ~IMU_USER_CTRL_FIFO_RST;
+            break;
+
+        case IMU_REG_FIFO_COUNTH:
+        case IMU_REG_FIFO_COUNTH + 1U:
+        case IMU_REG_FIFO_R_W:
+        case IMU_REG_WHO_AM_I:
+            break;
+
+        default:
+            if (reg >= IMU_REG_ACCEL_XOUT_H && reg <= HOST_IMU_REG_DATA_LAST) break;
+            pHostRegs[reg & (HOST_IMU_REG_COUNT - 1U)] = value;
+            break;
+    }
+    if (reg == HOST_IMU_REG_SLV0_CTRL) Host_ImuSlaveRun(true);
+}
+
+/**
+ * @brief Bus transfer, the address auto increments but on FIFO_R_W
+*/
+static void Host_ImuTransfer(uint8_t reg, bool write, uint8_t* pData, uint16_t size)
+{
+    for (uint16_t i = 0; i < size; i++)
+    {
+        if (write) Host_ImuRegWrite(reg, pData[i]);
+        else pData[i] = Host_ImuRegRead(reg);
+        if (reg != IMU_REG_FIFO_R_W) reg++;
+    }
+}
+
+/**
+ * @brief Bus interrupt handler, as the I2C1 event one of port_imu_i2c.c
+*/
+static void Host_ImuBusIRQHandler(void)
+{
+    if (hostJobActive)
+    {
+        Host_ImuTransfer(hostJob.reg, hostJob.write, hostJob.pData, hostJob.size);
+        hostJobActive = false;
+    }
+    IMU_Port_IRQHandler();
+}
+
+/**
+ * @brief EXTI0 interrupt handler, the MPU9250 INT pin
+*/
+static void Host_ImuExtiIRQHandler(void)
+{
+    HAL_GPIO_EXTI_Callback(MPU_INT_Pin);
+}
+
+/**
+ * @brief Power on state of the chip, AK8963 included
+*/
+void Host_ImuReset(void)
+{
+    memset(pHostRegs, 0, sizeof(pHostRegs));
+    pHostRegs[IMU_REG_PWR_MGMT_1] = HOST_IMU_PWR_MGMT_1;
+    pHostRegs[IMU_REG_WHO_AM_I] = IMU_WHO_AM_I_MPU9250;
+    hostFifoHead = 0;
+    hostFifoCount = 0;
+    Host_MagReset();
+}
+
+/**
+ * @brief   A sample of the chip clock: new sensor values, the FIFO and the
+ *          data ready interrupt
+ * @param   pValues: accel, temperature, gyro and magnetometer, raw
+*/
+void Host_ImuSample(const int16_t* pValues)
+{
+    for (uint8_t i = 0; i < 7U; i++)
+    {
+        pHostRegs[IMU_REG_ACCEL_XOUT_H + 2U * i] = (uint8_t)((uint16_t)pValues[i] >> 8);
+        pHostRegs[IMU_REG_ACCEL_XOUT_H + 2U * i + 1U] = (uint8_t)pValues[i];
+    }
+    memcpy(pHostMag, &pValues[7], sizeof(pHostMag));
+    Host_MagMeasure();
+    Host_ImuSlaveRun(false);
+    Host_ImuFifoSample();
+    if (pHostRegs[IMU_REG_INT_ENABLE] & IMU_INT_ENABLE_RAW_RDY) HAL_NVIC_SetPendingIRQ(EXTI0_IRQn);
+}
+
+/**
+ * @brief Set the AK8963 overflow flag of the next measurements, ST2 HOFL
+*/
+void Host_ImuMagOverflow(bool overflow)
+{
+    hostMagOverflow = overflow;
+}
+
+/**
+ * @brief Hold the bus jobs started, or complete the one in flight
+*/
+void Host_ImuBusHold(bool hold)
+{
+    hostBusHold = hold;
+    if (!hold && hostJobActive) HAL_NVIC_SetPendingIRQ(I2C1_EV_IRQn);
+}
+
+/**
+ * @brief Register value, no side effect
+*/
+uint8_t Host_ImuGetReg(uint8_t reg)
+{
+    return pHostRegs[reg & (HOST_IMU_REG_COUNT - 1U)];
+}
+
+/**
+ * @brief Bytes in the FIFO
+*/
+uint16_t Host_ImuFifoCount(void)
+{
+    return hostFifoCount;
+}
+
+/**
+ * @brief Bus jobs started since the start
+*/
+uint32_t Host_ImuBusJobs(void)
+{
+    return hostBusJobs;
+}
+
+/**
+ * @brief Watch the writes to registers first to last, the count restarts
+*/
+void Host_ImuWriteWatch(uint8_t first, uint8_t last)
+{
+    hostWatchFirst = first;
+    hostWatchLast = last;
+    hostWatchJobs = 0;
+}
+
+/**
+ * @brief Write jobs on a watched register since the watch was set
+*/
+uint32_t Host_ImuWriteJobs(void)
+{
+    return hostWatchJobs;
+}
+
+/* Bus port -------------------------------------------------------------------*/
+IMU_Bridge_StatusTypeDef IMU_Port_BusInit(void)
+{
+    hostJobActive = false;
+    Host_IrqConnect(I2C1_EV_IRQn, Host_ImuBusIRQHandler);
+    Host_IrqConnect(EXTI0_IRQn, Host_ImuExtiIRQHandler);
+    return IMU_BRIDGE_OK;
+}
+
+IMU_Bridge_StatusTypeDef IMU_Port_BusStart(const IMU_Port_JobTypeDef* pJob)
+{
+    if (hostJobActive) return IMU_BRIDGE_ERROR;
+    hostJob = *pJob;
+    hostJobActive = true;
+    hostBusJobs++;
+    if (pJob->write && pJob->reg <= hostWatchLast && pJob->reg + pJob->size > hostWatchFirst) hostWatchJobs++;
+    if (!hostBusHold) HAL_NVIC_SetPendingIRQ(I2C1_EV_IRQn);
+    return IMU_BRIDGE_OK;
+}
+
+bool_t IMU_Port_BusIsReady(void)
+{
+    return !hostJobActive;
+}
+
+IMU_Bridge_StatusTypeDef IMU_Port_BusResult(void)
+{
+    return IMU_BRIDGE_OK;
+}
@@ -0,0 +1,46 @@
+/**
+  ******************************************************************************
+  * @file           : port_imu_host.h
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Host stand-in for the IMU Bridge sensor bus port header
+  ******************************************************************************
+  * @attention
+  *
+  * Host stand-in for the IMU Bridge sensor bus port header. The bus reaches a
+  * register model of the MPU9250 and of the AK8963 behind its I2C master.
+  * The tests set the sensor values and run the chip sample clock.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PORT_IMU_HOST_H
+#define __PORT_IMU_HOST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define HOST_IMU_CHANNELS       10U     /*!< Accel X Y Z, temp, gyro X Y Z, mag X Y Z */
+
+/* Exported functions --------------------------------------------------------*/
+void Host_ImuReset(void);
+void Host_ImuSample(const int16_t* pValues);
+void Host_ImuMagOverflow(bool overflow);
+void Host_ImuBusHold(bool hold);
+uint8_t Host_ImuGetReg(uint8_t reg);
+uint16_t Host_ImuFifoCount(void);
+uint32_t Host_ImuBusJobs(void);
+void Host_ImuWriteWatch(uint8_t first, uint8_t last);
+uint32_t Host_ImuWriteJobs(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PORT_IMU_HOST_H */
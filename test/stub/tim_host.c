@@ -0,0 +1,99 @@
+/**
+  ******************************************************************************
+  * @file           : tim_host.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Host stand-in for the STM32 HAL timer
+  ******************************************************************************
+  * @attention
+  *
+  * Host stand-in for the STM32 HAL timer, the output compare functions of
+  * port_timer.c. The TIM2 counter runs on demand, a microsecond per count,
+  * and each channel 1 compare match raises the interrupt. The handler part
+  * the port relies on is modelled after HAL_TIM_IRQHandler().
+  *
+  ******************************************************************************
+  */
+
+#include "main.h"
+
+TIM_TypeDef Host_TIM2;
+uint64_t Host_TimerUs = 0;                          /*!< Counter time, us                   */
+
+static TIM_HandleTypeDef* pHostTim;                 /*!< TIM2 handle                        */
+
+/**
+ * @brief TIM2 interrupt handler, the channel 1 compare of HAL_TIM_IRQHandler()
+*/
+static void Host_Tim2IRQHandler(void)
+{
+    if ((Host_TIM2.SR & TIM_FLAG_CC1) == 0 || (Host_TIM2.DIER & TIM_IT_CC1) == 0) return;
+
+    Host_TIM2.SR &= ~TIM_FLAG_CC1;
+    pHostTim->Channel = HAL_TIM_ACTIVE_CHANNEL_1;
+    HAL_TIM_OC_DelayElapsedCallback(pHostTim);
+    pHostTim->Channel = HAL_TIM_ACTIVE_CHANNEL_CLEARED;
+}
+
+/**
+ * @brief   Run the TIM2 counter
+ * @param   us: counts, each compare match on the way runs the interrupt
+*/
+void Host_TimerRun(uint32_t us)
+{
+    uint32_t distance;
+
+    while (us > 0)
+    {
+        distance = (Host_TIM2.CCR1 - Host_TIM2.CNT) & 0xFFFFU;
+        if (distance == 0) distance = 0x10000U;
+        if ((Host_TIM2.CR1 & TIM_CR1_CEN) == 0 || distance > us)
+        {
+            Host_TIM2.CNT = (Host_TIM2.CNT + us) & 0xFFFFU;
+            Host_TimerUs += us;
+            return;
+        }
+        Host_TIM2.CNT = Host_TIM2.CCR1;
+        Host_TimerUs += distance;
+        us -= distance;
+        Host_TIM2.SR |= TIM_FLAG_CC1;
+        if (Host_TIM2.DIER & TIM_IT_CC1) HAL_NVIC_SetPendingIRQ(TIM2_IRQn);
+    }
+}
+
+/* HAL ------------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_TIM_OC_Init(TIM_HandleTypeDef* htim)
+{
+    HAL_TIM_OC_MspInit(htim);
+    htim->Instance->CNT = 0;
+    htim->Instance->ARR = htim->Init.Period;
+    htim->State = HAL_TIM_STATE_READY;
+    if (htim->Instance == TIM2)
+    {
+        pHostTim = htim;
+        Host_IrqConnect(TIM2_IRQn, Host_Tim2IRQHandler);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_OC_ConfigChannel(TIM_HandleTypeDef* htim, TIM_OC_InitTypeDef* sConfig, uint32_t Channel)
+{
+    if (Channel != TIM_CHANNEL_1) return HAL_ERROR;
+    htim->Instance->CCR1 = sConfig->Pulse;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_OC_Start_IT(TIM_HandleTypeDef* htim, uint32_t Channel)
+{
+    if (Channel != TIM_CHANNEL_1) return HAL_ERROR;
+    htim->Instance->DIER |= TIM_IT_CC1;
+    htim->Instance->CR1 |= TIM_CR1_CEN;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_OC_Stop_IT(TIM_HandleTypeDef* htim, uint32_t Channel)
+{
+    if (Channel != TIM_CHANNEL_1) return HAL_ERROR;
+    htim->Instance->DIER &= ~TIM_IT_CC1;
+    htim->Instance->CR1 &= ~TIM_CR1_CEN;
+    return HAL_OK;
+}
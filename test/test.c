@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * @file           : test.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : IMU Bridge host tests helpers
+  ******************************************************************************
+  * @attention
+  *
+  * IMU Bridge host tests helpers, shared by the test and benchmark programs.
+  *
+  ******************************************************************************
+  */
+
+#include "test.h"
+
+#include <stdio.h>
+#include <time.h>
+
+static uint32_t testChecks = 0;                     /*!< Checks run                         */
+static uint32_t testFailures = 0;                   /*!< Checks failed                      */
+
+/**
+ * @brief Check a condition, report it with its location if false
+ * @retval The condition
+*/
+bool Test_Check(bool pass, const char* pCond, const char* pFile, int line)
+{
+    testChecks++;
+    if (!pass)
+    {
+        testFailures++;
+        printf("%s:%d: check failed: %s\n", pFile, line, pCond);
+    }
+    return pass;
+}
+
+/**
+ * @brief Run a test function and report its result
+*/
+void Test_Run(Test_FunctionTypeDef test, const char* pName)
+{
+    uint32_t failures = testFailures;
+
+    test();
+    printf("%-40s %s\n", pName, (testFailures == failures) ? "ok" : "FAILED");
+}
+
+/**
+ * @brief Report the checks run and failed
+ * @retval Process exit status, non zero on failures
+*/
+int Test_Summary(void)
+{
+    printf("%lu checks, %lu failed\n", (unsigned long)testChecks, (unsigned long)testFailures);
+    return (testFailures == 0) ? 0 : 1;
+}
+
+/**
+ * @brief Host monotonic clock, ns
+*/
+uint64_t Test_NowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000U + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Time a benchmark function and report the time per iteration
+ * @retval ns per iteration
+*/
+double Test_Bench(const char* pName, Test_BenchTypeDef bench, uint32_t iterations)
+{
+    uint64_t start = Test_NowNs();
+    double ns;
+
+    bench(iterations);
+    ns = (double)(Test_NowNs() - start) / iterations;
+    printf("%-40s %10.1f ns\n", pName, ns);
+    return ns;
+}
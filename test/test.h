@@ -0,0 +1,54 @@
+/**
+  ******************************************************************************
+  * @file           : test.h
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : IMU Bridge host tests header
+  ******************************************************************************
+  * @attention
+  *
+  * IMU Bridge host tests header. Checks count the failures and go on, so a
+  * run reports all of them. Benchmarks time a function over a number of
+  * calls with the host monotonic clock.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TEST_H
+#define __TEST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Defines -------------------------------------------------------------------*/
+/**
+ * @brief Check a condition, report it with its location if false
+*/
+#define TEST_CHECK(cond)        Test_Check((cond), #cond, __FILE__, __LINE__)
+
+/**
+ * @brief Run a test function, named after the function
+*/
+#define TEST_RUN(test)          Test_Run((test), #test)
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*Test_FunctionTypeDef)(void);
+typedef void (*Test_BenchTypeDef)(uint32_t iterations);
+
+/* Exported functions --------------------------------------------------------*/
+bool Test_Check(bool pass, const char* pCond, const char* pFile, int line);
+void Test_Run(Test_FunctionTypeDef test, const char* pName);
+int Test_Summary(void);
+uint64_t Test_NowNs(void);
+double Test_Bench(const char* pName, Test_BenchTypeDef bench, uint32_t iterations);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TEST_H */
@@ -0,0 +1,254 @@
+/**
+  ******************************************************************************
+  * @file           : test_bridge_rx.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Command reception host tests
+  ******************************************************************************
+  * @attention
+  *
+  * Command reception host tests, from the bytes on the USART1 RX line to the
+  * decoded commands: the circular DMA and IDLE line framing of port_uart.c,
+  * the RX ring and the command assembly of imu_bridge.c. The byte stream is
+  * simulated, fragmented, back to back and across the DMA buffer wrap.
+  *
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "main.h"
+#include "imu_bridge.h"
+#include "port_uart.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_CMD_MAX        32U     /*!< Commands taken per check       */
+#define TEST_FRAGMENT_MAX   37U     /*!< Max stream fragment, fewer commands than the queue holds */
+
+static uint8_t pWire[16 * 1024];                    /*!< Bytes out of the stand-in port     */
+
+/**
+ * @brief Bytes on the RX line, then the line goes idle
+*/
+static void Test_RxFrame(const char* pFrame)
+{
+    Host_UartRxWrite((const uint8_t*)pFrame, (uint16_t)strlen(pFrame));
+    Host_UartRxIdle();
+}
+
+/**
+ * @brief Run the main loop RX processing and take the commands queued
+ * @retval Commands taken
+*/
+static uint32_t Test_TakeCmds(IMU_Bridge_CmdTypeDef* pCmds)
+{
+    uint32_t count = 0;
+
+    IMU_Bridge_ProcessRx();
+    while (IMU_Bridge_CmdPending() && count < TEST_CMD_MAX) pCmds[count++] = IMU_Bridge_GetCmd();
+    return count;
+}
+
+/**
+ * @brief One command per frame, no delimiter, as the legacy host sends them
+*/
+static void Test_Undelimited(void)
+{
+    IMU_Bridge_CmdTypeDef pCmds[TEST_CMD_MAX];
+    uint32_t sent;
+
+    Test_RxFrame("STY");
+    TEST_CHECK(Test_TakeCmds(pCmds) == 1 && pCmds[0] == IMU_BRIDGE_CMD_SANITY);
+    sent = Host_UartTxDrain(pWire, sizeof(pWire));
+    TEST_CHECK(sent == strlen(">> CMD CALLBACK: STY\n\r") && memcmp(pWire, ">> CMD CALLBACK: STY\n\r", sent) == 0);
+
+    /* A frame shorter than a code is a fragment, the rest follows */
+    Test_RxFrame("C");
+    TEST_CHECK(Test_TakeCmds(pCmds) == 0);
+    Test_RxFrame("FG");
+    TEST_CHECK(Test_TakeCmds(pCmds) == 1 && pCmds[0] == IMU_BRIDGE_CMD_CONFIG);
+
+    /* Bytes without the idle yet, then the idle alone */
+    Host_UartRxWrite((const uint8_t*)"EXT", 3);
+    TEST_CHECK(Test_TakeCmds(pCmds) == 0);
+    Host_UartRxIdle();
+    TEST_CHECK(Test_TakeCmds(pCmds) == 1 && pCmds[0] == IMU_BRIDGE_CMD_EXIT);
+    Host_UartTxDrain(pWire, sizeof(pWire));
+}
+
+/**
+ * @brief Delimited commands back to back in one frame, and split across frames
+*/
+static void Test_BackToBack(void)
+{
+    IMU_Bridge_CmdTypeDef pCmds[TEST_CMD_MAX];
+    uint32_t value;
+
+    Test_RxFrame("CFG;CG2\r\nEXT\n");
+    TEST_CHECK(Test_TakeCmds(pCmds) == 3);
+    TEST_CHECK(pCmds[0] == IMU_BRIDGE_CMD_CONFIG && pCmds[1] == IMU_BRIDGE_CMD_CFG_GYRO_FS500 && pCmds[2] == IMU_BRIDGE_CMD_EXIT);
+
+    /* Once delimited, a frame boundary no longer ends a command */
+    Test_RxFrame("RTS 25");
+    TEST_CHECK(Test_TakeCmds(pCmds) == 0);
+    Test_RxFrame("00\n");
+    TEST_CHECK(Test_TakeCmds(pCmds) == 1 && pCmds[0] == IMU_BRIDGE_CMD_REALTIME_TIMER);
+    TEST_CHECK(IMU_Bridge_GetCmdArg(&value) == IMU_BRIDGE_OK && value == 2500);
+
+    /* Too long, dropped whole, the next one still decoded */
+    Test_RxFrame("RTS 123456789012345\nSTY\n");
+    TEST_CHECK(Test_TakeCmds(pCmds) == 1 && pCmds[0] == IMU_BRIDGE_CMD_SANITY);
+
+    /* Unknown code, queued and decoded as invalid */
+    Test_RxFrame("XYZ\n");
+    TEST_CHECK(Test_TakeCmds(pCmds) == 1 && pCmds[0] == IMU_BRIDGE_CMD_INVALID);
+    Host_UartTxDrain(pWire, sizeof(pWire));
+}
+
+/**
+ * @brief   Receive timestamp of a command, with more bytes received before it's decoded
+ * @note    The latency is measured from the fragment that ended the command,
+ *          not the last fragment received.
+*/
+static void Test_Timestamp(void)
+{
+    IMU_Bridge_CmdTypeDef pCmds[TEST_CMD_MAX];
+    uint32_t sent;
+
+    Host_DWT.CYCCNT = 0;
+    Test_RxFrame("STY\n");
+    Host_DWT.CYCCNT = 5U * 72000U;
+    Test_RxFrame("CF");
+    Host_DWT.CYCCNT = 10U * 72000U;
+    TEST_CHECK(Test_TakeCmds(pCmds) == 1 && pCmds[0] == IMU_BRIDGE_CMD_SANITY);
+    Test_RxFrame("G\n");
+    TEST_CHECK(Test_TakeCmds(pCmds) == 1 && pCmds[0] == IMU_BRIDGE_CMD_CONFIG);
+    Host_UartTxDrain(pWire, sizeof(pWire));
+
+    Test_RxFrame("STS\n");
+    TEST_CHECK(Test_TakeCmds(pCmds) == 1 && pCmds[0] == IMU_BRIDGE_CMD_INVALID);
+    sent = Host_UartTxDrain(pWire, sizeof(pWire) - 1U);
+    pWire[sent] = '\0';
+    TEST_CHECK(strstr((const char*)pWire, "CMD LATENCY:\t10000 us") != NULL);
+}
+
+/**
+ * @brief Commands past the FIFO depth, dropped and reported, never echoed as accepted
+*/
+static void Test_Dropped(void)
+{
+    IMU_Bridge_CmdTypeDef pCmds[TEST_CMD_MAX];
+    const char* p;
+    uint32_t sent, echoed = 0, dropped = 0;
+
+    Test_RxFrame("STY\nSTY\nSTY\nSTY\nSTY\nSTY\nSTY\nSTY\nSTY\nSTY\nCG1\nCG2\n");
+    TEST_CHECK(Test_TakeCmds(pCmds) == 10U);
+    sent = Host_UartTxDrain(pWire, sizeof(pWire) - 1U);
+    pWire[sent] = '\0';
+    for (p = (const char*)pWire; (p = strstr(p, ">> CMD CALLBACK: ")) != NULL; p++) echoed++;
+    for (p = (const char*)pWire; (p = strstr(p, ">> CMD DROPPED: ")) != NULL; p++) dropped++;
+    TEST_CHECK(echoed == 10U && dropped == 2U);
+    TEST_CHECK(strstr((const char*)pWire, ">> CMD DROPPED: CG2") != NULL);
+
+    Test_RxFrame("STS\n");
+    TEST_CHECK(Test_TakeCmds(pCmds) == 1 && pCmds[0] == IMU_BRIDGE_CMD_INVALID);
+    sent = Host_UartTxDrain(pWire, sizeof(pWire) - 1U);
+    pWire[sent] = '\0';
+    TEST_CHECK(strstr((const char*)pWire, "CMD DROPPED:\t2\n") != NULL);
+}
+
+/**
+ * @brief A long stream in fragments of every size, across many DMA buffer wraps
+ * @note The commands are taken after each fragment, as the main loop would
+*/
+static void Test_Stream(void)
+{
+    static const char* const pNames[] = { "CG1", "CA4", "RTS 1000", "CSD 9", "RTE 3", "RRG 500" };
+    static const IMU_Bridge_CmdTypeDef pExpected[] =
+    {
+        IMU_BRIDGE_CMD_CFG_GYRO_FS250, IMU_BRIDGE_CMD_CFG_ACCEL_FS16, IMU_BRIDGE_CMD_REALTIME_TIMER,
+        IMU_BRIDGE_CMD_CFG_RATE_DIV, IMU_BRIDGE_CMD_REALTIME_ENCODER, IMU_BRIDGE_CMD_REALTIME_RATE_GYRO
+    };
+    IMU_Bridge_CmdTypeDef pCmds[TEST_CMD_MAX];
+    char pStream[8192];
+    uint32_t length = 0, pos = 0, sent = 0, taken = 0, count, fragment = 1;
+    bool inOrder = true;
+
+    for (sent = 0; length < sizeof(pStream) - 16U; sent++)
+    {
+        length += (uint32_t)sprintf(&pStream[length], "%s\n", pNames[sent % 6U]);
+    }
+
+    while (pos < length)
+    {
+        uint32_t size = (fragment < length - pos) ? fragment : length - pos;
+
+        /* Some fragments without idle, as bytes pile up between two events */
+        Host_UartRxWrite((const uint8_t*)&pStream[pos], (uint16_t)size);
+        if (fragment % 3U != 0) Host_UartRxIdle();
+        pos += size;
+        fragment = fragment % TEST_FRAGMENT_MAX + 1U;
+
+        count = Test_TakeCmds(pCmds);
+        for (uint32_t j = 0; j < count; j++, taken++) inOrder &= (pCmds[j] == pExpected[taken % 6U]);
+        Host_UartTxDrain(pWire, sizeof(pWire));
+    }
+    Host_UartRxIdle();
+    count = Test_TakeCmds(pCmds);
+    for (uint32_t j = 0; j < count; j++, taken++) inOrder &= (pCmds[j] == pExpected[taken % 6U]);
+    Host_UartTxDrain(pWire, sizeof(pWire));
+
+    TEST_CHECK(length > 100U * UART_RX_BUFFER_SIZE);
+    TEST_CHECK(inOrder);
+    TEST_CHECK(taken == sent);
+}
+
+/**
+ * @brief   An undelimited frame ending right on the DMA buffer wrap
+ * @note    The HAL reports the wrap, not the IDLE that follows with no new
+ *          bytes, the port catches it so the frame still ends the command.
+*/
+static void Test_IdleOnWrap(void)
+{
+    IMU_Bridge_CmdTypeDef pCmds[TEST_CMD_MAX];
+    char pFrame[IMU_BRIDGE_CMD_MAX_LEN + 1];
+    uint32_t remaining = Host_DMA1_Channel5.CNDTR;
+    uint32_t pads = 0, taken = 0;
+
+    /* Whole commands up to the last one, "RTS 1..." of 5 to 15 bytes */
+    while (remaining < 5U || remaining > IMU_BRIDGE_CMD_MAX_LEN)
+    {
+        uint32_t size = (remaining < 5U) ? remaining + 10U : 3U;
+
+        memset(pFrame, '1', sizeof(pFrame));
+        memcpy(pFrame, (size == 3U) ? "STY" : "RTS ", (size == 3U) ? 3U : 4U);
+        pFrame[size] = '\0';
+        Test_RxFrame(pFrame);
+        taken += Test_TakeCmds(pCmds);
+        pads++;
+        remaining = Host_DMA1_Channel5.CNDTR;
+    }
+    memset(pFrame, '1', sizeof(pFrame));
+    memcpy(pFrame, "RTS ", 4U);
+    pFrame[remaining] = '\0';
+    Test_RxFrame(pFrame);
+
+    TEST_CHECK(Host_DMA1_Channel5.CNDTR == UART_RX_BUFFER_SIZE);
+    TEST_CHECK(taken == pads);
+    TEST_CHECK(Test_TakeCmds(pCmds) == 1 && pCmds[0] == IMU_BRIDGE_CMD_REALTIME_TIMER);
+    Host_UartTxDrain(pWire, sizeof(pWire));
+}
+
+int main(void)
+{
+    TEST_CHECK(IMU_Bridge_Init() == IMU_BRIDGE_OK);
+
+    /* Undelimited first, a delimiter switches the framing for good */
+    TEST_RUN(Test_Undelimited);
+    TEST_RUN(Test_IdleOnWrap);
+    TEST_RUN(Test_BackToBack);
+    TEST_RUN(Test_Timestamp);
+    TEST_RUN(Test_Dropped);
+    TEST_RUN(Test_Stream);
+    return Test_Summary();
+}
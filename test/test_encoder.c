@@ -0,0 +1,370 @@
+/**
+  ******************************************************************************
+  * @file           : test_encoder.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Output encoders host tests
+  ******************************************************************************
+  * @attention
+  *
+  * Output encoders host tests: records of the sensor masks the bridge
+  * streams, encoded by each table entry and read back. The text formats
+  * are parsed as a host would, the binary frames go through the host
+  * decoder of frame_decode.c, the delta frames through its delta decoder
+  * too, with frames lost.
+  *
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "imu_bridge.h"
+#include "imu_bridge_encoder.h"
+#include "imu_bridge_frame.h"
+#include "imu_bridge_sensor.h"
+#include "frame_decode.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_RECORDS        3000U
+#define TEST_FIELDS(a)      ((int)(sizeof(a) / sizeof((a)[0])))
+
+static const uint8_t pMasks[] =
+{
+    IMU_BRIDGE_SENSOR_ACCEL, IMU_BRIDGE_SENSOR_TEMP, IMU_BRIDGE_SENSOR_GYRO, IMU_BRIDGE_SENSOR_MAG,
+    IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_TEMP | IMU_BRIDGE_SENSOR_GYRO, 0x0FU
+};
+
+static uint8_t pOut[IMU_BRIDGE_TX_LINE_SIZE];
+static int16_t pValues[IMU_BRIDGE_FRAME_MAX_CHANNELS];
+static IMU_Bridge_RecordTypeDef record = { .pValues = pValues };
+static uint32_t seed = 1;
+
+/**
+ * @brief Next test record: zero, extreme or noise values
+*/
+static void Test_NextRecord(uint32_t n)
+{
+    record.mask = pMasks[n % sizeof(pMasks)];
+    record.seq = (uint16_t)(65000U + n);
+    record.tick = 0xFFFFFF00U + n * 7U;
+    for (uint8_t i = 0; i < IMU_BRIDGE_FRAME_MAX_CHANNELS; i++)
+    {
+        seed = seed * 1103515245U + 12345U;
+        pValues[i] = (n % 5U == 0) ? 0 : (n % 5U == 1) ? (int16_t)(i & 1U ? INT16_MIN : INT16_MAX) :
+                     (int16_t)(seed >> 16);
+    }
+}
+
+/**
+ * @brief   Encode the test record, NUL terminated
+ * @retval  Record size, 0 if over the encoder max size
+*/
+static uint16_t Test_Encode(const IMU_Bridge_EncoderTypeDef* pEncoder)
+{
+    uint16_t size = pEncoder->Record(pOut, &record);
+
+    if (size > pEncoder->maxSize || size >= sizeof(pOut)) return 0;
+    pOut[size] = '\0';
+    return size;
+}
+
+/**
+ * @brief   Parse a text line: label, fields and line end
+ * @retval  Number of fields, -1 if the line is malformed
+*/
+static int Test_ParseLine(const char* pLine, const char* pLabel, char separator, const char* pEnd, int32_t* pFields,
+    int maxFields)
+{
+    size_t labelSize = strlen(pLabel);
+    const char* p = pLine + labelSize;
+    int fields = 0;
+
+    if (strncmp(pLine, pLabel, labelSize) != 0) return -1;
+
+    /* A label is followed by a separator, an unlabelled line starts with a field */
+    while (fields < maxFields && ((fields == 0 && labelSize == 0) || *p == separator))
+    {
+        char* pNext;
+
+        if (fields != 0 || labelSize != 0) p++;
+        pFields[fields++] = (int32_t)strtol(p, &pNext, 10);
+        if (pNext == p) return -1;
+        p = pNext;
+    }
+    return (strcmp(p, pEnd) == 0) ? fields : -1;
+}
+
+/**
+ * @brief Legacy text: label of the mask, raw uint16 single sensor lines, timed signed combined lines
+*/
+static void Test_Text(void)
+{
+    const IMU_Bridge_EncoderTypeDef* pEncoder = IMU_Bridge_EncoderGet(IMU_BRIDGE_ENCODER_TEXT);
+    int32_t pFields[IMU_BRIDGE_FRAME_MAX_CHANNELS + 1U];
+    uint32_t failed = 0;
+
+    for (uint32_t n = 0; n < TEST_RECORDS; n++)
+    {
+        const char* pLabel;
+        uint8_t channels, timed = 1;
+        bool ok;
+
+        Test_NextRecord(n);
+        channels = IMU_Bridge_FrameChannels(record.mask);
+        switch (record.mask)
+        {
+        case IMU_BRIDGE_SENSOR_ACCEL: pLabel = "ACCEL READ:"; timed = 0; break;
+        case IMU_BRIDGE_SENSOR_TEMP: pLabel = "TEMP READ:"; timed = 0; break;
+        case IMU_BRIDGE_SENSOR_GYRO: pLabel = "GYRO READ:"; timed = 0; break;
+        default: pLabel = (record.mask & IMU_BRIDGE_SENSOR_MAG) ? "IMU9 READ:" : "IMU READ:"; break;
+        }
+
+        ok = Test_Encode(pEncoder) != 0 &&
+             Test_ParseLine((char*)pOut, pLabel, '\t', "\n\r", pFields, TEST_FIELDS(pFields)) == timed + channels &&
+             (!timed || (uint32_t)pFields[0] == record.tick);
+        for (uint8_t i = 0; ok && i < channels; i++)
+        {
+            ok = timed ? pFields[1 + i] == pValues[i] : pFields[i] == (uint16_t)pValues[i];
+        }
+        failed += !ok;
+    }
+    TEST_CHECK(failed == 0);
+}
+
+/**
+ * @brief Physical units text: timestamp and the scaled values of the record
+*/
+static void Test_Units(void)
+{
+    const IMU_Bridge_EncoderTypeDef* pEncoder = IMU_Bridge_EncoderGet(IMU_BRIDGE_ENCODER_UNITS);
+    int32_t pFields[IMU_BRIDGE_FRAME_MAX_CHANNELS + 1U];
+    int32_t pUnits[IMU_BRIDGE_FRAME_MAX_CHANNELS];
+    uint32_t failed = 0;
+
+    for (uint32_t n = 0; n < TEST_RECORDS; n++)
+    {
+        const char* pLabel;
+        uint8_t channels;
+        bool ok;
+
+        Test_NextRecord(n);
+        channels = IMU_Bridge_FrameChannels(record.mask);
+        IMU_Bridge_ScaleValues(record.mask, pValues, pUnits);
+        switch (record.mask)
+        {
+        case IMU_BRIDGE_SENSOR_ACCEL: pLabel = "ACCEL MG:"; break;
+        case IMU_BRIDGE_SENSOR_TEMP: pLabel = "TEMP CDEGC:"; break;
+        case IMU_BRIDGE_SENSOR_GYRO: pLabel = "GYRO MDPS:"; break;
+        default: pLabel = (record.mask & IMU_BRIDGE_SENSOR_MAG) ? "IMU9 UNITS:" : "IMU UNITS:"; break;
+        }
+
+        ok = Test_Encode(pEncoder) != 0 &&
+             Test_ParseLine((char*)pOut, pLabel, '\t', "\n\r", pFields, TEST_FIELDS(pFields)) == 1 + channels &&
+             (uint32_t)pFields[0] == record.tick && memcmp(&pFields[1], pUnits, channels * sizeof(int32_t)) == 0;
+        failed += !ok;
+    }
+    TEST_CHECK(failed == 0);
+}
+
+/**
+ * @brief CSV: sequence, timestamp, mask and signed values, the whole record
+*/
+static void Test_Csv(void)
+{
+    const IMU_Bridge_EncoderTypeDef* pEncoder = IMU_Bridge_EncoderGet(IMU_BRIDGE_ENCODER_CSV);
+    int32_t pFields[IMU_BRIDGE_FRAME_MAX_CHANNELS + 3U];
+    uint32_t failed = 0;
+
+    for (uint32_t n = 0; n < TEST_RECORDS; n++)
+    {
+        uint8_t channels;
+        bool ok;
+
+        Test_NextRecord(n);
+        channels = IMU_Bridge_FrameChannels(record.mask);
+        ok = Test_Encode(pEncoder) != 0 &&
+             Test_ParseLine((char*)pOut, "", ',', "\r\n", pFields, TEST_FIELDS(pFields)) == 3 + channels &&
+             pFields[0] == record.seq && (uint32_t)pFields[1] == record.tick && pFields[2] == record.mask;
+        for (uint8_t i = 0; ok && i < channels; i++) ok = pFields[3 + i] == pValues[i];
+        failed += !ok;
+    }
+    TEST_CHECK(failed == 0);
+}
+
+/**
+ * @brief Binary frames, int16 or zigzag varint payload, through the host decoder
+*/
+static void Test_Frames(uint32_t id, uint8_t flags)
+{
+    const IMU_Bridge_EncoderTypeDef* pEncoder = IMU_Bridge_EncoderGet(id);
+    Frame_RecordTypeDef decoded;
+    uint32_t failed = 0;
+
+    for (uint32_t n = 0; n < TEST_RECORDS; n++)
+    {
+        uint16_t size;
+
+        Test_NextRecord(n);
+        size = Test_Encode(pEncoder);
+        if (size < 2U || pOut[size - 1U] != IMU_BRIDGE_FRAME_DELIMITER || memchr(pOut, 0, size - 1U) != NULL ||
+            Frame_Decode(pOut, size - 1U, &decoded) != FRAME_DECODE_OK ||
+            decoded.mask != (record.mask | flags) || decoded.seq != record.seq || decoded.tick != record.tick ||
+            decoded.channels != IMU_Bridge_FrameChannels(record.mask) ||
+            memcmp(decoded.pValues, pValues, decoded.channels * sizeof(int16_t)) != 0)
+        {
+            failed++;
+        }
+    }
+    TEST_CHECK(failed == 0);
+}
+
+static void Test_Binary(void)
+{
+    Test_Frames(IMU_BRIDGE_ENCODER_BINARY, 0);
+}
+
+static void Test_Varint(void)
+{
+    Test_Frames(IMU_BRIDGE_ENCODER_VARINT, IMU_BRIDGE_FRAME_VARINT);
+}
+
+/**
+ * @brief   Next correlated record: channels drift by small steps, with a
+ *          jump now and then. Temperature comes alone or with the other
+ *          sensors, so the sensors get their keyframes at different records.
+*/
+static void Test_NextCorrelated(uint32_t n)
+{
+    record.mask = (n % 10U == 0) ? 0x07U : (n % 10U == 5U) ? IMU_BRIDGE_SENSOR_TEMP : 0x05U;
+    record.seq = (uint16_t)(65000U + n);
+    record.tick = 0xFFFF0000U + n * 1000U + (n * 37U) % 50U;
+    for (uint8_t i = 0; i < IMU_BRIDGE_FRAME_MAX_CHANNELS; i++)
+    {
+        seed = seed * 1103515245U + 12345U;
+        pValues[i] = (int16_t)(uint16_t)((uint16_t)pValues[i] + (n % 97U == 0 ? 20000U : (seed >> 16) % 33U - 16U));
+    }
+}
+
+/**
+ * @brief   Check a delta decoded record against the test record
+ * @retval  true if the decoded sensors hold the record values
+*/
+static bool Test_DeltaMatch(const Frame_RecordTypeDef* pDecoded)
+{
+    const int16_t* pValue = pDecoded->pValues;
+
+    if ((pDecoded->mask & ~record.mask) != 0) return false;
+    if (pDecoded->mask != 0 && pDecoded->tick != record.tick) return false;
+
+    /* Record channels are in sensor order, the decoded ones are a subset */
+    for (uint8_t bit = IMU_BRIDGE_SENSOR_ACCEL, in = 0; bit <= IMU_BRIDGE_SENSOR_MAG; bit <<= 1)
+    {
+        uint8_t channels = IMU_Bridge_FrameChannels(bit);
+
+        if (!(record.mask & bit)) continue;
+        if ((pDecoded->mask & bit) && memcmp(pValue, &pValues[in], channels * sizeof(int16_t)) != 0) return false;
+        if (pDecoded->mask & bit) pValue += channels;
+        in += channels;
+    }
+    return true;
+}
+
+/**
+ * @brief Delta frames back to the records, the keyframes only now and then
+*/
+static void Test_Delta(void)
+{
+    const IMU_Bridge_EncoderTypeDef* pEncoder = IMU_Bridge_EncoderGet(IMU_BRIDGE_ENCODER_DELTA);
+    Frame_DeltaDecoderTypeDef delta;
+    Frame_RecordTypeDef decoded;
+    uint32_t failed = 0, keyframes = 0;
+
+    pEncoder->Reset();
+    Frame_DeltaInit(&delta);
+    for (uint32_t n = 0; n < TEST_RECORDS; n++)
+    {
+        uint16_t size;
+        bool ok;
+
+        Test_NextCorrelated(n);
+        size = Test_Encode(pEncoder);
+        ok = size >= 2U && pOut[size - 1U] == IMU_BRIDGE_FRAME_DELIMITER && memchr(pOut, 0, size - 1U) == NULL &&
+             Frame_Decode(pOut, size - 1U, &decoded) == FRAME_DECODE_OK;
+        keyframes += ok && !(decoded.mask & IMU_BRIDGE_FRAME_DELTA);
+        ok = ok && Frame_DeltaDecode(&delta, &decoded, size) && decoded.mask == record.mask && Test_DeltaMatch(&decoded);
+        failed += !ok;
+    }
+    TEST_CHECK(failed == 0);
+    TEST_CHECK(delta.gaps == 0 && delta.skipped == 0);
+    TEST_CHECK(keyframes > 1U && keyframes < TEST_RECORDS / 16U);
+    TEST_CHECK(Frame_DeltaRatio(&delta) > 1.0);
+}
+
+/**
+ * @brief   Lost frames: the first keyframe, a later keyframe and a delta
+ *          frame. The host never decodes a wrong value, skips the sensors
+ *          without a reference and has them all back within a keyframe
+ *          interval.
+ * @note    The keyframe after record 1100 is the accel and gyro one, the
+ *          temperature one follows alone. With it lost the records of the
+ *          three sensors decode the temperature only, until the next accel
+ *          and gyro keyframe.
+*/
+static void Test_DeltaLost(void)
+{
+    const IMU_Bridge_EncoderTypeDef* pEncoder = IMU_Bridge_EncoderGet(IMU_BRIDGE_ENCODER_DELTA);
+    Frame_DeltaDecoderTypeDef delta;
+    Frame_RecordTypeDef decoded;
+    uint32_t wrong = 0, late = 0, partial = 0, incomplete = 0, lostAt = 0;
+    bool keyLost = false;
+
+    pEncoder->Reset();
+    Frame_DeltaInit(&delta);
+    for (uint32_t n = 0; n < TEST_RECORDS; n++)
+    {
+        uint16_t size;
+
+        Test_NextCorrelated(n);
+        size = Test_Encode(pEncoder);
+        if (size < 2U || Frame_Decode(pOut, size - 1U, &decoded) != FRAME_DECODE_OK)
+        {
+            wrong++;
+            continue;
+        }
+
+        if (n == 0 || n == 2000U || (n > 1100U && !keyLost && !(decoded.mask & IMU_BRIDGE_FRAME_DELTA)))
+        {
+            keyLost |= (n > 1100U);
+            lostAt = n;
+            continue;
+        }
+
+        Frame_DeltaDecode(&delta, &decoded, size);
+        wrong += !Test_DeltaMatch(&decoded);
+        if (decoded.mask != record.mask)
+        {
+            incomplete++;
+            partial += (decoded.mask != 0);
+
+            /* A sensor is due at most every interval, in one of the next few records */
+            late += (n > lostAt + IMU_BRIDGE_DELTA_KEY_INTERVAL + 10U);
+        }
+    }
+    TEST_CHECK(wrong == 0 && late == 0);
+    TEST_CHECK(keyLost && delta.gaps == 2U);
+    TEST_CHECK(incomplete != 0 && partial != 0);
+}
+
+int main(void)
+{
+    TEST_CHECK(IMU_Bridge_Init() == IMU_BRIDGE_OK);
+
+    TEST_RUN(Test_Text);
+    TEST_RUN(Test_Units);
+    TEST_RUN(Test_Csv);
+    TEST_RUN(Test_Binary);
+    TEST_RUN(Test_Varint);
+    TEST_RUN(Test_Delta);
+    TEST_RUN(Test_DeltaLost);
+    return Test_Summary();
+}
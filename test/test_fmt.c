@@ -0,0 +1,151 @@
+/**
+  ******************************************************************************
+  * @file           : test_fmt.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Integer formatter host tests
+  ******************************************************************************
+  * @attention
+  *
+  * Integer formatter host tests: fmt.c against the host snprintf, byte for
+  * byte, over the whole int16 range and int32 edge and random values, and
+  * the text stream lines against the snprintf formats they replaced.
+  *
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "fmt.h"
+#include "imu_bridge.h"
+#include "imu_bridge_encoder.h"
+#include "imu_bridge_frame.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief Every int16, signed and as its raw uint16 bits, as single fields
+*/
+static void Test_Int16(void)
+{
+    char pFmt[32], pRef[32];
+    uint32_t mismatched = 0;
+
+    for (int32_t v = INT16_MIN; v <= INT16_MAX; v++)
+    {
+        int16_t value = (int16_t)v;
+
+        *Fmt_Fields(pFmt, &value, 1, false) = '\0';
+        snprintf(pRef, sizeof(pRef), "\t%d", value);
+        mismatched += (strcmp(pFmt, pRef) != 0);
+
+        *Fmt_Fields(pFmt, &value, 1, true) = '\0';
+        snprintf(pRef, sizeof(pRef), "\t%u", (uint16_t)value);
+        mismatched += (strcmp(pFmt, pRef) != 0);
+    }
+    TEST_CHECK(mismatched == 0);
+}
+
+/**
+ * @brief int32 and uint32 at every digit count boundary, and random values
+*/
+static void Test_Int32(void)
+{
+    static const uint32_t pEdges[] =
+    {
+        0U, 1U, 9U, 10U, 99U, 100U, 999U, 1000U, 9999U, 10000U, 99999U, 100000U, 999999U, 1000000U,
+        9999999U, 10000000U, 99999999U, 100000000U, 999999999U, 1000000000U, 2147483647U, 2147483648U, 4294967295U
+    };
+    char pFmt[32], pRef[32];
+    uint32_t mismatched = 0, seed = 7;
+
+    for (uint32_t i = 0; i < sizeof(pEdges) / sizeof(pEdges[0]) + 1000000U; i++)
+    {
+        uint32_t value = (i < sizeof(pEdges) / sizeof(pEdges[0])) ? pEdges[i] : (seed = seed * 1664525U + 1013904223U);
+
+        *Fmt_Uint32(pFmt, value) = '\0';
+        snprintf(pRef, sizeof(pRef), "%lu", (unsigned long)value);
+        mismatched += (strcmp(pFmt, pRef) != 0);
+
+        *Fmt_Int32(pFmt, (int32_t)value) = '\0';
+        snprintf(pRef, sizeof(pRef), "%ld", (long)(int32_t)value);
+        mismatched += (strcmp(pFmt, pRef) != 0);
+
+        *Fmt_Int32(pFmt, -(int32_t)(value >> 1)) = '\0';
+        snprintf(pRef, sizeof(pRef), "%ld", -(long)(value >> 1));
+        mismatched += (strcmp(pFmt, pRef) != 0);
+
+        *Fmt_Hex(pFmt, value, 8) = '\0';
+        snprintf(pRef, sizeof(pRef), "%08lX", (unsigned long)value);
+        mismatched += (strcmp(pFmt, pRef) != 0);
+
+        *Fmt_Hex(pFmt, value, 2) = '\0';
+        snprintf(pRef, sizeof(pRef), "%02lX", (unsigned long)(value & 0xFFU));
+        mismatched += (strcmp(pFmt, pRef) != 0);
+    }
+    TEST_CHECK(mismatched == 0);
+}
+
+/**
+ * @brief The TEXT stream lines, byte identical to the snprintf formats they replaced
+*/
+static void Test_TextLines(void)
+{
+    const IMU_Bridge_EncoderTypeDef* pText = IMU_Bridge_EncoderGet(IMU_BRIDGE_ENCODER_TEXT);
+    int16_t pValues[IMU_BRIDGE_FRAME_MAX_CHANNELS];
+    IMU_Bridge_RecordTypeDef record = { .pValues = pValues };
+    char pFmt[IMU_BRIDGE_TX_LINE_SIZE + 1], pRef[IMU_BRIDGE_TX_LINE_SIZE + 1];
+    uint32_t mismatched = 0, seed = 3;
+    uint16_t size;
+    int16_t* v = pValues;
+
+    for (uint32_t n = 0; n < 100000U; n++)
+    {
+        for (uint8_t i = 0; i < IMU_BRIDGE_FRAME_MAX_CHANNELS; i++)
+        {
+            seed = seed * 1103515245U + 12345U;
+            pValues[i] = (n == 0) ? INT16_MIN : (n == 1) ? INT16_MAX : (int16_t)(seed >> 16);
+        }
+        record.tick = seed;
+
+        record.mask = IMU_BRIDGE_SENSOR_GYRO;
+        size = pText->Record((uint8_t*)pFmt, &record);
+        pFmt[size] = '\0';
+        snprintf(pRef, sizeof(pRef), "GYRO READ:\t%d\t%d\t%d\n\r", (uint16_t)v[0], (uint16_t)v[1], (uint16_t)v[2]);
+        mismatched += (strcmp(pFmt, pRef) != 0);
+
+        record.mask = IMU_BRIDGE_SENSOR_ACCEL;
+        size = pText->Record((uint8_t*)pFmt, &record);
+        pFmt[size] = '\0';
+        snprintf(pRef, sizeof(pRef), "ACCEL READ:\t%d\t%d\t%d\n\r", (uint16_t)v[0], (uint16_t)v[1], (uint16_t)v[2]);
+        mismatched += (strcmp(pFmt, pRef) != 0);
+
+        record.mask = IMU_BRIDGE_SENSOR_TEMP;
+        size = pText->Record((uint8_t*)pFmt, &record);
+        pFmt[size] = '\0';
+        snprintf(pRef, sizeof(pRef), "TEMP READ:\t%d\n\r", (uint16_t)v[0]);
+        mismatched += (strcmp(pFmt, pRef) != 0);
+
+        record.mask = IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_TEMP | IMU_BRIDGE_SENSOR_GYRO;
+        size = pText->Record((uint8_t*)pFmt, &record);
+        pFmt[size] = '\0';
+        snprintf(pRef, sizeof(pRef), "IMU READ:\t%lu\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n\r", (unsigned long)record.tick,
+            v[0], v[1], v[2], v[3], v[4], v[5], v[6]);
+        mismatched += (strcmp(pFmt, pRef) != 0);
+
+        record.mask = 0x0FU;
+        size = pText->Record((uint8_t*)pFmt, &record);
+        pFmt[size] = '\0';
+        snprintf(pRef, sizeof(pRef), "IMU9 READ:\t%lu\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n\r", (unsigned long)record.tick,
+            v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8], v[9]);
+        mismatched += (strcmp(pFmt, pRef) != 0);
+    }
+    TEST_CHECK(mismatched == 0);
+}
+
+int main(void)
+{
+    TEST_RUN(Test_Int16);
+    TEST_RUN(Test_Int32);
+    TEST_RUN(Test_TextLines);
+    return Test_Summary();
+}
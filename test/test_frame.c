@@ -0,0 +1,219 @@
+/**
+  ******************************************************************************
+  * @file           : test_frame.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Binary real time stream host tests
+  ******************************************************************************
+  * @attention
+  *
+  * Binary real time stream host tests: records encoded into the transmit
+  * memory as the real time state sends them, taken off the stand-in UART
+  * and decoded by the host decoder of frame_decode.c, a frame at a time or
+  * as a stream with damaged frames.
+  *
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "main.h"
+#include "imu_bridge.h"
+#include "imu_bridge_encoder.h"
+#include "frame_decode.h"
+
+#include <string.h>
+
+static uint8_t pWire[4096];                         /*!< Bytes out of the stand-in port     */
+
+/**
+ * @brief   Send a record through the transmit memory, as the real time state does
+ * @retval  Bytes on the wire
+*/
+static uint32_t Test_Send(const IMU_Bridge_EncoderTypeDef* pEncoder, const IMU_Bridge_RecordTypeDef* pRecord)
+{
+    char* msg = IMU_Bridge_TxReserve(pEncoder->maxSize);
+
+    if (msg == NULL) return 0;
+    IMU_Bridge_TxCommitData(pEncoder->Record((uint8_t*)msg, pRecord));
+    return Host_UartTxDrain(pWire, sizeof(pWire));
+}
+
+/**
+ * @brief A frame per record, whole on the wire, delimiter included, and decoded back
+*/
+static void Test_BinaryRoundTrip(void)
+{
+    static const uint8_t pMasks[] =
+    {
+        IMU_BRIDGE_SENSOR_ACCEL, IMU_BRIDGE_SENSOR_TEMP, IMU_BRIDGE_SENSOR_GYRO, IMU_BRIDGE_SENSOR_MAG,
+        IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_TEMP | IMU_BRIDGE_SENSOR_GYRO, 0x0FU
+    };
+    const IMU_Bridge_EncoderTypeDef* pEncoder = IMU_Bridge_EncoderGet(IMU_BRIDGE_ENCODER_BINARY);
+    int16_t pValues[IMU_BRIDGE_FRAME_MAX_CHANNELS];
+    IMU_Bridge_RecordTypeDef record = { .pValues = pValues };
+    Frame_RecordTypeDef decoded;
+    uint32_t seed = 1, failed = 0, sent;
+
+    for (uint32_t n = 0; n < 3000U; n++)
+    {
+        record.mask = pMasks[n % sizeof(pMasks)];
+        record.seq = (uint16_t)(65000U + n);
+        record.tick = 0xFFFFFF00U + n * 7U;
+        for (uint8_t i = 0; i < IMU_BRIDGE_FRAME_MAX_CHANNELS; i++)
+        {
+            /* Zero bytes, extremes and noise */
+            seed = seed * 1103515245U + 12345U;
+            pValues[i] = (n % 5U == 0) ? 0 : (n % 5U == 1) ? (int16_t)(i & 1U ? INT16_MIN : INT16_MAX) :
+                         (int16_t)(seed >> 16);
+        }
+
+        sent = Test_Send(pEncoder, &record);
+        if (sent < 2U || pWire[sent - 1U] != IMU_BRIDGE_FRAME_DELIMITER || memchr(pWire, 0, sent - 1U) != NULL ||
+            Frame_Decode(pWire, sent - 1U, &decoded) != FRAME_DECODE_OK ||
+            decoded.mask != record.mask || decoded.seq != record.seq || decoded.tick != record.tick ||
+            memcmp(decoded.pValues, pValues, decoded.channels * sizeof(int16_t)) != 0)
+        {
+            failed++;
+        }
+    }
+    TEST_CHECK(failed == 0);
+}
+
+/**
+ * @brief A damaged frame is rejected, never decoded into a record
+*/
+static void Test_BinaryDamaged(void)
+{
+    const IMU_Bridge_EncoderTypeDef* pEncoder = IMU_Bridge_EncoderGet(IMU_BRIDGE_ENCODER_BINARY);
+    int16_t pValues[IMU_BRIDGE_FRAME_MAX_CHANNELS] = { 100, -200, 300, 25, 4000, -5000, 6000, 7, -8, 9 };
+    IMU_Bridge_RecordTypeDef record = { 0x0FU, 7, 1234, pValues };
+    Frame_RecordTypeDef decoded;
+    uint32_t sent = Test_Send(pEncoder, &record), rejected = 0;
+    uint8_t pFrame[FRAME_DECODE_MAX_SIZE];
+
+    TEST_CHECK(sent > 1U && Frame_Decode(pWire, sent - 1U, &decoded) == FRAME_DECODE_OK);
+
+    /* Each bit flipped in turn, and the last byte lost */
+    for (uint32_t bit = 0; bit < 8U * (sent - 1U); bit++)
+    {
+        memcpy(pFrame, pWire, sent - 1U);
+        pFrame[bit / 8U] ^= (uint8_t)(1U << (bit % 8U));
+        rejected += (Frame_Decode(pFrame, sent - 1U, &decoded) != FRAME_DECODE_OK);
+    }
+    TEST_CHECK(rejected == 8U * (sent - 1U));
+    TEST_CHECK(Frame_Decode(pWire, sent - 2U, &decoded) != FRAME_DECODE_OK);
+}
+
+/**
+ * @brief Append a frame of the given sequence to the stream
+ * @retval Frame size, delimiter included
+*/
+static uint32_t Test_StreamFrame(uint8_t* pStream, uint16_t seq)
+{
+    const IMU_Bridge_EncoderTypeDef* pEncoder = IMU_Bridge_EncoderGet(IMU_BRIDGE_ENCODER_BINARY);
+    int16_t pValues[IMU_BRIDGE_FRAME_MAX_CHANNELS];
+    IMU_Bridge_RecordTypeDef record = { 0x0FU, seq, 1000U * seq, pValues };
+    uint32_t sent;
+
+    for (uint8_t i = 0; i < IMU_BRIDGE_FRAME_MAX_CHANNELS; i++) pValues[i] = (int16_t)(seq * 37 - i * 1000);
+    sent = Test_Send(pEncoder, &record);
+    memcpy(pStream, pWire, sent);
+    return sent;
+}
+
+/**
+ * @brief   The stream decoder loses the damaged frame and takes the next one
+ * @note    A frame whose delimiter is lost takes the next one with it, they
+ *          arrive as a single damaged frame.
+*/
+static void Test_StreamResync(void)
+{
+    static uint8_t pStream[16384];
+    Frame_DecoderTypeDef decoder;
+    Frame_RecordTypeDef decoded;
+    uint32_t size = 0, start = 0, sent;
+    uint16_t seq = 1, lost = 0;
+    bool ordered = true;
+
+    for (uint16_t n = 0; n < 200U; n++)
+    {
+        sent = Test_StreamFrame(&pStream[size], n);
+        switch (n)
+        {
+        case 0: start = 3; break;                                   /* Joined midway        */
+        case 20: pStream[size + 5] ^= 0x40U; break;                 /* Byte damaged         */
+        case 40:                                                    /* Byte lost            */
+            memmove(&pStream[size + 5], &pStream[size + 6], sent - 6U);
+            sent--;
+            break;
+        case 60:                                                    /* Delimiter inserted   */
+            memmove(&pStream[size + 9], &pStream[size + 8], sent - 8U);
+            pStream[size + 8] = 0;
+            sent++;
+            break;
+        case 80: sent--; break;                                     /* Delimiter lost       */
+        case 100:                                                   /* Noise between frames */
+            memcpy(&pStream[size + sent], "\x55\xAA\x13\x00", 4);
+            sent += 4U;
+            break;
+        case 120:                                                   /* Frame too long       */
+            memset(&pStream[size], 0x5A, 3U * FRAME_DECODE_MAX_SIZE);
+            pStream[size + 3U * FRAME_DECODE_MAX_SIZE] = 0;
+            sent = 3U * FRAME_DECODE_MAX_SIZE + 1U;
+            break;
+        default: break;
+        }
+        size += sent;
+    }
+
+    Frame_DecoderInit(&decoder);
+    for (uint32_t i = start; i < size; i++)
+    {
+        if (!Frame_DecoderPush(&decoder, pStream[i], &decoded)) continue;
+
+        /* Frames 20, 40, 60, 80 and 81, 120 lost */
+        while (seq == 20U || seq == 40U || seq == 60U || seq == 80U || seq == 81U || seq == 120U)
+        {
+            seq++;
+            lost++;
+        }
+        ordered &= (decoded.seq == seq && decoded.tick == 1000U * seq && decoded.pValues[9] == (int16_t)(seq * 37 - 9000));
+        seq++;
+    }
+    TEST_CHECK(ordered);
+    TEST_CHECK(seq == 200U && lost == 6U);
+    TEST_CHECK(decoder.frames == 193U);
+    /* The two halves of frame 60 and the noise count as damaged frames */
+    TEST_CHECK(decoder.errors == 7U);
+}
+
+/**
+ * @brief Binary commit, the whole reserved size goes out, never more
+*/
+static void Test_CommitData(void)
+{
+    char* msg;
+
+    TEST_CHECK(IMU_Bridge_TxCommitData(1) == IMU_BRIDGE_ERROR);
+
+    msg = IMU_Bridge_TxReserve(4);
+    TEST_CHECK(msg != NULL);
+    memcpy(msg, "\x01\x02\x03\x00", 4);
+    TEST_CHECK(IMU_Bridge_TxCommitData(5) == IMU_BRIDGE_ERROR);
+    TEST_CHECK(Host_UartTxDrain(pWire, sizeof(pWire)) == 0);
+
+    msg = IMU_Bridge_TxReserve(4);
+    memcpy(msg, "\x01\x02\x03\x00", 4);
+    TEST_CHECK(IMU_Bridge_TxCommitData(4) == IMU_BRIDGE_OK);
+    TEST_CHECK(Host_UartTxDrain(pWire, sizeof(pWire)) == 4U && memcmp(pWire, "\x01\x02\x03\x00", 4) == 0);
+}
+
+int main(void)
+{
+    TEST_CHECK(IMU_Bridge_Init() == IMU_BRIDGE_OK);
+
+    TEST_RUN(Test_CommitData);
+    TEST_RUN(Test_BinaryRoundTrip);
+    TEST_RUN(Test_BinaryDamaged);
+    TEST_RUN(Test_StreamResync);
+    return Test_Summary();
+}
@@ -0,0 +1,230 @@
+/**
+  ******************************************************************************
+  * @file           : test_hsm.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : State machine engine host tests
+  ******************************************************************************
+  * @attention
+  *
+  * State machine engine host tests, hsm.c over a test machine whose
+  * actions log themselves: entry and exit order across the hierarchy,
+  * internal and self transitions, events handled by a parent, follow-up
+  * events and do actions.
+  *
+  *   top
+  *    +- a
+  *    |   +- a1
+  *    |   +- a2
+  *    +- b
+  *        +- b1
+  *   other (no parent)
+  *
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "hsm.h"
+
+#include <string.h>
+
+/**
+ * @brief Test machine events
+*/
+enum
+{
+    TEST_EVT_SIBLING,           /*!< a1 to a2                           */
+    TEST_EVT_TO_B1,             /*!< Handled by a, to b1                */
+    TEST_EVT_INTERNAL,          /*!< Handled by top, no state change    */
+    TEST_EVT_SELF,              /*!< b1 to itself                       */
+    TEST_EVT_TO_PARENT,         /*!< b1 to b                            */
+    TEST_EVT_CHAIN,             /*!< b to a1, follow-up TO_B1           */
+    TEST_EVT_TO_OTHER,          /*!< To a separate root                 */
+    TEST_EVT_TO_A1,             /*!< other to a1                        */
+    TEST_EVT_UNHANDLED
+};
+
+static char pLog[256];                              /*!< Actions run, in order              */
+
+static void Test_Log(const char* pAction)
+{
+    strcat(pLog, pAction);
+}
+
+static void Test_TopEntry(void) { Test_Log("+top"); }
+static void Test_TopExit(void) { Test_Log("-top"); }
+static void Test_AEntry(void) { Test_Log("+a"); }
+static void Test_AExit(void) { Test_Log("-a"); }
+static void Test_A1Entry(void) { Test_Log("+a1"); }
+static void Test_A1Exit(void) { Test_Log("-a1"); }
+static void Test_A2Entry(void) { Test_Log("+a2"); }
+static void Test_A2Exit(void) { Test_Log("-a2"); }
+static void Test_BEntry(void) { Test_Log("+b"); }
+static void Test_BExit(void) { Test_Log("-b"); }
+static void Test_B1Entry(void) { Test_Log("+b1"); }
+static void Test_B1Exit(void) { Test_Log("-b1"); }
+static void Test_OtherEntry(void) { Test_Log("+other"); }
+static void Test_OtherExit(void) { Test_Log("-other"); }
+
+static uint32_t Test_Action(uint32_t event)
+{
+    Test_Log("!act");
+    return HSM_EVENT_NONE;
+}
+
+static uint32_t Test_ChainAction(uint32_t event)
+{
+    Test_Log("!chain");
+    return TEST_EVT_TO_B1;
+}
+
+static uint32_t Test_ADo(uint32_t event)
+{
+    Test_Log("*a");
+    return HSM_EVENT_NONE;
+}
+
+static uint32_t Test_B1Do(uint32_t event)
+{
+    Test_Log("*b1");
+    return TEST_EVT_TO_PARENT;
+}
+
+static const Hsm_StateTypeDef topState, aState, a1State, a2State, bState, b1State, otherState;
+
+static const Hsm_TransitionTypeDef topTransitions[] =
+{
+    { TEST_EVT_INTERNAL,    NULL,           Test_Action         },
+    { TEST_EVT_TO_OTHER,    &otherState,    NULL                },
+};
+
+static const Hsm_TransitionTypeDef aTransitions[] =
+{
+    { TEST_EVT_TO_B1,       &b1State,       Test_Action         },
+};
+
+static const Hsm_TransitionTypeDef a1Transitions[] =
+{
+    { TEST_EVT_SIBLING,     &a2State,       NULL                },
+};
+
+static const Hsm_TransitionTypeDef bTransitions[] =
+{
+    { TEST_EVT_CHAIN,       &a1State,       Test_ChainAction    },
+};
+
+static const Hsm_TransitionTypeDef b1Transitions[] =
+{
+    { TEST_EVT_SELF,        &b1State,       NULL                },
+    { TEST_EVT_TO_PARENT,   &bState,        NULL                },
+};
+
+static const Hsm_TransitionTypeDef otherTransitions[] =
+{
+    { TEST_EVT_TO_A1,       &a1State,       NULL                },
+};
+
+/*                                          parent      entry               exit                do          transitions                 */
+static const Hsm_StateTypeDef topState   = { NULL,       Test_TopEntry,      Test_TopExit,       NULL,       HSM_TABLE(topTransitions)   };
+static const Hsm_StateTypeDef aState     = { &topState,  Test_AEntry,        Test_AExit,         Test_ADo,   HSM_TABLE(aTransitions)     };
+static const Hsm_StateTypeDef a1State    = { &aState,    Test_A1Entry,       Test_A1Exit,        NULL,       HSM_TABLE(a1Transitions)    };
+static const Hsm_StateTypeDef a2State    = { &aState,    Test_A2Entry,       Test_A2Exit,        NULL,       NULL, 0                     };
+static const Hsm_StateTypeDef bState     = { &topState,  Test_BEntry,        Test_BExit,         NULL,       HSM_TABLE(bTransitions)     };
+static const Hsm_StateTypeDef b1State    = { &bState,    Test_B1Entry,       Test_B1Exit,        Test_B1Do,  HSM_TABLE(b1Transitions)    };
+static const Hsm_StateTypeDef otherState = { NULL,       Test_OtherEntry,    Test_OtherExit,     NULL,       HSM_TABLE(otherTransitions) };
+
+static Hsm_TypeDef hsm;
+
+/**
+ * @brief Dispatch an event, the log holds its actions only
+*/
+static void Test_Dispatch(uint32_t event)
+{
+    pLog[0] = '\0';
+    Hsm_Dispatch(&hsm, event);
+}
+
+/**
+ * @brief The initial state is entered from the top down
+*/
+static void Test_Init(void)
+{
+    pLog[0] = '\0';
+    Hsm_Init(&hsm, &a1State);
+    TEST_CHECK(strcmp(pLog, "+top+a+a1") == 0);
+    TEST_CHECK(hsm.pState == &a1State);
+}
+
+/**
+ * @brief Transitions exit up to the common ancestor, run the action, then enter down
+*/
+static void Test_Transitions(void)
+{
+    Hsm_Init(&hsm, &a1State);
+
+    Test_Dispatch(TEST_EVT_SIBLING);
+    TEST_CHECK(strcmp(pLog, "-a1+a2") == 0 && hsm.pState == &a2State);
+
+    /* Found in the parent table, from a child without one */
+    Test_Dispatch(TEST_EVT_TO_B1);
+    TEST_CHECK(strcmp(pLog, "-a2-a!act+b+b1") == 0 && hsm.pState == &b1State);
+
+    Test_Dispatch(TEST_EVT_INTERNAL);
+    TEST_CHECK(strcmp(pLog, "!act") == 0 && hsm.pState == &b1State);
+
+    Test_Dispatch(TEST_EVT_SELF);
+    TEST_CHECK(strcmp(pLog, "-b1+b1") == 0 && hsm.pState == &b1State);
+
+    Test_Dispatch(TEST_EVT_TO_PARENT);
+    TEST_CHECK(strcmp(pLog, "-b1-b+b") == 0 && hsm.pState == &bState);
+
+    Test_Dispatch(TEST_EVT_UNHANDLED);
+    TEST_CHECK(pLog[0] == '\0' && hsm.pState == &bState);
+
+    /* No common ancestor, every level exited and entered */
+    Test_Dispatch(TEST_EVT_TO_OTHER);
+    TEST_CHECK(strcmp(pLog, "-b-top+other") == 0 && hsm.pState == &otherState);
+    Test_Dispatch(TEST_EVT_TO_A1);
+    TEST_CHECK(strcmp(pLog, "-other+top+a+a1") == 0 && hsm.pState == &a1State);
+}
+
+/**
+ * @brief A follow-up event is dispatched after the transition that produced it completes
+*/
+static void Test_FollowUp(void)
+{
+    Hsm_Init(&hsm, &b1State);
+    Test_Dispatch(TEST_EVT_TO_PARENT);
+
+    Test_Dispatch(TEST_EVT_CHAIN);
+    TEST_CHECK(strcmp(pLog, "-b!chain+a+a1-a1-a!act+b+b1") == 0 && hsm.pState == &b1State);
+}
+
+/**
+ * @brief The do action of the state or the closest parent, its event dispatched
+*/
+static void Test_DoAction(void)
+{
+    Hsm_Init(&hsm, &a2State);
+    pLog[0] = '\0';
+    Hsm_Run(&hsm);
+    TEST_CHECK(strcmp(pLog, "*a") == 0 && hsm.pState == &a2State);
+
+    Hsm_Init(&hsm, &b1State);
+    pLog[0] = '\0';
+    Hsm_Run(&hsm);
+    TEST_CHECK(strcmp(pLog, "*b1-b1-b+b") == 0 && hsm.pState == &bState);
+
+    /* No do action up to the top */
+    pLog[0] = '\0';
+    Hsm_Run(&hsm);
+    TEST_CHECK(pLog[0] == '\0' && hsm.pState == &bState);
+}
+
+int main(void)
+{
+    TEST_RUN(Test_Init);
+    TEST_RUN(Test_Transitions);
+    TEST_RUN(Test_FollowUp);
+    TEST_RUN(Test_DoAction);
+    return Test_Summary();
+}
@@ -0,0 +1,152 @@
+/**
+  ******************************************************************************
+  * @file           : test_port_uart.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : UART port host tests
+  ******************************************************************************
+  * @attention
+  *
+  * UART port host tests, port_uart.c over the HAL stand-in. The DMA
+  * transfers are completed by the test, at any point of the queueing.
+  *
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "main.h"
+#include "port_uart.h"
+
+#include <string.h>
+
+static uint8_t pWire[64 * 1024];                    /*!< Bytes out of the stand-in port     */
+
+/* Bridge callbacks, only the TX path is under test */
+void IMU_Bridge_RxCallback(const uint8_t* pData, uint16_t size)
+{
+}
+
+void IMU_Bridge_RxIdleCallback(void)
+{
+}
+
+bool IMU_Bridge_EventPending(void)
+{
+    return false;
+}
+
+/**
+ * @brief Messages of varying length, a running byte pattern
+*/
+static uint16_t Test_Message(uint8_t* pMsg, uint32_t index, uint32_t* pNext)
+{
+    uint16_t size = (uint16_t)(1U + (index * 37U) % 120U);
+
+    for (uint16_t i = 0; i < size; i++) pMsg[i] = (uint8_t)((*pNext)++);
+    return size;
+}
+
+/**
+ * @brief Queue returns at once, the bytes go out on the DMA completion
+*/
+static void Test_TransmitQueues(void)
+{
+    uint8_t pMsg[] = "ACCEL READ:\t1\t2\t3\n\r";
+
+    TEST_CHECK(UART_Init() == IMU_BRIDGE_OK);
+    TEST_CHECK(UART_Transmit(pMsg, sizeof(pMsg) - 1) == IMU_BRIDGE_OK);
+    TEST_CHECK(Host_UartTxDrain(pWire, sizeof(pWire)) == sizeof(pMsg) - 1);
+    TEST_CHECK(memcmp(pWire, pMsg, sizeof(pMsg) - 1) == 0);
+    TEST_CHECK(Host_UartTxDrain(pWire, sizeof(pWire)) == 0);
+}
+
+/**
+ * @brief Bytes reach the port in order, transfers completed while queueing
+*/
+static void Test_TransmitOrder(void)
+{
+    uint8_t pMsg[128];
+    uint32_t next = 0, base = 0, sent = 0;
+    bool inOrder = true;
+
+    TEST_CHECK(UART_Init() == IMU_BRIDGE_OK);
+    for (uint32_t i = 0; i < 2000; i++)
+    {
+        uint32_t first = next;
+        uint16_t size = Test_Message(pMsg, i, &next);
+
+        if (UART_Transmit(pMsg, size) != IMU_BRIDGE_OK)
+        {
+            /* Full ring, complete a transfer and queue the message again */
+            uint16_t done = Host_UartTxComplete(&pWire[sent], sizeof(pWire) - sent);
+
+            if (!TEST_CHECK(done != 0)) break;
+            sent += done;
+            next = first;
+            i--;
+            continue;
+        }
+        if (i % 3 == 0) sent += Host_UartTxComplete(&pWire[sent], sizeof(pWire) - sent);
+        if (sent > sizeof(pWire) / 2)
+        {
+            for (uint32_t j = 0; j < sent; j++) inOrder &= (pWire[j] == (uint8_t)(base + j));
+            base += sent;
+            sent = 0;
+        }
+    }
+    sent += Host_UartTxDrain(&pWire[sent], sizeof(pWire) - sent);
+    for (uint32_t j = 0; j < sent; j++) inOrder &= (pWire[j] == (uint8_t)(base + j));
+    TEST_CHECK(inOrder);
+    TEST_CHECK(base + sent == next);
+}
+
+/**
+ * @brief Messages formatted in place with reserve and commit
+*/
+static void Test_ReserveCommit(void)
+{
+    uint8_t* pMsg;
+    uint32_t sent = 0;
+
+    TEST_CHECK(UART_Init() == IMU_BRIDGE_OK);
+    for (uint32_t i = 0; i < 300; i++)
+    {
+        pMsg = UART_TxReserve(16);
+        if (!TEST_CHECK(pMsg != NULL)) break;
+        memset(pMsg, 'a' + (int)(i % 26U), 10);
+        UART_TxCommit(10);
+        sent += Host_UartTxComplete(&pWire[sent], sizeof(pWire) - sent);
+    }
+    sent += Host_UartTxDrain(&pWire[sent], sizeof(pWire) - sent);
+    TEST_CHECK(sent == 3000);
+    for (uint32_t j = 0; j < sent; j++)
+    {
+        if (!TEST_CHECK(pWire[j] == 'a' + (j / 10U) % 26U)) break;
+    }
+}
+
+/**
+ * @brief A message larger than the free space is dropped whole and counted
+*/
+static void Test_TransmitOverflow(void)
+{
+    uint8_t pMsg[UART_TX_BUFFER_SIZE];
+    uint32_t highWater, overflow;
+
+    memset(pMsg, 'x', sizeof(pMsg));
+    TEST_CHECK(UART_Init() == IMU_BRIDGE_OK);
+    TEST_CHECK(UART_Transmit(pMsg, UART_TX_BUFFER_SIZE / 2) == IMU_BRIDGE_OK);
+    TEST_CHECK(UART_Transmit(pMsg, UART_TX_BUFFER_SIZE / 2 + 1) == IMU_BRIDGE_ERROR);
+    UART_GetTxStats(&highWater, &overflow);
+    TEST_CHECK(highWater == UART_TX_BUFFER_SIZE / 2);
+    TEST_CHECK(overflow == 1);
+    TEST_CHECK(Host_UartTxDrain(pWire, sizeof(pWire)) == UART_TX_BUFFER_SIZE / 2);
+}
+
+int main(void)
+{
+    TEST_RUN(Test_TransmitQueues);
+    TEST_RUN(Test_TransmitOrder);
+    TEST_RUN(Test_ReserveCommit);
+    TEST_RUN(Test_TransmitOverflow);
+    return Test_Summary();
+}
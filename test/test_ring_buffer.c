@@ -0,0 +1,198 @@
+/**
+  ******************************************************************************
+  * @file           : test_ring_buffer.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Ring buffer host tests
+  ******************************************************************************
+  * @attention
+  *
+  * Ring buffer host tests. The stress test runs the producer and the
+  * consumer on two threads, as the FSM and the USART1 ISR, and checks the
+  * byte sequence on the consumer side.
+  *
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "ring_buffer.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#define TEST_STRESS_BYTES   (64U * 1024U * 1024U)   /*!< Bytes through the ring      */
+#define TEST_STRESS_SIZE    256U                    /*!< Ring size, many wraps       */
+
+static uint8_t pStorage[TEST_STRESS_SIZE];
+static RingBuffer_TypeDef ring;
+
+/**
+ * @brief Only power of two sizes
+*/
+static void Test_InitSize(void)
+{
+    TEST_CHECK(!RingBuffer_Init(&ring, pStorage, 0));
+    TEST_CHECK(!RingBuffer_Init(&ring, pStorage, 100));
+    TEST_CHECK(RingBuffer_Init(&ring, pStorage, 64));
+    TEST_CHECK(RingBuffer_Used(&ring) == 0);
+    TEST_CHECK(RingBuffer_Free(&ring) == 64);
+}
+
+/**
+ * @brief A write across the end of the storage is read in two blocks
+*/
+static void Test_WriteWrap(void)
+{
+    uint8_t pData[48];
+    uint8_t* pBlock;
+
+    for (uint32_t i = 0; i < sizeof(pData); i++) pData[i] = (uint8_t)i;
+    RingBuffer_Init(&ring, pStorage, 64);
+
+    TEST_CHECK(RingBuffer_Write(&ring, pData, 40));
+    TEST_CHECK(RingBuffer_Peek(&ring, &pBlock) == 40);
+    RingBuffer_Consume(&ring, 40);
+
+    TEST_CHECK(RingBuffer_Write(&ring, pData, 48));
+    TEST_CHECK(RingBuffer_Used(&ring) == 48);
+    TEST_CHECK(RingBuffer_Peek(&ring, &pBlock) == 24);
+    TEST_CHECK(memcmp(pBlock, pData, 24) == 0);
+    RingBuffer_Consume(&ring, 24);
+    TEST_CHECK(RingBuffer_Peek(&ring, &pBlock) == 24);
+    TEST_CHECK(pBlock == pStorage);
+    TEST_CHECK(memcmp(pBlock, &pData[24], 24) == 0);
+    RingBuffer_Consume(&ring, 24);
+    TEST_CHECK(RingBuffer_Peek(&ring, &pBlock) == 0);
+}
+
+/**
+ * @brief A reservation that doesn't fit before the end starts over, the
+ *        bytes skipped are never read
+*/
+static void Test_ReserveSkip(void)
+{
+    uint8_t* pRegion;
+    uint8_t* pBlock;
+
+    RingBuffer_Init(&ring, pStorage, 64);
+    pRegion = RingBuffer_Reserve(&ring, 50);
+    TEST_CHECK(pRegion == pStorage);
+    memset(pRegion, 'a', 50);
+    RingBuffer_Commit(&ring, 50);
+    TEST_CHECK(RingBuffer_Peek(&ring, &pBlock) == 50);
+    RingBuffer_Consume(&ring, 50);
+
+    /* 14 bytes left before the end, 20 reserved at the start */
+    pRegion = RingBuffer_Reserve(&ring, 20);
+    TEST_CHECK(pRegion == pStorage);
+    memset(pRegion, 'b', 12);
+    RingBuffer_Commit(&ring, 12);
+    TEST_CHECK(RingBuffer_Peek(&ring, &pBlock) == 12);
+    TEST_CHECK(pBlock == pStorage && pBlock[0] == 'b');
+    RingBuffer_Consume(&ring, 12);
+    TEST_CHECK(RingBuffer_Used(&ring) == 0);
+}
+
+/**
+ * @brief High water mark and all or nothing overflow
+*/
+static void Test_Counters(void)
+{
+    uint8_t pData[64] = {0};
+    uint8_t* pBlock;
+
+    RingBuffer_Init(&ring, pStorage, 64);
+    TEST_CHECK(RingBuffer_Write(&ring, pData, 40));
+    TEST_CHECK(!RingBuffer_Write(&ring, pData, 25));
+    TEST_CHECK(RingBuffer_Reserve(&ring, 30) == NULL);
+    TEST_CHECK(ring.overflow == 2);
+    TEST_CHECK(RingBuffer_Used(&ring) == 40);
+    TEST_CHECK(RingBuffer_Write(&ring, pData, 24));
+    TEST_CHECK(ring.highWater == 64);
+    RingBuffer_Peek(&ring, &pBlock);
+    RingBuffer_Consume(&ring, 64);
+    TEST_CHECK(ring.highWater == 64);
+}
+
+/**
+ * @brief Producer thread, messages of varying length by write or reserve
+ *        and commit, the bytes a running sequence
+*/
+static void* Test_Producer(void* pArg)
+{
+    uint8_t pMsg[64];
+    uint32_t next = 0;
+    uint32_t seed = 1;
+
+    while (next < TEST_STRESS_BYTES)
+    {
+        uint32_t size, written;
+        uint8_t* pRegion;
+
+        seed = seed * 1103515245U + 12345U;
+        size = 1U + (seed >> 16) % sizeof(pMsg);
+
+        if (seed & 0x8000U)
+        {
+            for (uint32_t i = 0; i < size; i++) pMsg[i] = (uint8_t)(next + i);
+            while (!RingBuffer_Write(&ring, pMsg, size)) sched_yield();
+            written = size;
+        }
+        else
+        {
+            while ((pRegion = RingBuffer_Reserve(&ring, size)) == NULL) sched_yield();
+            written = 1U + (seed >> 8) % size;      /* Shorter than reserved at times */
+            for (uint32_t i = 0; i < written; i++) pRegion[i] = (uint8_t)(next + i);
+            RingBuffer_Commit(&ring, written);
+        }
+        next += written;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Producer and consumer on two threads, no byte lost, duplicated or
+ *        out of order
+*/
+static void Test_Stress(void)
+{
+    pthread_t producer;
+    uint32_t next = 0;
+    uint32_t errors = 0;
+
+    RingBuffer_Init(&ring, pStorage, TEST_STRESS_SIZE);
+    TEST_CHECK(pthread_create(&producer, NULL, Test_Producer, NULL) == 0);
+
+    while (next < TEST_STRESS_BYTES)
+    {
+        uint8_t* pBlock;
+        uint32_t size = RingBuffer_Peek(&ring, &pBlock);
+
+        if (size == 0)
+        {
+            sched_yield();
+            continue;
+        }
+        for (uint32_t i = 0; i < size; i++)
+        {
+            if (pBlock[i] != (uint8_t)(next + i)) errors++;
+        }
+        next += size;
+        RingBuffer_Consume(&ring, size);
+    }
+    pthread_join(producer, NULL);
+
+    TEST_CHECK(errors == 0);
+    TEST_CHECK(RingBuffer_Used(&ring) == 0);
+    TEST_CHECK(ring.highWater <= TEST_STRESS_SIZE);
+}
+
+int main(void)
+{
+    TEST_RUN(Test_InitSize);
+    TEST_RUN(Test_WriteWrap);
+    TEST_RUN(Test_ReserveSkip);
+    TEST_RUN(Test_Counters);
+    TEST_RUN(Test_Stress);
+    return Test_Summary();
+}
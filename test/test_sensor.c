@@ -0,0 +1,457 @@
+/**
+  ******************************************************************************
+  * @file           : test_sensor.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Sensor acquisition host tests
+  ******************************************************************************
+  * @attention
+  *
+  * Sensor acquisition host tests, imu_bridge_sensor.c and the bus job queue
+  * of port_imu.c over the stand-in bus and chip of port_imu_host.c.
+  *
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "main.h"
+#include "imu_bridge_frame.h"
+#include "imu_bridge_sensor.h"
+#include "port_imu.h"
+#include "port_imu_host.h"
+#include "port_timer.h"
+
+#include <string.h>
+
+static const int16_t pValues[HOST_IMU_CHANNELS] = { 1000, -2000, 16384, 333, -1, 250, -32768, 120, -45, 32767 };
+
+/* Bridge callbacks, the UART port is linked for the system tick only */
+void IMU_Bridge_RxCallback(const uint8_t* pData, uint16_t size)
+{
+}
+
+void IMU_Bridge_RxIdleCallback(void)
+{
+}
+
+bool IMU_Bridge_EventPending(void)
+{
+    return false;
+}
+
+void IMU_Bridge_EventPost(uint32_t events)
+{
+}
+
+/**
+ * @brief Power on the chip and run the sensor init, the tick running for its waits
+*/
+static bool Test_SensorUp(void)
+{
+    bool ok;
+
+    Host_ImuReset();
+    Host_TickRun = true;
+    ok = IMU_Port_Init() == IMU_BRIDGE_OK && Timer_Init() == IMU_BRIDGE_OK && IMU_Bridge_SensorInit() == IMU_BRIDGE_OK;
+    Host_TickRun = false;
+    return ok;
+}
+
+/**
+ * @brief Check a sample against the values the chip was given
+*/
+static bool Test_SampleEqual(const IMU_Bridge_SampleTypeDef* pSample, const int16_t* pExpected)
+{
+    return memcmp(pSample->accel, &pExpected[0], sizeof(pSample->accel)) == 0 && pSample->temp == pExpected[3] &&
+           memcmp(pSample->gyro, &pExpected[4], sizeof(pSample->gyro)) == 0 &&
+           memcmp(pSample->mag, &pExpected[7], sizeof(pSample->mag)) == 0;
+}
+
+/**
+ * @brief The init wakes the chip, loads the cache and sets up the AK8963 auto read
+*/
+static void Test_Init(void)
+{
+    TEST_CHECK(Test_SensorUp());
+    TEST_CHECK(IMU_Bridge_SensorCheck() == IMU_BRIDGE_OK);
+    TEST_CHECK(Host_ImuGetReg(IMU_REG_PWR_MGMT_1) == IMU_PWR_MGMT_1_CLKSEL);
+    TEST_CHECK(Host_ImuGetReg(IMU_REG_USER_CTRL) & IMU_USER_CTRL_I2C_MST_EN);
+    TEST_CHECK(Host_ImuGetReg(IMU_REG_I2C_SLV0_ADDR) == (IMU_MAG_ADDRESS | IMU_I2C_SLV_READ));
+    TEST_CHECK(IMU_Bridge_MagIsReady());
+    TEST_CHECK(IMU_Bridge_ShadowGet(IMU_REG_GYRO_CONFIG) == 0);
+}
+
+/**
+ * @brief Blocking read of all the sensors, the magnetometer through EXT_SENS_DATA
+*/
+static void Test_Read(void)
+{
+    IMU_Bridge_SampleTypeDef sample;
+
+    TEST_CHECK(Test_SensorUp());
+    Host_ImuSample(pValues);
+    TEST_CHECK(IMU_Bridge_SensorRead(IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_TEMP | IMU_BRIDGE_SENSOR_GYRO |
+                                     IMU_BRIDGE_SENSOR_MAG, &sample) == IMU_BRIDGE_OK);
+    TEST_CHECK(Test_SampleEqual(&sample, pValues));
+
+    /* Gyro alone, the other sensors out of the burst are left zero */
+    memset(&sample, 0x55, sizeof(sample));
+    TEST_CHECK(IMU_Bridge_SensorRead(IMU_BRIDGE_SENSOR_GYRO, &sample) == IMU_BRIDGE_OK);
+    TEST_CHECK(sample.accel[0] == 0 && sample.gyro[2] == pValues[6] && sample.mag[0] == 0);
+}
+
+/**
+ * @brief Burst read job, complete in the bus interrupt, a second one refused meanwhile
+*/
+static void Test_Fetch(void)
+{
+    IMU_Bridge_SampleTypeDef sample;
+    uint32_t minPeriod, maxPeriod, missed;
+
+    TEST_CHECK(Test_SensorUp());
+    Host_ImuSample(pValues);
+    IMU_Bridge_SampleResetStats();
+
+    Host_ImuBusHold(true);
+    TEST_CHECK(IMU_Bridge_SampleFetch() == IMU_BRIDGE_OK);
+    TEST_CHECK(!IMU_Bridge_SampleRead(&sample));
+    TEST_CHECK(IMU_Port_IsBusy());
+    TEST_CHECK(IMU_Bridge_SampleFetch() == IMU_BRIDGE_ERROR);
+    Host_ImuBusHold(false);
+
+    TEST_CHECK(!IMU_Port_IsBusy());
+    TEST_CHECK(IMU_Bridge_SampleRead(&sample));
+    TEST_CHECK(Test_SampleEqual(&sample, pValues));
+    TEST_CHECK(sample.mask == (IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_TEMP | IMU_BRIDGE_SENSOR_GYRO | IMU_BRIDGE_SENSOR_MAG));
+    TEST_CHECK(!IMU_Bridge_SampleRead(&sample));
+    IMU_Bridge_SampleGetStats(&minPeriod, &maxPeriod, &missed);
+    TEST_CHECK(missed == 1);
+}
+
+/**
+ * @brief AK8963 overflow flagged in ST2, the magnetometer dropped from the sample
+*/
+static void Test_MagOverflow(void)
+{
+    IMU_Bridge_SampleTypeDef sample;
+
+    TEST_CHECK(Test_SensorUp());
+    Host_ImuMagOverflow(true);
+    Host_ImuSample(pValues);
+    TEST_CHECK(IMU_Bridge_SampleFetch() == IMU_BRIDGE_OK);
+    TEST_CHECK(IMU_Bridge_SampleRead(&sample));
+    TEST_CHECK(sample.mask == (IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_TEMP | IMU_BRIDGE_SENSOR_GYRO));
+    TEST_CHECK(sample.accel[0] == pValues[0] && sample.gyro[2] == pValues[6]);
+    TEST_CHECK(IMU_Bridge_SensorRead(IMU_BRIDGE_SENSOR_MAG, &sample) == IMU_BRIDGE_OK && sample.mask == 0);
+
+    /* The next measurement in range is back */
+    Host_ImuMagOverflow(false);
+    Host_ImuSample(pValues);
+    TEST_CHECK(IMU_Bridge_SensorRead(IMU_BRIDGE_SENSOR_MAG, &sample) == IMU_BRIDGE_OK);
+    TEST_CHECK(sample.mask == IMU_BRIDGE_SENSOR_MAG && sample.mag[2] == pValues[9]);
+}
+
+/**
+ * @brief Release the held bus job, from the busy wait of a blocking access
+*/
+static void Test_BusRelease(void)
+{
+    Host_ImuBusHold(false);
+}
+
+/**
+ * @brief   Blocking register read queued behind a burst started meanwhile
+ *          by an interrupt, not refused. A read timed out refuses the next
+ *          one until it completes.
+*/
+static void Test_ReadQueued(void)
+{
+    IMU_Bridge_SampleTypeDef sample;
+    uint8_t value = 0;
+
+    TEST_CHECK(Test_SensorUp());
+    Host_ImuSample(pValues);
+    Host_ImuBusHold(true);
+    TEST_CHECK(IMU_Bridge_SampleFetch() == IMU_BRIDGE_OK);
+    Host_TickHook = Test_BusRelease;
+    Host_TickRun = true;
+    TEST_CHECK(IMU_Port_Read(IMU_REG_WHO_AM_I, &value, 1) == IMU_BRIDGE_OK);
+    Host_TickRun = false;
+    Host_TickHook = NULL;
+    TEST_CHECK(value == IMU_WHO_AM_I_MPU9250);
+    TEST_CHECK(IMU_Bridge_SampleRead(&sample) && Test_SampleEqual(&sample, pValues));
+
+    Host_ImuBusHold(true);
+    Host_TickRun = true;
+    TEST_CHECK(IMU_Port_Read(IMU_REG_WHO_AM_I, &value, 1) == IMU_BRIDGE_ERROR);
+    TEST_CHECK(IMU_Port_Read(IMU_REG_WHO_AM_I, &value, 1) == IMU_BRIDGE_ERROR);
+    Host_TickRun = false;
+    Host_ImuBusHold(false);
+    value = 0;
+    TEST_CHECK(IMU_Port_Read(IMU_REG_WHO_AM_I, &value, 1) == IMU_BRIDGE_OK && value == IMU_WHO_AM_I_MPU9250);
+    TEST_CHECK(IMU_Port_Read(IMU_REG_WHO_AM_I, &value, IMU_PORT_READ_MAX_SIZE + 1U) == IMU_BRIDGE_ERROR);
+}
+
+/**
+ * @brief Configuration writes are bus jobs, in order with the acquisition
+*/
+static void Test_Config(void)
+{
+    uint16_t gyroDps, accelG;
+
+    TEST_CHECK(Test_SensorUp());
+    TEST_CHECK(IMU_Bridge_GyroSetFullScale(3) == IMU_BRIDGE_OK);
+    TEST_CHECK(IMU_Bridge_AccelSetFullScale(1) == IMU_BRIDGE_OK);
+    TEST_CHECK(Host_ImuGetReg(IMU_REG_GYRO_CONFIG) == (3U << IMU_FS_SEL_SHIFT));
+    TEST_CHECK(Host_ImuGetReg(IMU_REG_ACCEL_CONFIG) == (1U << IMU_FS_SEL_SHIFT));
+    IMU_Bridge_GetFullScale(&gyroDps, &accelG);
+    TEST_CHECK(gyroDps == 2000 && accelG == 4);
+}
+
+/**
+ * @brief Data ready acquisition, each chip sample starts a burst from the INT pin interrupt
+*/
+static void Test_Drdy(void)
+{
+    IMU_Bridge_SampleTypeDef sample;
+    int16_t pNext[HOST_IMU_CHANNELS];
+
+    TEST_CHECK(Test_SensorUp());
+    TEST_CHECK(IMU_Bridge_DrdyStart() == IMU_BRIDGE_OK);
+    TEST_CHECK(Host_ImuGetReg(IMU_REG_SMPLRT_DIV) == IMU_DRDY_SMPLRT_DIV);
+    for (int16_t i = 0; i < 10; i++)
+    {
+        for (uint8_t j = 0; j < HOST_IMU_CHANNELS; j++) pNext[j] = (int16_t)(pValues[j] + i);
+        Host_ImuSample(pNext);
+        if (!TEST_CHECK(IMU_Bridge_SampleRead(&sample))) break;
+        TEST_CHECK(Test_SampleEqual(&sample, pNext));
+    }
+    TEST_CHECK(IMU_Bridge_DrdyStop() == IMU_BRIDGE_OK);
+    Host_ImuSample(pValues);
+    TEST_CHECK(!IMU_Bridge_SampleRead(&sample));
+}
+
+/**
+ * @brief   FIFO frame of the i-th test sample, payload order accel, temp, gyro
+ * @retval  Channels in the frame
+*/
+static uint8_t Test_FifoFrame(uint8_t mask, int16_t i, int16_t* pFrame)
+{
+    uint8_t channels = 0;
+
+    if (mask & IMU_BRIDGE_SENSOR_ACCEL) for (uint8_t j = 0; j < 3U; j++) pFrame[channels++] = (int16_t)(pValues[j] + i);
+    if (mask & IMU_BRIDGE_SENSOR_TEMP) pFrame[channels++] = (int16_t)(pValues[3] + i);
+    if (mask & IMU_BRIDGE_SENSOR_GYRO) for (uint8_t j = 4; j < 7U; j++) pFrame[channels++] = (int16_t)(pValues[j] + i);
+    return channels;
+}
+
+/**
+ * @brief   Chip samples into the FIFO, then drained and read back in order
+ * @param   count: samples to store
+ * @retval  Frames read back equal to the samples, in order, 0 if any missing
+*/
+static uint32_t Test_FifoRun(uint8_t mask, uint32_t count)
+{
+    int16_t pNext[HOST_IMU_CHANNELS];
+    int16_t pFrame[IMU_BRIDGE_FRAME_MAX_CHANNELS];
+    int16_t pExpected[IMU_BRIDGE_FRAME_MAX_CHANNELS];
+    uint32_t matched = 0, read = 0;
+    uint8_t channels;
+    tick_t tick;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        for (uint8_t j = 0; j < HOST_IMU_CHANNELS; j++) pNext[j] = (int16_t)(pValues[j] + (int16_t)i);
+        Host_ImuSample(pNext);
+    }
+
+    /* Count and drain jobs complete right away on the stand-in bus, the count is due */
+    Host_Tick += IMU_FIFO_POLL_MS;
+    for (uint32_t update = 0; update < 2U * count && read < count; update++)
+    {
+        TEST_CHECK(IMU_Bridge_FifoUpdate() == IMU_BRIDGE_OK);
+        while (IMU_Bridge_FifoRead(pFrame, &tick))
+        {
+            channels = Test_FifoFrame(mask, (int16_t)read++, pExpected);
+            matched += (memcmp(pFrame, pExpected, channels * sizeof(int16_t)) == 0);
+        }
+    }
+    return (read == count) ? matched : 0;
+}
+
+/**
+ * @brief FIFO streaming, whole frames drained in few bursts, any sensor selection
+*/
+static void Test_Fifo(void)
+{
+    const uint8_t mask = IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_TEMP | IMU_BRIDGE_SENSOR_GYRO;
+    uint32_t overflow, bursts, jobs;
+
+    TEST_CHECK(Test_SensorUp());
+
+    /* From data ready, FIFO_MODE and the rate in a single write of the cache */
+    TEST_CHECK(IMU_Bridge_DrdyStart() == IMU_BRIDGE_OK);
+    TEST_CHECK(IMU_Bridge_DrdyStop() == IMU_BRIDGE_OK);
+    Host_ImuWriteWatch(IMU_SHADOW_FIRST, IMU_SHADOW_FIRST + IMU_SHADOW_SIZE - 1U);
+    TEST_CHECK(IMU_Bridge_FifoStart(mask | IMU_BRIDGE_SENSOR_MAG) == IMU_BRIDGE_OK);
+    TEST_CHECK(Host_ImuWriteJobs() == 1U);
+    TEST_CHECK(Host_ImuGetReg(IMU_REG_SMPLRT_DIV) == IMU_FIFO_SMPLRT_DIV);
+    TEST_CHECK(Host_ImuGetReg(IMU_REG_CONFIG) & IMU_CONFIG_FIFO_MODE);
+    TEST_CHECK(Host_ImuGetReg(IMU_REG_FIFO_EN) == (IMU_FIFO_EN_ACCEL | IMU_FIFO_EN_TEMP | IMU_FIFO_EN_GYRO));
+    TEST_CHECK(Host_ImuFifoCount() == 0);
+
+    /* 30 frames of 14 bytes, over one burst of 252 bytes */
+    IMU_Bridge_FifoGetStats(&overflow, &bursts);
+    jobs = Host_ImuBusJobs();
+    TEST_CHECK(Test_FifoRun(mask, 30U) == 30U);
+    IMU_Bridge_FifoGetStats(&overflow, &bursts);
+    TEST_CHECK(overflow == 0 && bursts == 2U);
+    TEST_CHECK(Host_ImuBusJobs() - jobs <= 2U * bursts + 1U);
+
+    /* Gyro alone, and accel with gyro */
+    TEST_CHECK(IMU_Bridge_FifoStart(IMU_BRIDGE_SENSOR_GYRO) == IMU_BRIDGE_OK);
+    TEST_CHECK(Test_FifoRun(IMU_BRIDGE_SENSOR_GYRO, 50U) == 50U);
+    TEST_CHECK(IMU_Bridge_FifoStart(IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_GYRO) == IMU_BRIDGE_OK);
+    TEST_CHECK(Test_FifoRun(IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_GYRO, 20U) == 20U);
+    TEST_CHECK(IMU_Bridge_FifoStop() == IMU_BRIDGE_OK);
+    TEST_CHECK(IMU_Bridge_FifoStart(0) == IMU_BRIDGE_ERROR);
+}
+
+/**
+ * @brief   FIFO_COUNT read once per poll period however often the main loop
+ *          runs, as it does on each bus completion. Frames stamped with the
+ *          tick of their sample.
+*/
+static void Test_FifoPoll(void)
+{
+    const uint8_t mask = IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_TEMP | IMU_BRIDGE_SENSOR_GYRO;
+    int16_t pNext[HOST_IMU_CHANNELS];
+    int16_t pFrame[IMU_BRIDGE_FRAME_MAX_CHANNELS];
+    int16_t pExpected[IMU_BRIDGE_FRAME_MAX_CHANNELS];
+    tick_t pTicks[200];
+    uint32_t jobs, read = 0, matched = 0, stamped = 0;
+    tick_t tick;
+
+    TEST_CHECK(Test_SensorUp());
+    TEST_CHECK(IMU_Bridge_FifoStart(mask) == IMU_BRIDGE_OK);
+
+    /* Empty FIFO for 100 ms, the main loop run 10 times a tick */
+    jobs = Host_ImuBusJobs();
+    for (uint32_t ms = 0; ms < 100U; ms++)
+    {
+        Host_Tick++;
+        for (uint32_t i = 0; i < 10U; i++) TEST_CHECK(IMU_Bridge_FifoUpdate() == IMU_BRIDGE_OK);
+        TEST_CHECK(!IMU_Bridge_FifoRead(pFrame, &tick));
+    }
+    TEST_CHECK(Host_ImuBusJobs() - jobs == 100U / IMU_FIFO_POLL_MS);
+
+    /* 1 kHz for 200 ms, a count and a drain per poll period */
+    jobs = Host_ImuBusJobs();
+    for (uint32_t ms = 0; ms < 200U; ms++)
+    {
+        Host_Tick++;
+        for (uint8_t j = 0; j < HOST_IMU_CHANNELS; j++) pNext[j] = (int16_t)(pValues[j] + (int16_t)ms);
+        Host_ImuSample(pNext);
+        pTicks[ms] = Host_Tick;
+
+        for (uint32_t i = 0; i < 10U; i++)
+        {
+            TEST_CHECK(IMU_Bridge_FifoUpdate() == IMU_BRIDGE_OK);
+            while (read < 200U && IMU_Bridge_FifoRead(pFrame, &tick))
+            {
+                uint8_t channels = Test_FifoFrame(mask, (int16_t)read, pExpected);
+
+                matched += (memcmp(pFrame, pExpected, channels * sizeof(int16_t)) == 0);
+                stamped += (tick == pTicks[read]);
+                read++;
+            }
+        }
+    }
+    TEST_CHECK(read == 200U && matched == 200U && stamped == 200U);
+    TEST_CHECK(Host_ImuBusJobs() - jobs == 2U * 200U / IMU_FIFO_POLL_MS);
+    TEST_CHECK(IMU_Bridge_FifoStop() == IMU_BRIDGE_OK);
+}
+
+/**
+ * @brief A full FIFO is detected, flushed and streaming resumes aligned
+*/
+static void Test_FifoOverflow(void)
+{
+    const uint8_t mask = IMU_BRIDGE_SENSOR_ACCEL | IMU_BRIDGE_SENSOR_TEMP | IMU_BRIDGE_SENSOR_GYRO;
+    int16_t pFrame[IMU_BRIDGE_FRAME_MAX_CHANNELS];
+    uint32_t overflow, bursts;
+    tick_t tick;
+
+    TEST_CHECK(Test_SensorUp());
+    TEST_CHECK(IMU_Bridge_FifoStart(mask) == IMU_BRIDGE_OK);
+    IMU_Bridge_FifoGetStats(&overflow, &bursts);
+
+    /* 40 samples, the chip stops on full at 36 frames */
+    for (uint32_t i = 0; i < 40U; i++) Host_ImuSample(pValues);
+    TEST_CHECK(Host_ImuFifoCount() == 36U * 14U);
+    Host_Tick += IMU_FIFO_POLL_MS;
+    TEST_CHECK(IMU_Bridge_FifoUpdate() == IMU_BRIDGE_OK);
+    TEST_CHECK(!IMU_Bridge_FifoRead(pFrame, &tick));
+    TEST_CHECK(IMU_Bridge_FifoUpdate() == IMU_BRIDGE_OK);
+    TEST_CHECK(Host_ImuFifoCount() == 0);
+    IMU_Bridge_FifoGetStats(&overflow, &bursts);
+    TEST_CHECK(overflow == 1U);
+
+    TEST_CHECK(Test_FifoRun(mask, 10U) == 10U);
+
+    /* Stopped, the chip no longer fills it */
+    TEST_CHECK(IMU_Bridge_FifoStop() == IMU_BRIDGE_OK);
+    Host_ImuSample(pValues);
+    TEST_CHECK(Host_ImuFifoCount() == 0);
+    TEST_CHECK(IMU_Bridge_FifoUpdate() == IMU_BRIDGE_OK);
+    TEST_CHECK(!IMU_Bridge_FifoRead(pFrame, &tick));
+}
+
+/**
+ * @brief Rate and bandwidth checked at the divider the chip would run at
+*/
+static void Test_Filter(void)
+{
+    IMU_Bridge_FilterTypeDef filter = { .rateDiv = 0, .gyroDlpf = 1, .accelDlpf = 0, .rateSet = true };
+    uint8_t rateDiv;
+
+    TEST_CHECK(Test_SensorUp());
+    TEST_CHECK(IMU_Bridge_DrdyStart() == IMU_BRIDGE_OK);
+    TEST_CHECK(IMU_Bridge_DrdyStop() == IMU_BRIDGE_OK);
+
+    /* Configured rate, 1 kHz and 333 Hz against 218 Hz of accel bandwidth */
+    TEST_CHECK(IMU_Bridge_FilterCheck(&filter));
+    filter.rateDiv = 2;
+    TEST_CHECK(!IMU_Bridge_FilterCheck(&filter));
+
+    /* No configured rate, the data ready mode default of 100 Hz */
+    filter.rateSet = false;
+    TEST_CHECK(!IMU_Bridge_FilterCheck(&filter));
+    filter.gyroDlpf = 2;
+    filter.accelDlpf = 2;
+    TEST_CHECK(!IMU_Bridge_FilterCheck(&filter));
+    filter.gyroDlpf = 3;
+    filter.accelDlpf = 3;
+    TEST_CHECK(IMU_Bridge_FilterCheck(&filter));
+
+    TEST_CHECK(IMU_Bridge_FilterSet(&filter) == IMU_BRIDGE_OK);
+    IMU_Bridge_FilterGet(&filter, &rateDiv);
+    TEST_CHECK(rateDiv == IMU_DRDY_SMPLRT_DIV && !filter.rateSet);
+    TEST_CHECK(Host_ImuGetReg(IMU_REG_SMPLRT_DIV) == IMU_DRDY_SMPLRT_DIV);
+    TEST_CHECK((Host_ImuGetReg(IMU_REG_CONFIG) & IMU_CONFIG_DLPF_MASK) == 3U);
+}
+
+int main(void)
+{
+    TEST_RUN(Test_Init);
+    TEST_RUN(Test_Read);
+    TEST_RUN(Test_Fetch);
+    TEST_RUN(Test_ReadQueued);
+    TEST_RUN(Test_MagOverflow);
+    TEST_RUN(Test_Config);
+    TEST_RUN(Test_Drdy);
+    TEST_RUN(Test_Fifo);
+    TEST_RUN(Test_FifoPoll);
+    TEST_RUN(Test_FifoOverflow);
+    TEST_RUN(Test_Filter);
+    return Test_Summary();
+}
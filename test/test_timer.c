@@ -0,0 +1,111 @@
+/**
+  ******************************************************************************
+  * @file           : test_timer.c
+  * @author         : Gonzalo Gabriel Fernandez
+  * @brief          : Sample timer port host tests
+  ******************************************************************************
+  * @attention
+  *
+  * Sample timer port host tests, over the TIM2 stand-in of tim_host.c: the
+  * samples fall on exact multiples of the period, and a period longer than
+  * the counter range is split in compare steps long enough for the
+  * interrupt to reprogram the compare in time.
+  *
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "main.h"
+#include "port_timer.h"
+#include "imu_bridge.h"
+#include "imu_bridge_sensor.h"
+
+#define TEST_PERIODS        3U      /*!< Samples checked per period     */
+
+static uint64_t pSampleUs[TEST_PERIODS];            /*!< Time of each sample                */
+static uint32_t samples;                            /*!< Samples since the timer start      */
+
+/* Bridge callbacks of the UART port, linked for the HAL stand-in */
+void IMU_Bridge_RxCallback(const uint8_t* pData, uint16_t size)
+{
+}
+
+void IMU_Bridge_RxIdleCallback(void)
+{
+}
+
+bool IMU_Bridge_EventPending(void)
+{
+    return false;
+}
+
+/**
+ * @brief Sample due, in place of the sensor module
+*/
+void IMU_Bridge_TimerCallback(void)
+{
+    if (samples < TEST_PERIODS) pSampleUs[samples] = Host_TimerUs;
+    samples++;
+}
+
+/**
+ * @brief   Run the timer for some periods, a microsecond at a time
+ * @retval  Shortest compare step seen
+*/
+static uint32_t Test_RunPeriods(uint32_t periodUs)
+{
+    uint32_t compare, step, minStep = UINT32_MAX;
+    uint64_t start;
+
+    samples = 0;
+    TEST_CHECK(Timer_Start(periodUs) == IMU_BRIDGE_OK);
+    start = Host_TimerUs;
+    compare = Host_TIM2.CCR1;
+    minStep = (compare - Host_TIM2.CNT) & 0xFFFFU;
+
+    while (samples < TEST_PERIODS)
+    {
+        Host_TimerRun(1);
+        if (Host_TIM2.CCR1 != compare)
+        {
+            step = (Host_TIM2.CCR1 - compare) & 0xFFFFU;
+            if (step < minStep) minStep = step;
+            compare = Host_TIM2.CCR1;
+        }
+    }
+    TEST_CHECK(Timer_Stop() == IMU_BRIDGE_OK);
+
+    for (uint32_t i = 0; i < TEST_PERIODS; i++) TEST_CHECK(pSampleUs[i] - start == (uint64_t)(i + 1U) * periodUs);
+    return minStep;
+}
+
+/**
+ * @brief Periods within the counter range, a single step each
+*/
+static void Test_ShortPeriods(void)
+{
+    TEST_CHECK(Test_RunPeriods(1000U) == 1000U);
+    TEST_CHECK(Test_RunPeriods(2500U) == 2500U);
+    TEST_CHECK(Test_RunPeriods(TIMER_MAX_STEP) == TIMER_MAX_STEP);
+}
+
+/**
+ * @brief Periods past the counter range, just over one and two max steps
+*/
+static void Test_LongPeriods(void)
+{
+    TEST_CHECK(Test_RunPeriods(TIMER_MAX_STEP + 1U) >= TIMER_MAX_STEP / 2U);
+    TEST_CHECK(Test_RunPeriods(TIMER_MAX_STEP + 2U) >= TIMER_MAX_STEP / 2U);
+    TEST_CHECK(Test_RunPeriods(2U * TIMER_MAX_STEP + 1U) >= TIMER_MAX_STEP / 2U);
+    TEST_CHECK(Test_RunPeriods(100000U) >= TIMER_MAX_STEP / 2U);
+    TEST_CHECK(Test_RunPeriods(1000000U) >= TIMER_MAX_STEP / 2U);
+}
+
+int main(void)
+{
+    TEST_CHECK(Timer_Init() == IMU_BRIDGE_OK);
+
+    TEST_RUN(Test_ShortPeriods);
+    TEST_RUN(Test_LongPeriods);
+    return Test_Summary();
+}